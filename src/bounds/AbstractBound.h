@@ -32,6 +32,7 @@ namespace zmdp {
 #define ZMDP_S_NUM_ENTRIES (1)
 #define ZMDP_S_NUM_ELTS_TABULAR (2)
 #define ZMDP_S_NUM_ENTRIES_TABULAR (3)
+#define ZMDP_S_NUM_INDEX_ENTRIES (4)
 
 struct AbstractBound {
   virtual ~AbstractBound(void) {}
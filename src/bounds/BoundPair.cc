@@ -26,6 +26,7 @@
 #include <fstream>
 #include <iostream>
 #include <queue>
+#include <shared_mutex>
 
 #include "AbstractBound.h"
 #include "MatrixUtils.h"
@@ -52,7 +53,8 @@ BoundPair::BoundPair(bool _maintainLowerBound, bool _maintainUpperBound,
       maintainLowerBound(_maintainLowerBound),
       maintainUpperBound(_maintainUpperBound),
       useUpperBoundRunTimeActionSelection(_useUpperBoundRunTimeActionSelection),
-      dualPointBounds(_dualPointBounds) {}
+      dualPointBounds(_dualPointBounds),
+      useLazyExpansion(false) {}
 
 void BoundPair::updateDualPointBounds(MDPNode &cn, int *maxUBActionP) {
   double lbVal, ubVal;
@@ -99,6 +101,10 @@ void BoundPair::initialize(MDP *_problem, const ZMDPConfig *_config) {
   problem = _problem;
   config = _config;
   targetPrecision = config->getDouble("terminateRegretBound");
+  // lazy expansion lets the upper bound update pick the actions to
+  // expand, so it needs a separate upper bound
+  useLazyExpansion = config->getBool("useLazyExpansion") &&
+                     maintainUpperBound && !dualPointBounds;
 
   if (maintainLowerBound) {
     lowerBound->initialize(BP_INITIALIZATION_PRECISION_FACTOR *
@@ -125,70 +131,133 @@ MDPNode *BoundPair::getRootNode(void) {
 }
 
 MDPNode *BoundPair::getNode(const state_vector &s) {
-  string hs = hashable(s);
-  MDPHash::iterator pr = lookup->find(hs);
-  if (lookup->end() == pr) {
+  std::vector<MDPNode *> newNodes;
+  MDPNode *cn = getNodeDeferred(s, newNodes);
+  initNewNodes(newNodes);
+  return cn;
+}
+
+// returns the node for s.  if the node is new, it is added to newNodes
+// with its bounds not yet set; initNewNodes() finishes it.  deferring
+// the bounds lets all the successors created by one expansion be scored
+// in a single pass over the planes and points of each bound.
+MDPNode *BoundPair::getNodeDeferred(const state_vector &s,
+                                    std::vector<MDPNode *> &newNodes) {
+  uint64_t hs = hashStateVector(s);
+  MDPNode **pr = lookup->findHashed(s, hs);
+  if (NULL == pr) {
     // create a new fringe node
-    MDPNode &cn = *(new MDPNode);
+    MDPNode &cn = *arena.newNode();
     cn.s = s;
     cn.isTerminal = problem->getIsTerminalState(s);
     cn.searchData = NULL;
     cn.boundsData = NULL;
-
-    if (maintainUpperBound) {
-      upperBound->initNodeBound(cn);
-    } else {
-      cn.ubVal = -1;  // n/a
-    }
-    if (maintainLowerBound) {
-      lowerBound->initNodeBound(cn);
-    } else {
-      cn.lbVal = -1;  // n/a
-    }
-    (*lookup)[hs] = &cn;
-
-    FOR_EACH(hstructP, getNodeHandlers) { (*hstructP->h)(cn, hstructP->hdata); }
-
-    numStatesTouched++;
+    lookup->insertHashed(&cn.s, &cn, hs);
+    newNodes.push_back(&cn);
     return &cn;
   } else {
     // return existing node
-    return pr->second;
+    return *pr;
+  }
+}
+
+void BoundPair::initNewNodes(const std::vector<MDPNode *> &newNodes) {
+  if (newNodes.empty()) return;
+
+  if (maintainUpperBound) {
+    upperBound->initNodeBounds(newNodes);
+  } else {
+    FOR_EACH(cnP, newNodes) { (*cnP)->ubVal = -1; }  // n/a
+  }
+  if (maintainLowerBound) {
+    lowerBound->initNodeBounds(newNodes);
+  } else {
+    FOR_EACH(cnP, newNodes) { (*cnP)->lbVal = -1; }  // n/a
+  }
+
+  FOR_EACH(cnP, newNodes) {
+    FOR_EACH(hstructP, getNodeHandlers) {
+      (*hstructP->h)(**cnP, hstructP->hdata);
+    }
   }
+  numStatesTouched += newNodes.size();
 }
 
 MDPNode *BoundPair::getNodeOrNull(const state_vector &s) const {
-  typeof(lookup->begin()) pr = lookup->find(hashable(s));
-  if (lookup->end() == pr) {
+  MDPNode **pr = lookup->find(s);
+  if (NULL == pr) {
     return NULL;
   } else {
-    return pr->second;
+    return *pr;
   }
 }
 
 void BoundPair::expand(MDPNode &cn) {
+  if (useLazyExpansion) {
+    // set up the Q entries with cheap upper bounds; the upper bound
+    // update expands the actions that could still be the best
+    newQEntries(cn);
+    if (upperBound->setInitialQBounds(cn)) {
+      numStatesExpanded++;
+      return;
+    }
+    // the upper bound doesn't support it, so expand in full from now on
+    useLazyExpansion = false;
+  }
+
   // set up successors for this fringe node (possibly creating new fringe nodes)
+  std::vector<outcome_prob_vector> opvs;
+  std::vector<std::vector<state_vector> > allNextStates;
+  problem->getAllOutcomes(opvs, allNextStates, cn.s);
+  expandWithOutcomes(cn, opvs, allNextStates);
+}
+
+void BoundPair::expandAction(MDPNode &cn, int a) {
   outcome_prob_vector opv;
-  state_vector sp;
-  cn.Q.resize(problem->getNumActions());
+  std::vector<state_vector> nextStates;
+  std::vector<MDPNode *> newNodes;
+  problem->getOutcomes(opv, nextStates, cn.s, a);
+  expandActionWithOutcomes(cn, a, opv, nextStates, newNodes);
+  initNewNodes(newNodes);
+}
+
+// allocates the Q entries of fringe node cn, with none of the actions
+// expanded
+void BoundPair::newQEntries(MDPNode &cn) {
+  cn.Q = arena.newQEntries(problem->getNumActions());
   FOR(a, problem->getNumActions()) {
     MDPQEntry &Qa = cn.Q[a];
     Qa.immediateReward = problem->getReward(cn.s, a);
-    problem->getOutcomeProbVector(opv, cn.s, a);
-    Qa.outcomes.resize(opv.size());
-    FOR(o, opv.size()) {
-      double oprob = opv(o);
-      if (oprob > OBS_IS_ZERO_EPS) {
-        MDPEdge *e = new MDPEdge();
-        Qa.outcomes[o] = e;
-        e->obsProb = oprob;
-        e->nextState = getNode(problem->getNextState(sp, cn.s, a, o));
-      } else {
-        Qa.outcomes[o] = NULL;
-      }
-    }
+    Qa.lbVal = BP_QVAL_UNDEFINED;
     Qa.ubVal = BP_QVAL_UNDEFINED;
   }
+}
+
+void BoundPair::expandActionWithOutcomes(
+    MDPNode &cn, int a, const outcome_prob_vector &opv,
+    const std::vector<state_vector> &nextStates,
+    std::vector<MDPNode *> &newNodes) {
+  MDPQEntry &Qa = cn.Q[a];
+  Qa.outcomes = arena.newEdges(opv.size());
+  FOR(o, opv.size()) {
+    double oprob = opv(o);
+    if (oprob > OBS_IS_ZERO_EPS) {
+      MDPEdge &e = Qa.outcomes.elts[o];
+      e.obsProb = oprob;
+      e.nextState = getNodeDeferred(nextStates[o], newNodes);
+    }
+  }
+}
+
+void BoundPair::expandWithOutcomes(
+    MDPNode &cn, const std::vector<outcome_prob_vector> &opvs,
+    const std::vector<std::vector<state_vector> > &allNextStates) {
+  std::vector<MDPNode *> newNodes;
+  newQEntries(cn);
+  FOR(a, problem->getNumActions()) {
+    expandActionWithOutcomes(cn, a, opvs[a], allNextStates[a], newNodes);
+  }
+  initNewNodes(newNodes);
   numStatesExpanded++;
 }
 
@@ -202,11 +271,16 @@ void BoundPair::update(MDPNode &cn, int *maxUBActionP) {
     updateDualPointBounds(cn, maxUBActionP);
   } else {
     // otherwise fall back to whatever separate update procedures are
-    // defined for the two bounds
+    // defined for the two bounds.  with lazy expansion the upper bound
+    // update decides which actions to expand, so it goes first, and the
+    // lower bound backs up the expanded actions.
+    if (maintainUpperBound && useLazyExpansion) {
+      upperBound->update(cn, maxUBActionP);
+    }
     if (maintainLowerBound) {
       lowerBound->update(cn);
     }
-    if (maintainUpperBound) {
+    if (maintainUpperBound && !useLazyExpansion) {
       upperBound->update(cn, maxUBActionP);
     }
   }
@@ -214,12 +288,53 @@ void BoundPair::update(MDPNode &cn, int *maxUBActionP) {
   numBackups++;
 }
 
+void BoundPair::updateConcurrent(MDPNode &cn, int *maxUBActionP) {
+  if (dualPointBounds) {
+    // point bounds read their neighbors' values, which other threads
+    // may be writing; fall back to a fully serialized update
+    BoundPairCore::updateConcurrent(cn, maxUBActionP);
+    return;
+  }
+
+  if (cn.isFringe()) {
+    // generating the successors only reads the model; creating their
+    // nodes modifies the graph
+    std::vector<outcome_prob_vector> opvs;
+    std::vector<std::vector<state_vector> > allNextStates;
+    problem->getAllOutcomes(opvs, allNextStates, cn.s);
+    std::lock_guard<RWLock> lk(graphLock);
+    expandWithOutcomes(cn, opvs, allNextStates);
+  }
+
+  void *lbPrepared = NULL;
+  void *ubPrepared = NULL;
+  {
+    std::shared_lock<RWLock> lk(graphLock);
+    if (maintainLowerBound) {
+      lbPrepared = lowerBound->prepareUpdate(cn);
+    }
+    if (maintainUpperBound) {
+      ubPrepared = upperBound->prepareUpdate(cn, maxUBActionP);
+    }
+  }
+  {
+    std::lock_guard<RWLock> lk(graphLock);
+    if (maintainLowerBound) {
+      lowerBound->commitUpdate(cn, lbPrepared);
+    }
+    if (maintainUpperBound) {
+      upperBound->commitUpdate(cn, ubPrepared, maxUBActionP);
+    }
+    numBackups++;
+  }
+}
+
 // this implementation is not very efficient, but it is guaranteed not
 // to modify the algorithm state, so it can safely be used for
 // simulation testing in the middle of a run.
 int BoundPair::chooseAction(const state_vector &s) const {
   outcome_prob_vector opv;
-  state_vector sp;
+  std::vector<state_vector> nextStates;
   int bestAction = -1;
 
   if (!useUpperBoundRunTimeActionSelection) {
@@ -236,11 +351,11 @@ int BoundPair::chooseAction(const state_vector &s) const {
     double maxVal = -99e+20;
     double minVal = 99e+20;
     FOR(a, problem->getNumActions()) {
-      problem->getOutcomeProbVector(opv, s, a);
+      problem->getOutcomes(opv, nextStates, s, a);
       lbVal = 0;
       FOR(o, opv.size()) {
         if (opv(o) > OBS_IS_ZERO_EPS) {
-          problem->getNextState(sp, s, a, o);
+          const state_vector &sp = nextStates[o];
           lbVal += opv(o) * lowerBound->getValue(sp, getNodeOrNull(sp));
         }
       }
@@ -261,11 +376,11 @@ int BoundPair::chooseAction(const state_vector &s) const {
   double ubVal;
   double maxVal = -99e+20;
   FOR(a, problem->getNumActions()) {
-    problem->getOutcomeProbVector(opv, s, a);
+    problem->getOutcomes(opv, nextStates, s, a);
     ubVal = 0;
     FOR(o, opv.size()) {
       if (opv(o) > OBS_IS_ZERO_EPS) {
-        problem->getNextState(sp, s, a, o);
+        const state_vector &sp = nextStates[o];
         ubVal += opv(o) * upperBound->getValue(sp, getNodeOrNull(sp));
       }
     }
@@ -285,17 +400,17 @@ ValueInterval BoundPair::getValueAt(const state_vector &s) const {
 }
 
 ValueInterval BoundPair::getQValue(const state_vector &s, int a) const {
-  state_vector sp;
   MDPNode *spn;
   double lbVal, ubVal;
   outcome_prob_vector opv;
+  std::vector<state_vector> nextStates;
 
   lbVal = 0;
   ubVal = 0;
-  problem->getOutcomeProbVector(opv, s, a);
+  problem->getOutcomes(opv, nextStates, s, a);
   FOR(o, opv.size()) {
     if (opv(o) > OBS_IS_ZERO_EPS) {
-      problem->getNextState(sp, s, a, o);
+      const state_vector &sp = nextStates[o];
       spn = getNodeOrNull(sp);
       if (maintainLowerBound) {
         lbVal += opv(o) * lowerBound->getValue(sp, spn);
@@ -318,8 +433,13 @@ void BoundPair::writePolicy(const std::string &outFileName,
       reinterpret_cast<MaxPlanesLowerBound *>(lowerBound);
   if (canModifyBounds) {
     mlb->prunePlanes(numBackups);
+    if (mlb->useMaxPlanesLPPruning) {
+      mlb->prunePlanesLP();
+    }
   }
-  mlb->writeToFile(outFileName);
+
+  mlb->writePolicyFile(outFileName,
+                       config->getString("policyType") == "maxPlanesBinary");
 }
 
 };  // namespace zmdp
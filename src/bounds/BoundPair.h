@@ -39,6 +39,7 @@ struct BoundPair : public BoundPairCore {
   bool maintainUpperBound;
   bool useUpperBoundRunTimeActionSelection;
   bool dualPointBounds;
+  bool useLazyExpansion;
   double targetPrecision;
 
   BoundPair(bool _maintainLowerBound, bool _maintainUpperBound,
@@ -50,9 +51,22 @@ struct BoundPair : public BoundPairCore {
 
   MDPNode *getRootNode(void);
   MDPNode *getNode(const state_vector &s);
+  MDPNode *getNodeDeferred(const state_vector &s,
+                           std::vector<MDPNode *> &newNodes);
+  void initNewNodes(const std::vector<MDPNode *> &newNodes);
   MDPNode *getNodeOrNull(const state_vector &s) const;
   void expand(MDPNode &cn);
+  void expandAction(MDPNode &cn, int a);
+  void newQEntries(MDPNode &cn);
+  void expandActionWithOutcomes(MDPNode &cn, int a,
+                                const outcome_prob_vector &opv,
+                                const std::vector<state_vector> &nextStates,
+                                std::vector<MDPNode *> &newNodes);
+  void expandWithOutcomes(
+      MDPNode &cn, const std::vector<outcome_prob_vector> &opvs,
+      const std::vector<std::vector<state_vector> > &allNextStates);
   void update(MDPNode &cn, int *maxUBActionP);
+  void updateConcurrent(MDPNode &cn, int *maxUBActionP);
   int chooseAction(const state_vector &s) const;
   ValueInterval getValueAt(const state_vector &s) const;
   ValueInterval getQValue(const state_vector &s, int a) const;
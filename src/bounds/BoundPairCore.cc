@@ -22,6 +22,7 @@
 #include "BoundPairCore.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -46,6 +47,18 @@ void BoundPairCore::addGetNodeHandler(GetNodeHandler getNodeHandler,
   getNodeHandlers.push_back(GetNodeHandlerStruct(getNodeHandler, handlerData));
 }
 
+void BoundPairCore::updateConcurrent(MDPNode &cn, int *maxUBActionP) {
+  std::lock_guard<RWLock> lk(graphLock);
+  update(cn, maxUBActionP);
+}
+
+std::mutex &BoundPairCore::getNodeLock(const MDPNode &cn) {
+  // nodes come from arena slabs, so the low bits of the address carry
+  // little information
+  uintptr_t x = reinterpret_cast<uintptr_t>(&cn) / sizeof(MDPNode);
+  return nodeLocks[x % BP_NUM_NODE_LOCKS];
+}
+
 // relies on correct cached Q values!
 int BoundPairCore::getMaxUBAction(MDPNode &cn) {
   double bestVal = -99e+20;
@@ -19,14 +19,19 @@
 #define ZMDP_SRC_BOUNDS_BOUNDPAIRCORE_H_
 
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "MDPCache.h"
 #include "MDPModel.h"
+#include "ThreadPool.h"
 
 #define BP_QVAL_UNDEFINED (-99e+20)
 
+// number of mutexes shared out among the nodes by getNodeLock()
+#define BP_NUM_NODE_LOCKS (1024)
+
 using namespace sla;
 
 namespace zmdp {
@@ -48,6 +53,16 @@ struct BoundPairCore {
 
   MDPNode *root;
   MDPHash *lookup;
+  // owns all nodes reachable from root
+  MDPArena arena;
+
+  // synchronization for searches that run several trials at once.
+  // graphLock is held shared while computing backups and exclusively
+  // while modifying the graph or the bounds.  the node locks serialize
+  // updates of each node; a thread may hold at most one of them, and
+  // must take it before graphLock.
+  RWLock graphLock;
+  std::mutex nodeLocks[BP_NUM_NODE_LOCKS];
 
   virtual ~BoundPairCore(void) {}
 
@@ -56,7 +71,15 @@ struct BoundPairCore {
   virtual MDPNode *getRootNode(void) = 0;
   virtual MDPNode *getNode(const state_vector &s) = 0;
   virtual void expand(MDPNode &cn) = 0;
+  // generates the successors of cn for action a, if expand() left it
+  // unexpanded
+  virtual void expandAction(MDPNode &cn, int a) = 0;
   virtual void update(MDPNode &cn, int *maxUBActionP) = 0;
+
+  // thread-safe version of update().  the caller must hold
+  // getNodeLock(cn).  the default holds graphLock exclusively throughout.
+  virtual void updateConcurrent(MDPNode &cn, int *maxUBActionP);
+  std::mutex &getNodeLock(const MDPNode &cn);
   virtual int chooseAction(const state_vector &s) const = 0;
   virtual ValueInterval getValueAt(const state_vector &s) const = 0;
   virtual ValueInterval getQValue(const state_vector &s, int a) const = 0;
@@ -31,7 +31,23 @@ namespace zmdp {
 
 struct IncrementalLowerBound : public AbstractBound {
   virtual void initNodeBound(MDPNode &cn) = 0;
+  // calls initNodeBound() for each of the nodes created by one
+  // expansion; bounds can override it to score all of them in one pass
+  // over their planes
+  virtual void initNodeBounds(const std::vector<MDPNode *> &nodes) {
+    FOR_EACH(cnP, nodes) { initNodeBound(**cnP); }
+  }
   virtual void update(MDPNode &cn) = 0;
+
+  // update() split in two for searches that run several trials at once.
+  // prepareUpdate() does the expensive part of the backup; it may only
+  // read the bound and write cn's Q entries, so several calls can run in
+  // parallel.  commitUpdate() applies the result and must have the bound
+  // to itself.  a bound that cannot split its update returns NULL from
+  // prepareUpdate() and does all the work in commitUpdate().
+  virtual void *prepareUpdate(MDPNode &cn) { return NULL; }
+  virtual void commitUpdate(MDPNode &cn, void *prepared) { update(cn); }
+
   virtual int chooseAction(const state_vector &s) {
     // signal to fall back to default implementation if derived class
     // does not implement chooseAction()
@@ -31,7 +31,26 @@ namespace zmdp {
 
 struct IncrementalUpperBound : public AbstractBound {
   virtual void initNodeBound(MDPNode &cn) = 0;
+  // calls initNodeBound() for each of the nodes created by one
+  // expansion; bounds can override it to score all of them in one pass
+  // over their points
+  virtual void initNodeBounds(const std::vector<MDPNode *> &nodes) {
+    FOR_EACH(cnP, nodes) { initNodeBound(**cnP); }
+  }
   virtual void update(MDPNode &cn, int *maxUBActionP) = 0;
+
+  // for lazy expansion: sets cn.Q[a].ubVal for every action a to an
+  // upper bound that can be computed without generating the successors
+  // of cn.  update() must then expand (with BoundPairCore::expandAction())
+  // every action that it backs up.  a bound that can't do this returns
+  // false, and nodes are expanded in full.
+  virtual bool setInitialQBounds(MDPNode &cn) { return false; }
+
+  // split version of update(); see IncrementalLowerBound::prepareUpdate()
+  virtual void *prepareUpdate(MDPNode &cn, int *maxUBActionP) { return NULL; }
+  virtual void commitUpdate(MDPNode &cn, void *prepared, int *maxUBActionP) {
+    update(cn, maxUBActionP);
+  }
 };
 
 };  // namespace zmdp
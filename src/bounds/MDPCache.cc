@@ -20,10 +20,13 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <new>
 #include <queue>
 
 #include "AbstractBound.h"
@@ -35,15 +38,123 @@ using namespace MatrixUtils;
 
 namespace zmdp {
 
+MDPArena::MDPArena(void)
+    : numNodesInLastSlab(MDP_ARENA_NODES_PER_SLAB),
+      bytesLeftInLastSlab(0),
+      nextByte(NULL),
+      numQEntries(0),
+      numEdges(0),
+      bytesUsed(0),
+      bytesAllocated(0) {}
+
+MDPArena::~MDPArena(void) { release(); }
+
+MDPNode *MDPArena::newNode(void) {
+  if (numNodesInLastSlab == MDP_ARENA_NODES_PER_SLAB) {
+    nodeSlabs.push_back(static_cast<MDPNode *>(
+        operator new(MDP_ARENA_NODES_PER_SLAB * sizeof(MDPNode))));
+    numNodesInLastSlab = 0;
+    bytesAllocated += MDP_ARENA_NODES_PER_SLAB * sizeof(MDPNode);
+  }
+  MDPNode *cn = new (&nodeSlabs.back()[numNodesInLastSlab]) MDPNode();
+  numNodesInLastSlab++;
+  bytesUsed += sizeof(MDPNode);
+  return cn;
+}
+
+MDPArraySlice<MDPQEntry> MDPArena::newQEntries(int numActions) {
+  MDPQEntry *elts = static_cast<MDPQEntry *>(
+      allocBytes(numActions * sizeof(MDPQEntry), __alignof__(MDPQEntry)));
+  FOR(a, numActions) { new (&elts[a]) MDPQEntry(); }
+  numQEntries += numActions;
+  return MDPArraySlice<MDPQEntry>(elts, numActions);
+}
+
+MDPEdgeArray MDPArena::newEdges(int numOutcomes) {
+  MDPEdge *elts = static_cast<MDPEdge *>(
+      allocBytes(numOutcomes * sizeof(MDPEdge), __alignof__(MDPEdge)));
+  memset(elts, 0, numOutcomes * sizeof(MDPEdge));
+  numEdges += numOutcomes;
+  MDPEdgeArray result;
+  result.elts = elts;
+  result.n = numOutcomes;
+  return result;
+}
+
+void *MDPArena::allocBytes(size_t numBytes, size_t alignment) {
+  size_t pad = (alignment - reinterpret_cast<size_t>(nextByte) % alignment) %
+               alignment;
+  if (pad + numBytes > bytesLeftInLastSlab) {
+    // start a new slab (oversized requests get a slab of their own)
+    size_t slabSize = std::max(numBytes, static_cast<size_t>(MDP_ARENA_BYTES_PER_SLAB));
+    // operator new memory is suitably aligned for any type
+    nextByte = static_cast<char *>(operator new(slabSize));
+    byteSlabs.push_back(nextByte);
+    bytesLeftInLastSlab = slabSize;
+    bytesAllocated += slabSize;
+    pad = 0;
+  }
+  void *result = nextByte + pad;
+  nextByte += pad + numBytes;
+  bytesLeftInLastSlab -= pad + numBytes;
+  bytesUsed += numBytes;
+  return result;
+}
+
+void MDPArena::release(void) {
+  // Q entries and edges are POD, but nodes own their state vectors
+  FOR(i, nodeSlabs.size()) {
+    size_t n = (i + 1 == nodeSlabs.size()) ? numNodesInLastSlab
+                                           : MDP_ARENA_NODES_PER_SLAB;
+    FOR(j, n) { nodeSlabs[i][j].~MDPNode(); }
+    operator delete(nodeSlabs[i]);
+  }
+  FOR_EACH(slab, byteSlabs) { operator delete(*slab); }
+  nodeSlabs.clear();
+  byteSlabs.clear();
+  numNodesInLastSlab = MDP_ARENA_NODES_PER_SLAB;
+  bytesLeftInLastSlab = 0;
+  nextByte = NULL;
+  numQEntries = 0;
+  numEdges = 0;
+  bytesUsed = 0;
+  bytesAllocated = 0;
+}
+
+size_t MDPArena::getNumNodes(void) const {
+  if (nodeSlabs.empty()) return 0;
+  return (nodeSlabs.size() - 1) * MDP_ARENA_NODES_PER_SLAB +
+         numNodesInLastSlab;
+}
+
+void MDPArena::printMemoryReport(FILE *out, const char *label) const {
+  // state vector storage is owned by the nodes but lives outside the arena
+  size_t stateBytes = 0;
+  FOR(i, nodeSlabs.size()) {
+    size_t n = (i + 1 == nodeSlabs.size()) ? numNodesInLastSlab
+                                           : MDP_ARENA_NODES_PER_SLAB;
+    FOR(j, n) {
+      stateBytes += nodeSlabs[i][j].s.data.storage_bytes();
+    }
+  }
+  fprintf(out,
+          "%s: %d nodes, %d Q entries, %d edges; arena %.1f MB used of "
+          "%.1f MB allocated; state vectors %.1f MB\n",
+          label, static_cast<int>(getNumNodes()),
+          static_cast<int>(numQEntries), static_cast<int>(numEdges),
+          bytesUsed / 1048576.0, bytesAllocated / 1048576.0,
+          stateBytes / 1048576.0);
+}
+
 int getNodeCacheStorage(const MDPHash *lookup, int whichMetric) {
   int eltCount = 0;
   int entryCount = 0;
   FOR_EACH(pr, *lookup) {
-    if (!pr->second->isFringe()) {
+    if (!pr->value->isFringe()) {
       eltCount++;
       // the number of entries we count for each belief/value pair is
       // the number of entries in the belief plus one for the value
-      entryCount += pr->second->s.filled() + 1;
+      entryCount += pr->value->s.filled() + 1;
     }
   }
 
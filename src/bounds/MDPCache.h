@@ -22,36 +22,75 @@
 #ifndef ZMDP_SRC_BOUNDS_MDPCACHE_H_
 #define ZMDP_SRC_BOUNDS_MDPCACHE_H_
 
+#include <stdio.h>
+
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include "BeliefHash.h"
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
 
+// number of nodes per node slab, and size of each byte slab used for Q
+// entries and edges
+#define MDP_ARENA_NODES_PER_SLAB (4096)
+#define MDP_ARENA_BYTES_PER_SLAB (1 << 20)
+
 using namespace sla;
 
 namespace zmdp {
 
 struct MDPNode;
 
+// fixed-size array carved out of an MDPArena.  supports the subset of the
+// std::vector interface that callers use.
+template <class T>
+struct MDPArraySlice {
+  T *elts;
+  unsigned int n;
+
+  MDPArraySlice(void) : elts(NULL), n(0) {}
+  MDPArraySlice(T *_elts, unsigned int _n) : elts(_elts), n(_n) {}
+
+  size_t size(void) const { return n; }
+  bool empty(void) const { return 0 == n; }
+  T &operator[](unsigned int i) { return elts[i]; }
+  const T &operator[](unsigned int i) const { return elts[i]; }
+  T *begin(void) const { return elts; }
+  T *end(void) const { return elts + n; }
+};
+
 struct MDPEdge {
   double obsProb;
   MDPNode *nextState;
 };
 
+// the outcome edges of a Q entry, stored inline and contiguously.
+// outcomes with negligible probability have nextState == NULL, and
+// indexing returns NULL for them, as with the old vector of edge pointers.
+struct MDPEdgeArray : public MDPArraySlice<MDPEdge> {
+  MDPEdge *operator[](unsigned int o) const {
+    return (NULL == elts[o].nextState) ? NULL : &elts[o];
+  }
+};
+
 struct MDPQEntry {
   double immediateReward;
-  std::vector<MDPEdge *> outcomes;
+  MDPEdgeArray outcomes;
   double lbVal, ubVal;
 
   size_t getNumOutcomes(void) const { return outcomes.size(); }
+  // false until the successors for this action have been generated.
+  // with lazy expansion (see useLazyExpansion in zmdp.config) a node's
+  // Q entries are created up front but only some actions are expanded.
+  bool isExpanded(void) const { return !outcomes.empty(); }
 };
 
 struct MDPNode {
   state_vector s;
   bool isTerminal;
-  std::vector<MDPQEntry> Q;
+  MDPArraySlice<MDPQEntry> Q;
   double lbVal, ubVal;
   // these fields are used for different purposes depending on the search
   //   strategy and value function representation
@@ -63,7 +102,41 @@ struct MDPNode {
   MDPNode &getNextState(int a, int o) { return *Q[a].outcomes[o]->nextState; }
 };
 
-typedef EXT_NAMESPACE::hash_map<std::string, MDPNode *> MDPHash;
+// Bump allocator that owns all the nodes, Q entries and edges of a search
+// graph.  Nodes live in fixed-size slabs of their own; Q entries and edges
+// are packed into shared byte slabs, so the edges of a Q entry (and the Q
+// entries of a node) are adjacent in memory.  Nothing is freed
+// individually; release() tears down the whole graph at once.
+struct MDPArena {
+  std::vector<MDPNode *> nodeSlabs;
+  std::vector<char *> byteSlabs;
+  size_t numNodesInLastSlab;
+  size_t bytesLeftInLastSlab;
+  char *nextByte;
+  size_t numQEntries, numEdges;
+  size_t bytesUsed, bytesAllocated;
+
+  MDPArena(void);
+  ~MDPArena(void);
+
+  // returns a default-initialized node
+  MDPNode *newNode(void);
+  // returns zeroed arrays of Q entries and edges
+  MDPArraySlice<MDPQEntry> newQEntries(int numActions);
+  MDPEdgeArray newEdges(int numOutcomes);
+
+  // frees every node, Q entry and edge allocated so far
+  void release(void);
+
+  size_t getNumNodes(void) const;
+  void printMemoryReport(FILE *out, const char *label) const;
+
+ protected:
+  void *allocBytes(size_t numBytes, size_t alignment);
+};
+
+// maps each node's state vector to the node
+typedef BeliefHash<MDPNode *> MDPHash;
 
 int getNodeCacheStorage(const MDPHash *lookup, int whichMetric);
 
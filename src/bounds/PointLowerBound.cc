@@ -102,6 +102,7 @@ int PointLowerBound::getStorage(int whichMetric) const {
   switch (whichMetric) {
     case ZMDP_S_NUM_ELTS:
     case ZMDP_S_NUM_ENTRIES:
+    case ZMDP_S_NUM_INDEX_ENTRIES:
       return initBound->getStorage(whichMetric);
 
     case ZMDP_S_NUM_ELTS_TABULAR:
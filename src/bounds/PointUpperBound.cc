@@ -174,6 +174,7 @@ int PointUpperBound::getStorage(int whichMetric) const {
   switch (whichMetric) {
     case ZMDP_S_NUM_ELTS:
     case ZMDP_S_NUM_ENTRIES:
+    case ZMDP_S_NUM_INDEX_ENTRIES:
       return initBound->getStorage(whichMetric);
 
     case ZMDP_S_NUM_ELTS_TABULAR:
@@ -54,41 +54,38 @@ void RelaxUBInitializer::setup(double targetPrecision) {
 }
 
 MDPNode *RelaxUBInitializer::getNode(const state_vector &s) {
-  string hs = hashable(s);
-  MDPHash::iterator pr = lookup->find(hs);
-  if (lookup->end() == pr) {
+  uint64_t hs = hashStateVector(s);
+  MDPNode **pr = lookup->findHashed(s, hs);
+  if (NULL == pr) {
     // create a new fringe node
-    MDPNode &cn = *(new MDPNode);
+    MDPNode &cn = *arena.newNode();
     cn.s = s;
     cn.lbVal = initLowerBound->getValue(s, NULL);
     cn.ubVal = initUpperBound->getValue(s, NULL);
-    (*lookup)[hs] = &cn;
+    lookup->insertHashed(&cn.s, &cn, hs);
     return &cn;
   } else {
     // return existing node
-    return pr->second;
+    return *pr;
   }
 }
 
 void RelaxUBInitializer::expand(MDPNode &cn) {
   // set up successors for this fringe node (possibly creating new fringe nodes)
   outcome_prob_vector opv;
-  state_vector sp;
-  cn.Q.resize(problem->getNumActions());
+  std::vector<state_vector> nextStates;
+  cn.Q = arena.newQEntries(problem->getNumActions());
   FOR(a, problem->getNumActions()) {
     MDPQEntry &Qa = cn.Q[a];
     Qa.immediateReward = problem->getReward(cn.s, a);
-    problem->getOutcomeProbVector(opv, cn.s, a);
-    Qa.outcomes.resize(opv.size());
+    problem->getOutcomes(opv, nextStates, cn.s, a);
+    Qa.outcomes = arena.newEdges(opv.size());
     FOR(o, opv.size()) {
       double oprob = opv(o);
       if (oprob > OBS_IS_ZERO_EPS) {
-        MDPEdge *e = new MDPEdge();
-        Qa.outcomes[o] = e;
-        e->obsProb = oprob;
-        e->nextState = getNode(problem->getNextState(sp, cn.s, a, o));
-      } else {
-        Qa.outcomes[o] = NULL;
+        MDPEdge &e = Qa.outcomes.elts[o];
+        e.obsProb = oprob;
+        e.nextState = getNode(nextStates[o]);
       }
     }
   }
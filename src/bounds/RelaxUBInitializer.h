@@ -29,6 +29,7 @@ struct RelaxUBInitializer : public AbstractBound {
   MDP *problem;
   MDPNode *root;
   MDPHash *lookup;
+  MDPArena arena;
   AbstractBound *initLowerBound;
   AbstractBound *initUpperBound;
   const ZMDPConfig *config;
@@ -0,0 +1,158 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_COMMON_BELIEFHASH_H_
+#define ZMDP_SRC_COMMON_BELIEFHASH_H_
+
+#include <math.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "slaMatrixUtils.h"
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+
+using namespace sla;
+
+namespace zmdp {
+
+// rounds a vector entry the same way HASH_VECTOR_PRECISION does, so two
+// vectors are considered equal exactly when their hashable() strings
+// would have matched
+inline int64_t quantizeHashValue(double x) {
+  return static_cast<int64_t>(llround(x * HASH_VECTOR_SCALE));
+}
+
+// 64-bit hash over the quantized (index, value) pairs of s
+inline uint64_t hashStateVector(const state_vector &s) {
+  uint64_t h = 0xcbf29ce484222325ULL ^ s.filled();
+  FOR_CV(s) {
+    uint64_t x = (static_cast<uint64_t>(CV_INDEX(s)) << 32) ^
+                 static_cast<uint64_t>(quantizeHashValue(CV_VAL(s)));
+    // splitmix64 finalizer on each pair, then fold into h
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    h = (h ^ x) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+inline bool stateVectorsMatch(const state_vector &a, const state_vector &b) {
+  if (a.filled() != b.filled()) return false;
+  typeof(a.data.begin()) ai = a.data.begin();
+  typeof(b.data.begin()) bi = b.data.begin();
+  for (; ai != a.data.end(); ai++, bi++) {
+    if (ai->index != bi->index) return false;
+    if (quantizeHashValue(ai->value) != quantizeHashValue(bi->value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Maps state vectors to values of type T.  Replaces a hash_map keyed on
+// hashable(s) strings: the table keeps only a pointer to a state
+// vector owned by the caller (which must outlive the entry), and uses
+// open addressing over a dense entry array, so lookups do no string
+// formatting or allocation.  Entries are never removed except by clear().
+template <class T>
+struct BeliefHash {
+  struct Entry {
+    uint64_t hash;
+    const state_vector *key;
+    T value;
+  };
+  typedef typename std::vector<Entry>::iterator iterator;
+  typedef typename std::vector<Entry>::const_iterator const_iterator;
+
+  std::vector<Entry> entries;
+  // slots[i] is 0 if empty, otherwise 1 + an index into entries
+  std::vector<uint32_t> slots;
+
+  BeliefHash(void) : slots(16, 0) {}
+
+  size_t size(void) const { return entries.size(); }
+  iterator begin(void) { return entries.begin(); }
+  iterator end(void) { return entries.end(); }
+  const_iterator begin(void) const { return entries.begin(); }
+  const_iterator end(void) const { return entries.end(); }
+
+  void clear(void) {
+    entries.clear();
+    slots.assign(16, 0);
+  }
+
+  // returns a pointer to the value stored for s, or NULL if s is not
+  // in the table
+  T *find(const state_vector &s) { return findHashed(s, hashStateVector(s)); }
+  const T *find(const state_vector &s) const {
+    return const_cast<BeliefHash *>(this)->find(s);
+  }
+
+  T *findHashed(const state_vector &s, uint64_t h) {
+    size_t mask = slots.size() - 1;
+    for (size_t i = h & mask; 0 != slots[i]; i = (i + 1) & mask) {
+      Entry &e = entries[slots[i] - 1];
+      if (e.hash == h && stateVectorsMatch(*e.key, s)) return &e.value;
+    }
+    return NULL;
+  }
+
+  // adds an entry for *key, which must not already be in the table
+  void insert(const state_vector *key, const T &value) {
+    insertHashed(key, value, hashStateVector(*key));
+  }
+
+  void insertHashed(const state_vector *key, const T &value, uint64_t h) {
+    if (2 * (entries.size() + 1) > slots.size()) {
+      rehash(2 * slots.size());
+    }
+    Entry e;
+    e.hash = h;
+    e.key = key;
+    e.value = value;
+    entries.push_back(e);
+    placeSlot(h, entries.size());
+  }
+
+  // approximate memory used by the table itself (not the keys)
+  size_t getStorageBytes(void) const {
+    return entries.capacity() * sizeof(Entry) +
+           slots.capacity() * sizeof(uint32_t);
+  }
+
+ protected:
+  void placeSlot(uint64_t h, uint32_t slotVal) {
+    size_t mask = slots.size() - 1;
+    size_t i = h & mask;
+    while (0 != slots[i]) i = (i + 1) & mask;
+    slots[i] = slotVal;
+  }
+
+  void rehash(size_t newSize) {
+    slots.assign(newSize, 0);
+    FOR(j, entries.size()) { placeSlot(entries[j].hash, j + 1); }
+  }
+};
+
+};  // namespace zmdp
+
+#endif  // ZMDP_SRC_COMMON_BELIEFHASH_H_
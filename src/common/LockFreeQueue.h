@@ -0,0 +1,84 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_COMMON_LOCKFREEQUEUE_H_
+#define ZMDP_SRC_COMMON_LOCKFREEQUEUE_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace zmdp {
+
+// Unbounded queue of pointers with any number of producers and a single
+// consumer.  push() never blocks; the consumer takes everything queued
+// so far with popAll().  Internally a linked stack: push() is a CAS on
+// the head, and popAll() swaps the whole list out at once, so no node is
+// ever examined by a producer after the consumer owns it (no ABA).
+template <class T>
+class LockFreeQueue {
+ public:
+  LockFreeQueue(void) : head(NULL) {}
+  ~LockFreeQueue(void) {
+    Node *n = head.load();
+    while (NULL != n) {
+      Node *next = n->next;
+      delete n;
+      n = next;
+    }
+  }
+
+  void push(T *item) {
+    Node *n = new Node();
+    n->item = item;
+    n->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(n->next, n, std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+    }
+  }
+
+  // appends all queued items to result, oldest first.  only one thread
+  // may call popAll().
+  void popAll(std::vector<T *> &result) {
+    Node *n = head.exchange(NULL, std::memory_order_acquire);
+    size_t start = result.size();
+    while (NULL != n) {
+      result.push_back(n->item);
+      Node *next = n->next;
+      delete n;
+      n = next;
+    }
+    std::reverse(result.begin() + start, result.end());
+  }
+
+  bool empty(void) const {
+    return NULL == head.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  struct Node {
+    T *item;
+    Node *next;
+  };
+  std::atomic<Node *> head;
+};
+
+}  // namespace zmdp
+
+#endif  // ZMDP_SRC_COMMON_LOCKFREEQUEUE_H_
@@ -42,10 +42,50 @@ struct MDP {
   int numStateDimensions, numActions;
   double discount;
 
+  // if the model's states were renumbered when it was loaded (see
+  // compactReachableStates in zmdp.config), originalStateIds[i] is the
+  // id in the model file of state vector entry i, and compactStateIds
+  // is the inverse map, with -1 for states that were dropped.  both are
+  // empty otherwise.
+  std::vector<int> originalStateIds, compactStateIds;
+
+  // likewise, if duplicate actions were collapsed (see
+  // aggregateObservationsAndActions in zmdp.config), originalActionIds[a]
+  // is the id in the model file of action a, and compactActionIds maps
+  // each action in the model file to the action that stands in for it.
+  // if equivalent outcomes were merged, mergedOutcomeIds[a][o] is the
+  // outcome that stands in for outcome o of action a.  all are empty
+  // otherwise.
+  std::vector<int> originalActionIds, compactActionIds;
+  std::vector<std::vector<int> > mergedOutcomeIds;
+
   virtual ~MDP(void) {}
 
   int getNumStateDimensions(void) const { return numStateDimensions; }
+  int getOriginalStateId(int i) const {
+    return originalStateIds.empty() ? i : originalStateIds[i];
+  }
+  // returns -1 if the state was dropped or is out of range
+  int getCompactStateId(int i) const {
+    if (compactStateIds.empty()) return i;
+    if (i < 0 || i >= static_cast<int>(compactStateIds.size())) return -1;
+    return compactStateIds[i];
+  }
   int getNumActions(void) const { return numActions; }
+  int getNumOriginalActions(void) const {
+    return compactActionIds.empty() ? numActions : compactActionIds.size();
+  }
+  int getOriginalActionId(int a) const {
+    return originalActionIds.empty() ? a : originalActionIds[a];
+  }
+  // returns -1 if the action is out of range
+  int getCompactActionId(int a) const {
+    if (a < 0 || a >= getNumOriginalActions()) return -1;
+    return compactActionIds.empty() ? a : compactActionIds[a];
+  }
+  int getMergedOutcomeId(int a, int o) const {
+    return mergedOutcomeIds.empty() ? o : mergedOutcomeIds[a][o];
+  }
   double getDiscount(void) const { return discount; }
 
   // returns the initial state
@@ -65,6 +105,38 @@ struct MDP {
   virtual state_vector &getNextState(state_vector &result,
                                      const state_vector &s, int a, int o) = 0;
 
+  // sets opv to be the vector of outcome probabilities when from state
+  // s action a is selected, and sets nextStates[o] to be the next state
+  // for every outcome o with opv(o) > OBS_IS_ZERO_EPS (entries for
+  // negligible outcomes are left empty).  the default implementation
+  // just calls getOutcomeProbVector() and getNextState(); models that
+  // can share work across outcomes should override it.
+  virtual void getOutcomes(outcome_prob_vector &opv,
+                           std::vector<state_vector> &nextStates,
+                           const state_vector &s, int a) {
+    getOutcomeProbVector(opv, s, a);
+    nextStates.resize(opv.size());
+    FOR(o, opv.size()) {
+      if (opv(o) > OBS_IS_ZERO_EPS) {
+        getNextState(nextStates[o], s, a, o);
+      } else {
+        nextStates[o].clear();
+      }
+    }
+  }
+
+  // calls getOutcomes() for every action a, storing the results in
+  // opvs[a] and nextStates[a].  models that can share work across
+  // actions should override it.
+  virtual void getAllOutcomes(
+      std::vector<outcome_prob_vector> &opvs,
+      std::vector<std::vector<state_vector> > &nextStates,
+      const state_vector &s) {
+    opvs.resize(numActions);
+    nextStates.resize(numActions);
+    FOR(a, numActions) { getOutcomes(opvs[a], nextStates[a], s, a); }
+  }
+
   // returns the expected immediate reward when from state s action a is
   // selected
   virtual double getReward(const state_vector &s, int a) = 0;
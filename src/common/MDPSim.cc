@@ -76,7 +76,8 @@ void MDPSim::performAction(int a) {
 
   // log transition information
   if (simOutFile) {
-    (*simOutFile) << "sim: [" << sparseRep(state) << "] " << a << " ["
+    (*simOutFile) << "sim: [" << sparseRep(state) << "] "
+                  << model->getOriginalActionId(a) << " ["
                   << sparseRep(sp) << "] " << o << endl;
   }
 
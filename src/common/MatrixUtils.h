@@ -73,12 +73,14 @@ void calc_avg_stdev_collection(_ForwardIterator start, _ForwardIterator end,
 
 // Returns a nice printable representation for big vectors (sorted in order
 //   of decreasing absolute value, with the index of each value labeled).
-std::string sparseRep(const cvector &v, int num_to_print = 4);
+template <class V>
+std::string sparseRep(const basic_cvector<V> &v, int num_to_print = 4);
 std::string sparseRep(const dvector &v);
 
 // Returns a full printable representation of v.  Probably not best to use
 //   with large vectors.
-std::string denseRep(const cvector &v);
+template <class V>
+std::string denseRep(const basic_cvector<V> &v);
 std::string denseRep(const dvector &v);
 
 /**********************************************************************
@@ -305,7 +307,8 @@ struct ValGreater {
   }
 };
 
-inline std::string sparseRep(const cvector &v, int num_to_print) {
+template <class V>
+inline std::string sparseRep(const basic_cvector<V> &v, int num_to_print) {
   std::vector<IndPair> sorted;
   FOR_CV(v) { sorted.push_back(IndPair(CV_INDEX(v), CV_VAL(v))); }
   sort(sorted.begin(), sorted.end(), AbsValGreater());
@@ -337,7 +340,8 @@ inline std::string sparseRep(const dvector &v) {
   return out.str();
 }
 
-inline std::string denseRep(const cvector &v) {
+template <class V>
+inline std::string denseRep(const basic_cvector<V> &v) {
   std::ostringstream out;
   FOR(i, v.size()) { out << v(i) << " "; }
   return out.str();
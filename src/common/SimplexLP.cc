@@ -0,0 +1,136 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include "SimplexLP.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "zmdpCommonDefs.h"
+
+// entries smaller than this are treated as zero when choosing pivots
+#define SIMPLEX_EPS (1e-11)
+
+// solve() gives up after this many pivots per row/column
+#define SIMPLEX_MAX_PIVOTS_FACTOR (50)
+
+// after this many pivots in a row that don't improve the objective,
+// switch from Dantzig's rule to Bland's rule
+#define SIMPLEX_MAX_DEGENERATE_PIVOTS (50)
+
+namespace zmdp {
+
+void SimplexLP::init(int _numRows, int _numCols) {
+  numRows = _numRows;
+  numCols = _numCols;
+  tab.assign((numRows + 1) * (numCols + 1), 0.0);
+  colVar.resize(numCols);
+  FOR(j, numCols) { colVar[j] = j; }
+  rowVar.resize(numRows);
+  FOR(i, numRows) { rowVar[i] = numCols + i; }
+}
+
+// exchanges the basic variable of row r with the nonbasic variable of
+// column j
+void SimplexLP::pivot(int r, int j) {
+  int w = numCols + 1;
+  double *pr = &tab[r * w];
+  double p = pr[j];
+  FOR(k, w) {
+    if (static_cast<int>(k) != j) pr[k] /= p;
+  }
+  pr[j] = 1.0 / p;
+
+  FOR(i, numRows + 1) {
+    if (static_cast<int>(i) == r) continue;
+    double *pi = &tab[i * w];
+    double f = pi[j];
+    if (0.0 == f) continue;
+    FOR(k, w) { pi[k] -= f * pr[k]; }
+    pi[j] = -f * pr[j];
+  }
+
+  int tmp = rowVar[r];
+  rowVar[r] = colVar[j];
+  colVar[j] = tmp;
+}
+
+SimplexResult SimplexLP::solve(double stopValue) {
+  int w = numCols + 1;
+  const double *obj = &tab[numRows * w];
+  int maxPivots = SIMPLEX_MAX_PIVOTS_FACTOR * (numRows + numCols + 1);
+  int numDegenerate = 0;
+  double lastObjective = getObjective();
+
+  FOR(numPivots, maxPivots) {
+    if (getObjective() > stopValue) return SIMPLEX_STOPPED;
+    if (getObjective() > lastObjective) {
+      numDegenerate = 0;
+      lastObjective = getObjective();
+    } else if (numPivots > 0) {
+      numDegenerate++;
+    }
+    bool useBland = (numDegenerate >= SIMPLEX_MAX_DEGENERATE_PIVOTS);
+
+    // Dantzig's rule picks the variable with the most negative reduced
+    // cost.  Bland's rule picks the lowest-numbered variable that
+    // improves the objective; it is slower but cannot cycle.
+    int j = -1;
+    FOR(k, numCols) {
+      if (obj[k] >= -SIMPLEX_EPS) continue;
+      if (-1 == j || (useBland ? (colVar[k] < colVar[j]) : (obj[k] < obj[j]))) {
+        j = k;
+      }
+    }
+    if (-1 == j) return SIMPLEX_OPTIMAL;
+
+    // ratio test; ties go to the lowest-numbered leaving variable
+    int r = -1;
+    double minRatio = 0.0;
+    FOR(i, numRows) {
+      double a = tab[i * w + j];
+      if (a <= SIMPLEX_EPS) continue;
+      double ratio = tab[i * w + numCols] / a;
+      if (-1 == r || ratio < minRatio ||
+          (ratio == minRatio && rowVar[i] < rowVar[r])) {
+        r = i;
+        minRatio = ratio;
+      }
+    }
+    if (-1 == r) return SIMPLEX_UNBOUNDED;
+
+    pivot(r, j);
+  }
+  return SIMPLEX_ITERATION_LIMIT;
+}
+
+void SimplexLP::getSolution(std::vector<double> &x) const {
+  int w = numCols + 1;
+  x.assign(numCols, 0.0);
+  FOR(i, numRows) {
+    if (rowVar[i] < numCols) {
+      x[rowVar[i]] = tab[i * w + numCols];
+    }
+  }
+}
+
+}  // namespace zmdp
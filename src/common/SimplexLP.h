@@ -0,0 +1,79 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_COMMON_SIMPLEXLP_H_
+#define ZMDP_SRC_COMMON_SIMPLEXLP_H_
+
+#include <vector>
+
+namespace zmdp {
+
+enum SimplexResult {
+  SIMPLEX_OPTIMAL,
+  SIMPLEX_UNBOUNDED,
+  // the objective passed the stopValue given to solve()
+  SIMPLEX_STOPPED,
+  // gave up after too many pivots (should only happen with bad round-off)
+  SIMPLEX_ITERATION_LIMIT
+};
+
+// Small dense simplex solver for LPs of the form
+//
+//   maximize c'x  subject to  Ax <= b,  x >= 0
+//
+// where b >= 0, so that x = 0 is a feasible starting point and no
+// phase 1 is needed.  The tableau is stored in exchange (Tucker) form,
+// one row per constraint plus the objective row, with no slack columns.
+// Pivots follow Dantzig's rule, falling back to Bland's rule (which
+// cannot cycle) after a run of degenerate pivots; the LPs that come up
+// when pruning planes are highly degenerate.
+struct SimplexLP {
+  int numRows;
+  int numCols;
+  // (numRows + 1) x (numCols + 1), row-major.  row i < numRows is
+  // [A(i,:) b(i)]; the last row is [-c' objective].
+  std::vector<double> tab;
+  // the variable in each row and column: 0 .. numCols-1 are the x
+  // variables and numCols .. numCols+numRows-1 are the slacks
+  std::vector<int> rowVar;
+  std::vector<int> colVar;
+
+  SimplexLP(void) : numRows(0), numCols(0) {}
+
+  // sets up an LP with all coefficients zero
+  void init(int _numRows, int _numCols);
+
+  double &A(int i, int j) { return tab[i * (numCols + 1) + j]; }
+  double &b(int i) { return tab[i * (numCols + 1) + numCols]; }
+  void setObjective(int j, double cj) {
+    tab[numRows * (numCols + 1) + j] = -cj;
+  }
+  double getObjective(void) const { return tab.back(); }
+
+  // runs the simplex method.  if the objective of the current vertex
+  // exceeds stopValue, stops early and returns SIMPLEX_STOPPED.
+  SimplexResult solve(double stopValue = 99e+20);
+
+  // x = the current vertex
+  void getSolution(std::vector<double> &x) const;
+
+  void pivot(int r, int j);
+};
+
+}  // namespace zmdp
+
+#endif  // ZMDP_SRC_COMMON_SIMPLEXLP_H_
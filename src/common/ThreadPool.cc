@@ -0,0 +1,235 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include "ThreadPool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "zmdpCommonDefs.h"
+
+// number of times an idle worker polls the queues before going to sleep
+#define TP_IDLE_SPINS (200)
+
+namespace zmdp {
+
+/**********************************************************************
+ * THREAD POOL
+ **********************************************************************/
+
+// index of the pool worker running on this thread, or -1 if this thread
+// does not belong to the pool
+static thread_local int currentWorkerG = -1;
+
+ThreadPool threadPoolG;
+
+ThreadPool::ThreadPool(void) : numQueued(0), stopping(false) {}
+
+ThreadPool::~ThreadPool(void) { stopWorkers(); }
+
+void ThreadPool::setNumThreads(int numThreads) {
+  if (numThreads < 0) {
+    fprintf(stderr, "ERROR: numThreads must be non-negative (got %d)\n",
+            numThreads);
+    exit(EXIT_FAILURE);
+  }
+  if (0 == numThreads) {
+    numThreads = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  stopWorkers();
+  int numWorkers = numThreads - 1;
+  FOR(w, numWorkers) { queues.push_back(new WorkerQueue()); }
+  FOR(w, numWorkers) {
+    workers.push_back(std::thread(&ThreadPool::workerMain, this, w));
+  }
+}
+
+void ThreadPool::stopWorkers(void) {
+  {
+    std::lock_guard<std::mutex> lk(sleepLock);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  FOR_EACH(threadP, workers) {
+    // exit() may be called from inside a worker; it cannot join itself
+    if (currentWorkerG >= 0) {
+      threadP->detach();
+    } else {
+      threadP->join();
+    }
+  }
+  workers.clear();
+  FOR_EACH(queueP, queues) { delete *queueP; }
+  queues.clear();
+  numQueued = 0;
+  stopping = false;
+}
+
+void ThreadPool::parallelFor(int n, const std::function<void(int)> &body) {
+  if (workers.empty() || n <= 1) {
+    FOR(i, n) { body(i); }
+    return;
+  }
+
+  JobPtr job(new Job());
+  job->body = &body;
+  job->n = n;
+  job->next = 0;
+  job->numDone = 0;
+
+  // hand out one copy of the job per extra thread that could usefully
+  // help.  a worker puts the copies on its own queue, to be stolen by
+  // idle workers; other threads spread them across the workers.
+  int numWorkers = workers.size();
+  int numCopies = std::min(n - 1, numWorkers);
+  FOR(k, numCopies) {
+    int q = (currentWorkerG >= 0) ? currentWorkerG : k;
+    std::lock_guard<std::mutex> lk(queues[q]->lock);
+    queues[q]->jobs.push_back(job);
+  }
+  {
+    std::lock_guard<std::mutex> lk(sleepLock);
+    numQueued += numCopies;
+  }
+  if (1 == numCopies) {
+    wakeup.notify_one();
+  } else {
+    wakeup.notify_all();
+  }
+
+  // the caller works on its own job until every iteration is claimed,
+  // then waits for the helpers to finish theirs
+  runJob(*job);
+  while (job->numDone.load(std::memory_order_acquire) < n) {
+    std::this_thread::yield();
+  }
+}
+
+void ThreadPool::runJob(Job &job) {
+  int numRun = 0;
+  int i;
+  while ((i = job.next.fetch_add(1, std::memory_order_relaxed)) < job.n) {
+    (*job.body)(i);
+    numRun++;
+  }
+  // after numDone reaches n the caller may return, so job.body must not
+  // be touched again
+  if (numRun > 0) {
+    job.numDone.fetch_add(numRun, std::memory_order_release);
+  }
+}
+
+bool ThreadPool::popJob(int w, JobPtr &job) {
+  int numWorkers = queues.size();
+  FOR(k, numWorkers) {
+    int q = (w + k) % numWorkers;
+    WorkerQueue &wq = *queues[q];
+    std::lock_guard<std::mutex> lk(wq.lock);
+    if (wq.jobs.empty()) continue;
+    if (q == w) {
+      // newest job from our own queue
+      job = wq.jobs.back();
+      wq.jobs.pop_back();
+    } else {
+      // oldest job from someone else's queue
+      job = wq.jobs.front();
+      wq.jobs.pop_front();
+    }
+    break;
+  }
+  if (!job) return false;
+
+  std::lock_guard<std::mutex> lk(sleepLock);
+  numQueued--;
+  return true;
+}
+
+void ThreadPool::workerMain(int w) {
+  currentWorkerG = w;
+  int numIdleSpins = 0;
+  while (1) {
+    JobPtr job;
+    if (popJob(w, job)) {
+      runJob(*job);
+      numIdleSpins = 0;
+      continue;
+    }
+    if (numIdleSpins < TP_IDLE_SPINS) {
+      numIdleSpins++;
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lk(sleepLock);
+    while (!stopping && numQueued <= 0) {
+      wakeup.wait(lk);
+    }
+    if (stopping) return;
+    numIdleSpins = 0;
+  }
+}
+
+/**********************************************************************
+ * RWLOCK
+ **********************************************************************/
+
+void RWLock::lock(void) {
+  std::unique_lock<std::mutex> lk(m);
+  numWritersWaiting++;
+  while (writing || numReaders > 0) {
+    readersDone.wait(lk);
+  }
+  numWritersWaiting--;
+  writing = true;
+}
+
+void RWLock::unlock(void) {
+  {
+    std::lock_guard<std::mutex> lk(m);
+    writing = false;
+  }
+  // wake the next writer, if any, and any readers held back for it
+  readersDone.notify_one();
+  writerDone.notify_all();
+}
+
+void RWLock::lock_shared(void) {
+  std::unique_lock<std::mutex> lk(m);
+  while (writing || numWritersWaiting > 0) {
+    writerDone.wait(lk);
+  }
+  numReaders++;
+}
+
+void RWLock::unlock_shared(void) {
+  bool wakeWriter;
+  {
+    std::lock_guard<std::mutex> lk(m);
+    numReaders--;
+    wakeWriter = (0 == numReaders && numWritersWaiting > 0);
+  }
+  if (wakeWriter) readersDone.notify_one();
+}
+
+}  // namespace zmdp
@@ -0,0 +1,114 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_COMMON_THREADPOOL_H_
+#define ZMDP_SRC_COMMON_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace zmdp {
+
+// Process-wide pool of worker threads used to run independent pieces of
+// a single backup (one per action) in parallel.  Each worker has its
+// own queue of jobs; it pops from the back of its own queue and steals
+// from the front of the others' when it runs dry.
+//
+// parallelFor() is reentrant: a body may itself call parallelFor().
+// While waiting, the calling thread only runs iterations of its own
+// call, so per-thread scratch space (thread_local accumulators etc.)
+// that the caller is using is never clobbered by unrelated work.
+class ThreadPool {
+ public:
+  ThreadPool(void);
+  ~ThreadPool(void);
+
+  // numThreads is the total number of threads that share the work of a
+  // parallelFor(), including the caller.  1 means run everything
+  // serially in the caller; 0 means use one thread per hardware core.
+  void setNumThreads(int numThreads);
+  int getNumThreads(void) const { return workers.size() + 1; }
+
+  // calls body(i) for i = 0 .. n-1, possibly in parallel, and returns
+  // when all calls have finished.  bodies must not throw.
+  void parallelFor(int n, const std::function<void(int)> &body);
+
+ protected:
+  struct Job {
+    const std::function<void(int)> *body;
+    int n;
+    std::atomic<int> next;
+    std::atomic<int> numDone;
+  };
+  typedef std::shared_ptr<Job> JobPtr;
+
+  struct WorkerQueue {
+    std::mutex lock;
+    std::deque<JobPtr> jobs;
+  };
+
+  std::vector<std::thread> workers;
+  std::vector<WorkerQueue *> queues;
+
+  // sleeping workers wait on wakeup; numQueued counts jobs sitting in
+  // any queue and is only changed with sleepLock held
+  std::mutex sleepLock;
+  std::condition_variable wakeup;
+  int numQueued;
+  bool stopping;
+
+  void stopWorkers(void);
+  void workerMain(int w);
+  bool popJob(int w, JobPtr &job);
+  static void runJob(Job &job);
+};
+
+// the pool used by the solver; sized by the numThreads config parameter
+extern ThreadPool threadPoolG;
+
+// Reader/writer lock for data that is read by many threads at once and
+// occasionally modified.  Unlike std::shared_mutex on some platforms, a
+// waiting writer blocks new readers, so a stream of overlapping readers
+// cannot starve it.  Has the method names std::unique_lock and
+// std::shared_lock expect.
+class RWLock {
+ public:
+  RWLock(void) : numReaders(0), numWritersWaiting(0), writing(false) {}
+
+  void lock(void);
+  void unlock(void);
+  void lock_shared(void);
+  void unlock_shared(void);
+
+ protected:
+  std::mutex m;
+  std::condition_variable readersDone;
+  std::condition_variable writerDone;
+  int numReaders;
+  int numWritersWaiting;
+  bool writing;
+};
+
+}  // namespace zmdp
+
+#endif  // ZMDP_SRC_COMMON_THREADPOOL_H_
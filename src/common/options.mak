@@ -17,6 +17,10 @@
 
 CFLAGS += -DZMDP_VERSION=1.1.7
 
+# ThreadPool uses std::thread
+CFLAGS += -pthread
+LDFLAGS += -pthread
+
 # algorithm configuration options (most of the options that used to be
 # in this file are now run-time configuration parameters; see
 # src/main/zmdp.config)
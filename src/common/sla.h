@@ -21,6 +21,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <algorithm>
@@ -30,22 +32,29 @@
 #include <utility>
 #include <vector>
 
+#include "sla_simd.h"
 #include "zmdpCommonDefs.h"
 
 // sla     = simple linear algebra
 // dvector = dense vector
-// cvector = compressed vector
+// cvector = compressed vector (fcvector: with float values)
 // dmatrix = dense matrix
 // kmatrix = coordinate matrix
 // cmatrix = compressed matrix
+// sparse_accum = workspace for building a cvector from scattered updates
+// sla_array = array that owns its elements or views external memory
 
 namespace sla {
 
 struct dvector;
-struct cvector;
+template <class V>
+struct basic_cvector;
+typedef basic_cvector<double> cvector;
+typedef basic_cvector<float> fcvector;
 struct dmatrix;
 struct kmatrix;
 struct cmatrix;
+struct sparse_accum;
 
 /**********************************************************************
  * DVECTOR
@@ -75,25 +84,297 @@ struct dvector {
  * CVECTOR
  **********************************************************************/
 
-struct cvector_entry {
-  unsigned int index;
-  double value;
+// The non-zero entries of a cvector or cmatrix are kept as two parallel
+// arrays, 32-bit indices and values of type V, rather than an array of
+// (index, value) structs.  An entry takes 12 bytes with double values
+// (8 with float) instead of 16, and either array can be read with
+// unit-stride vector loads.  Iterators dereference to a sparse_ref proxy
+// with index and value members, so loops over xi->index and xi->value
+// work as they did with the array of structs.
+
+template <class I, class V>
+struct sparse_ref {
+  I &index;
+  V &value;
+
+  sparse_ref(I &_index, V &_value) : index(_index), value(_value) {}
+  sparse_ref(const sparse_ref &e) : index(e.index), value(e.value) {}
+
+  // assignment copies the referenced entry
+  sparse_ref &operator=(const sparse_ref &e) {
+    index = e.index;
+    value = e.value;
+    return *this;
+  }
+  template <class I2, class V2>
+  sparse_ref &operator=(const sparse_ref<I2, V2> &e) {
+    index = e.index;
+    value = e.value;
+    return *this;
+  }
+};
+
+// result of sparse_iterator::operator->()
+template <class I, class V>
+struct sparse_arrow {
+  sparse_ref<I, V> e;
+
+  explicit sparse_arrow(const sparse_ref<I, V> &_e) : e(_e) {}
+  sparse_ref<I, V> *operator->(void) { return &e; }
+};
+
+template <class I, class V>
+struct sparse_iterator {
+  I *ip;
+  V *vp;
+
+  sparse_iterator(void) : ip(NULL), vp(NULL) {}
+  sparse_iterator(I *_ip, V *_vp) : ip(_ip), vp(_vp) {}
+  // allows conversion from iterator to const_iterator
+  template <class I2, class V2>
+  sparse_iterator(const sparse_iterator<I2, V2> &x) : ip(x.ip), vp(x.vp) {}
+
+  sparse_ref<I, V> operator*(void) const { return sparse_ref<I, V>(*ip, *vp); }
+  sparse_arrow<I, V> operator->(void) const {
+    return sparse_arrow<I, V>(sparse_ref<I, V>(*ip, *vp));
+  }
+  sparse_ref<I, V> operator[](ptrdiff_t n) const {
+    return sparse_ref<I, V>(ip[n], vp[n]);
+  }
 
-  cvector_entry(void) {}
-  cvector_entry(unsigned int _index, double _value)
-      : index(_index), value(_value) {}
+  sparse_iterator &operator++(void) {
+    ip++;
+    vp++;
+    return *this;
+  }
+  sparse_iterator operator++(int) {
+    sparse_iterator tmp = *this;
+    ++(*this);
+    return tmp;
+  }
+  sparse_iterator &operator--(void) {
+    ip--;
+    vp--;
+    return *this;
+  }
+  sparse_iterator operator--(int) {
+    sparse_iterator tmp = *this;
+    --(*this);
+    return tmp;
+  }
+  sparse_iterator &operator+=(ptrdiff_t n) {
+    ip += n;
+    vp += n;
+    return *this;
+  }
+  sparse_iterator operator+(ptrdiff_t n) const {
+    return sparse_iterator(ip + n, vp + n);
+  }
+  sparse_iterator operator-(ptrdiff_t n) const {
+    return sparse_iterator(ip - n, vp - n);
+  }
+  ptrdiff_t operator-(const sparse_iterator &x) const { return ip - x.ip; }
+
+  bool operator==(const sparse_iterator &x) const { return ip == x.ip; }
+  bool operator!=(const sparse_iterator &x) const { return ip != x.ip; }
+  bool operator<(const sparse_iterator &x) const { return ip < x.ip; }
 };
 
-struct cvector {
+/**********************************************************************
+ * SLA_ARRAY
+ **********************************************************************/
+
+// Array with the parts of the std::vector interface that sparse_entries
+// and cmatrix use.  It either owns its elements or, after view(), reads
+// them from memory owned by someone else (such as a memory-mapped model
+// file), which must outlive the array.  Reads go through a single
+// pointer either way.  Any non-const access to a view first copies the
+// viewed elements into owned storage.
+template <class T>
+struct sla_array {
+  typedef T value_type;
+
+  std::vector<T> owned;
+  const T *ptr;
+  size_t n;
+  bool isView;
+
+  sla_array(void) : ptr(NULL), n(0), isView(false) {}
+  sla_array(const sla_array &x) : ptr(NULL), n(0), isView(false) {
+    *this = x;
+  }
+  sla_array &operator=(const sla_array &x) {
+    if (this == &x) return *this;
+    if (x.isView) {
+      view(x.ptr, x.n);
+    } else {
+      owned = x.owned;
+      isView = false;
+      sync();
+    }
+    return *this;
+  }
+
+  void view(const T *_ptr, size_t _n) {
+    std::vector<T>().swap(owned);
+    ptr = _ptr;
+    n = _n;
+    isView = true;
+  }
+  bool is_view(void) const { return isView; }
+
+  size_t size(void) const { return n; }
+  bool empty(void) const { return 0 == n; }
+  // views hold no heap storage
+  size_t capacity(void) const { return owned.capacity(); }
+
+  const T *data(void) const { return ptr; }
+  const T &operator[](size_t i) const { return ptr[i]; }
+  const T *begin(void) const { return ptr; }
+  const T *end(void) const { return ptr + n; }
+
+  T *data(void) {
+    own();
+    return owned.data();
+  }
+  T &operator[](size_t i) {
+    own();
+    return owned[i];
+  }
+  T *begin(void) { return data(); }
+  T *end(void) { return data() + n; }
+
+  void clear(void) {
+    own();
+    owned.clear();
+    sync();
+  }
+  void resize(size_t _n, const T &value = T()) {
+    own();
+    owned.resize(_n, value);
+    sync();
+  }
+  void reserve(size_t _n) {
+    own();
+    owned.reserve(_n);
+    sync();
+  }
+  void push_back(const T &x) {
+    own();
+    owned.push_back(x);
+    sync();
+  }
+  template <class It>
+  void assign(It first, It last) {
+    own();
+    owned.assign(first, last);
+    sync();
+  }
+  void swap(sla_array &x) {
+    owned.swap(x.owned);
+    std::swap(ptr, x.ptr);
+    std::swap(n, x.n);
+    std::swap(isView, x.isView);
+  }
+
+ protected:
+  void own(void) {
+    if (isView) {
+      owned.assign(ptr, ptr + n);
+      isView = false;
+      sync();
+    }
+  }
+  void sync(void) {
+    ptr = owned.data();
+    n = owned.size();
+  }
+};
+
+/**********************************************************************
+ * SPARSE ENTRIES
+ **********************************************************************/
+
+// IA and VA are the index and value array types: std::vector for
+// vectors, which are built and modified all the time, and sla_array for
+// cmatrix, whose entries can then live in a memory-mapped file
+template <class V, class IA = std::vector<unsigned int>,
+          class VA = std::vector<V> >
+struct sparse_entries {
+  typedef sparse_ref<unsigned int, V> reference;
+  typedef sparse_ref<const unsigned int, const V> const_reference;
+  typedef sparse_iterator<unsigned int, V> iterator;
+  typedef sparse_iterator<const unsigned int, const V> const_iterator;
+
+  IA indices;
+  VA values;
+
+  unsigned int size(void) const { return indices.size(); }
+  bool empty(void) const { return indices.empty(); }
+  size_t capacity(void) const { return indices.capacity(); }
+  // bytes allocated for both arrays
+  size_t storage_bytes(void) const {
+    return indices.capacity() * sizeof(unsigned int) +
+           values.capacity() * sizeof(V);
+  }
+
+  void clear(void) {
+    indices.clear();
+    values.clear();
+  }
+  void resize(unsigned int n) {
+    indices.resize(n);
+    values.resize(n);
+  }
+  void reserve(unsigned int n) {
+    indices.reserve(n);
+    values.reserve(n);
+  }
+  void swap(sparse_entries &x) {
+    indices.swap(x.indices);
+    values.swap(x.values);
+  }
+  void push_back(unsigned int index, V value) {
+    indices.push_back(index);
+    values.push_back(value);
+  }
+  template <class I2, class V2>
+  void push_back(const sparse_ref<I2, V2> &e) {
+    push_back(e.index, e.value);
+  }
+
+  iterator begin(void) { return iterator(indices.data(), values.data()); }
+  iterator end(void) { return begin() + indices.size(); }
+  const_iterator begin(void) const {
+    return const_iterator(indices.data(), values.data());
+  }
+  const_iterator end(void) const { return begin() + indices.size(); }
+
+  reference operator[](unsigned int i) {
+    return reference(indices[i], values[i]);
+  }
+  const_reference operator[](unsigned int i) const {
+    return const_reference(indices[i], values[i]);
+  }
+  reference front(void) { return (*this)[0]; }
+  const_reference front(void) const { return (*this)[0]; }
+  reference back(void) { return (*this)[size() - 1]; }
+  const_reference back(void) const { return (*this)[size() - 1]; }
+};
+
+template <class V>
+struct basic_cvector {
+  typedef V value_type;
+
   unsigned int size_;
-  std::vector<cvector_entry> data;
+  sparse_entries<V> data;
 
-  cvector(void) : size_(0) {}
-  explicit cvector(unsigned int _size) { resize(_size); }
+  basic_cvector(void) : size_(0) {}
+  explicit basic_cvector(unsigned int _size) { resize(_size); }
 
   double operator()(unsigned int index) const;
-  void operator+=(const cvector &x);
-  void operator-=(const cvector &x);
+  void operator+=(const basic_cvector &x);
+  void operator-=(const basic_cvector &x);
   void operator*=(double s);
 
   unsigned int size(void) const { return size_; }
@@ -163,8 +444,8 @@ struct kmatrix {
 
 struct cmatrix {
   unsigned int size1_, size2_;
-  std::vector<unsigned int> col_starts;
-  std::vector<cvector_entry> data;
+  sla_array<unsigned int> col_starts;
+  sparse_entries<double, sla_array<unsigned int>, sla_array<double> > data;
 
   cmatrix(void) : size1_(0), size2_(0) {}
   cmatrix(unsigned int _size1, unsigned int _size2) { resize(_size1, _size2); }
@@ -185,29 +466,109 @@ struct cmatrix {
 
   void clear(void) { data.clear(); }
 
+  // makes the matrix read its column starts (size2 + 1 of them), entry
+  // indices and entry values (nnz each) from external memory
+  void view(unsigned int _size1, unsigned int _size2, const unsigned int *_cs,
+            const unsigned int *_indices, const double *_values,
+            unsigned int nnz);
+
   void read(std::istream &in);
   void write(std::ostream &out) const;
 };
 
+/**********************************************************************
+ * SPARSE ACCUMULATOR
+ **********************************************************************/
+
+// Workspace for building a sparse vector from many scattered updates: a
+// dense value array, an occupancy bitmap, and the list of indices
+// touched since the last clear().  Adding an entry is O(1), and clear()
+// only resets the words of the bitmap that were touched, so one
+// accumulator can be reused across calls without O(size) work.
+struct sparse_accum {
+  unsigned int size_;
+  std::vector<double> vals;
+  std::vector<uint64_t> occupied;
+  std::vector<unsigned int> touched;
+  bool canonical;
+
+  sparse_accum(void) : size_(0), canonical(true) {}
+
+  unsigned int size(void) const { return size_; }
+  unsigned int filled(void) const { return touched.size(); }
+
+  bool contains(unsigned int index) const {
+    return 0 != (occupied[index >> 6] & (1ULL << (index & 63)));
+  }
+  double operator()(unsigned int index) const {
+    return contains(index) ? vals[index] : 0.0;
+  }
+
+  // clears the accumulator and sets its size.  storage only grows.
+  void resize(unsigned int _size);
+  void clear(void);
+
+  // x(index) += value
+  void add(unsigned int index, double value) {
+    uint64_t &word = occupied[index >> 6];
+    uint64_t bit = 1ULL << (index & 63);
+    if (word & bit) {
+      vals[index] += value;
+    } else {
+      word |= bit;
+      vals[index] = value;
+      touched.push_back(index);
+      canonical = false;
+    }
+  }
+
+  // sorts the touched list; must be called before copy(), mask_copy()
+  // or emult_column() read the accumulator
+  void canonicalize(void);
+};
+
+// slots for thread_sparse_accum().  INNER is reserved for sla
+// operations such as mult(cvector, cmatrix, cvector).  OUTER is for
+// callers outside sla: they may call any sla operation while holding
+// it, but must not call other code that also uses OUTER.
+#define SLA_ACCUM_INNER (0)
+#define SLA_ACCUM_OUTER (1)
+#define SLA_NUM_ACCUMS (2)
+
 /**********************************************************************
  * NON-MEMBER FUNCTION PROTOTYPES
  **********************************************************************/
 
 // result = x
-inline void copy(cvector &result, const cvector &x) { result = x; }
+template <class V>
+inline void copy(basic_cvector<V> &result, const basic_cvector<V> &x) {
+  result = x;
+}
 inline void copy(dvector &result, const dvector &x) { result = x; }
 
+// result = x (converting between value types)
+template <class V, class W>
+void copy(basic_cvector<V> &result, const basic_cvector<W> &x);
+
 // result = x
-void copy(dvector &result, const cvector &x);
+template <class V>
+void copy(dvector &result, const basic_cvector<V> &x);
 
 // result = x
-void copy(cvector &result, const dvector &x);
+template <class V>
+void copy(basic_cvector<V> &result, const dvector &x);
 
 // result = A (side-effect: canonicalizes A)
 void copy(cmatrix &result, kmatrix &A);
 
+// result = x
+template <class V>
+void copy(basic_cvector<V> &result, const sparse_accum &x);
+
 // result = A(.,c)
-void copy_from_column(cvector &result, const cmatrix &A, unsigned int c);
+template <class V>
+void copy_from_column(basic_cvector<V> &result, const cmatrix &A,
+                      unsigned int c);
 
 // result = A(:,c)
 void copy_from_column(dvector &result, const cmatrix &A, unsigned int c);
@@ -216,7 +577,8 @@ void copy_from_column(dvector &result, const cmatrix &A, unsigned int c);
 void set_to_one(dvector &result, unsigned int rsize);
 
 // result = ones(rsize)
-void set_to_one(cvector &result, unsigned int rsize);
+template <class V>
+void set_to_one(basic_cvector<V> &result, unsigned int rsize);
 
 // A(r,c) = v
 void kmatrix_set_entry(kmatrix &A, unsigned int r, unsigned int c, double v);
@@ -224,40 +586,67 @@ void kmatrix_set_entry(kmatrix &A, unsigned int r, unsigned int c, double v);
 // A = A'
 void kmatrix_transpose_in_place(kmatrix &A);
 
-double norm_1(const cvector &x);
-double norm_inf(const cvector &x);
+template <class V>
+double norm_1(const basic_cvector<V> &x);
+template <class V>
+double norm_inf(const basic_cvector<V> &x);
 double norm_inf(const dvector &x);
-double sum(const cvector &x);
+template <class V>
+double sum(const basic_cvector<V> &x);
 double sum(const dvector &x);
 
 // result = A * x
-void mult(dvector &result, const cmatrix &A, const cvector &x);
+template <class V>
+void mult(dvector &result, const cmatrix &A, const basic_cvector<V> &x);
 
 // result = A * x
-void mult(cvector &result, const cmatrix &A, const cvector &x);
+template <class V, class W>
+void mult(basic_cvector<V> &result, const cmatrix &A,
+          const basic_cvector<W> &x);
+
+// result = A * x
+template <class V>
+void mult(sparse_accum &result, const cmatrix &A, const basic_cvector<V> &x);
+
+// result += A * x
+template <class V>
+void mult_add(sparse_accum &result, const cmatrix &A,
+              const basic_cvector<V> &x);
 
 // result = x * A
 void mult(dvector &result, const dvector &x, const cmatrix &A);
 
 // result = x * A
-void mult(dvector &result, const cvector &x, const cmatrix &A);
+template <class V>
+void mult(dvector &result, const basic_cvector<V> &x, const cmatrix &A);
 
 // result = x * A [note: if you have transpose(A) available, try
 //   mult(result, A', x) instead; it is often much faster]
-void mult(cvector &result, const cvector &x, const cmatrix &A);
+template <class V, class W>
+void mult(basic_cvector<V> &result, const basic_cvector<W> &x,
+          const cmatrix &A);
 
 // result = x .* y [for all i, result(i) = x(i) * y(i)]
 void emult(dvector &result, const dvector &x, const dvector &y);
 
 // result = x .* y [for all i, result(i) = x(i) * y(i)]
-void emult(cvector &result, const cvector &x, const cvector &y);
+template <class V, class W, class X>
+void emult(basic_cvector<V> &result, const basic_cvector<W> &x,
+           const basic_cvector<X> &y);
 
 // result = A(:,c) .* x
-void emult_column(cvector &result, const cmatrix &A, unsigned int c,
-                  const cvector &x);
+template <class V, class W>
+void emult_column(basic_cvector<V> &result, const cmatrix &A, unsigned int c,
+                  const basic_cvector<W> &x);
+
+// result = A(:,c) .* x
+template <class V>
+void emult_column(basic_cvector<V> &result, const cmatrix &A, unsigned int c,
+                  const sparse_accum &x);
 
 // result = x .* y
-void emult(dvector &result, const dvector &x, const cvector &y);
+template <class V>
+void emult(dvector &result, const dvector &x, const basic_cvector<V> &y);
 
 // result = A(:,c) .* x
 void emult_column(dvector &result, const cmatrix &A, unsigned int c,
@@ -270,25 +659,38 @@ void emax(dvector &result, const dvector &x, const dvector &y);
 void max_assign(dvector &result, const dvector &x);
 
 // return x' * y
-double inner_prod(const dvector &x, const cvector &y);
+template <class V>
+double inner_prod(const dvector &x, const basic_cvector<V> &y);
 
 // return x' * y
-double inner_prod(const cvector &x, const cvector &y);
+template <class V, class W>
+double inner_prod(const basic_cvector<V> &x, const basic_cvector<W> &y);
 
 // return A(:,c)' * y
-double inner_prod_column(const cmatrix &A, unsigned int c, const cvector &y);
+template <class V>
+double inner_prod_column(const cmatrix &A, unsigned int c,
+                         const basic_cvector<V> &y);
 
 // result = x + y
-void add(cvector &result, const cvector &x, const cvector &y);
+template <class V>
+void add(basic_cvector<V> &result, const basic_cvector<V> &x,
+         const basic_cvector<V> &y);
 
 // result = x - y
-void subtract(cvector &result, const cvector &x, const cvector &y);
+template <class V>
+void subtract(basic_cvector<V> &result, const basic_cvector<V> &x,
+              const basic_cvector<V> &y);
 
 // return true if for all i: x(i) >= y(i) - eps
 bool dominates(const dvector &x, const dvector &y, double eps);
 
 // return true if for all i: x(i) >= y(i) - eps
-bool dominates(const cvector &x, const cvector &y, double eps);
+template <class V>
+bool dominates(const basic_cvector<V> &x, const basic_cvector<V> &y,
+               double eps);
+
+// returns the calling thread's accumulator for the given slot
+sparse_accum &thread_sparse_accum(int slot);
 
 template <class T>
 void read_from_file(T &x, const std::string &file_name);
@@ -354,7 +756,8 @@ inline void dvector::write(std::ostream &out) const {
  * CVECTOR FUNCTIONS
  **********************************************************************/
 
-inline double cvector::operator()(unsigned int index) const {
+template <class V>
+inline double basic_cvector<V>::operator()(unsigned int index) const {
   FOR_EACH(di, data) {
     if (di->index >= index) {
       if (di->index == index) {
@@ -367,42 +770,49 @@ inline double cvector::operator()(unsigned int index) const {
   return 0.0;
 }
 
-inline void cvector::operator*=(double s) {
-  typeof(data.begin()) vi, vend = data.end();
-  for (vi = data.begin(); vi != vend; vi++) {
-    vi->value *= s;
+template <class V>
+inline void basic_cvector<V>::operator*=(double s) {
+  typeof(data.values.begin()) vi, vend = data.values.end();
+  for (vi = data.values.begin(); vi != vend; vi++) {
+    (*vi) *= s;
   }
 }
 
-inline void cvector::operator+=(const cvector &x) {
-  cvector tmp;
+template <class V>
+inline void basic_cvector<V>::operator+=(const basic_cvector &x) {
+  basic_cvector tmp;
   add(tmp, *this, x);
   *this = tmp;
 }
 
-inline void cvector::operator-=(const cvector &x) {
-  cvector tmp;
+template <class V>
+inline void basic_cvector<V>::operator-=(const basic_cvector &x) {
+  basic_cvector tmp;
   subtract(tmp, *this, x);
   *this = tmp;
 }
 
-inline void cvector::resize(unsigned int _size, unsigned int _non_zeros) {
+template <class V>
+inline void basic_cvector<V>::resize(unsigned int _size,
+                                     unsigned int _non_zeros) {
   assert(0 == _non_zeros);
   size_ = _size;
   data.clear();
 }
 
-inline void cvector::push_back(unsigned int index, double value) {
-  data.push_back(cvector_entry(index, value));
+template <class V>
+inline void basic_cvector<V>::push_back(unsigned int index, double value) {
+  data.push_back(index, value);
 }
 
-inline void cvector::read(std::istream &in) {
+template <class V>
+inline void basic_cvector<V>::read(std::istream &in) {
   int num_entries;
 
   in >> size_;
   in >> num_entries;
   data.resize(num_entries);
-  FOR(i, num_entries) { in >> data[i].index >> data[i].value; }
+  FOR(i, num_entries) { in >> data.indices[i] >> data.values[i]; }
 }
 
 /**********************************************************************
@@ -457,33 +867,46 @@ inline void kmatrix::push_back(unsigned int r, unsigned int c, double value) {
   data.push_back(kmatrix_entry(r, c, value));
 }
 
-struct ColumnMajorCompare {
-  bool operator()(const kmatrix_entry &lhs, const kmatrix_entry &rhs) {
-    return (lhs.c < rhs.c) || ((lhs.c == rhs.c) && (lhs.r < rhs.r));
-  }
-};
-
 inline bool rc_equal(const kmatrix_entry &lhs, const kmatrix_entry &rhs) {
   return (lhs.r == rhs.r) && (lhs.c == rhs.c);
 }
 
-inline void kmatrix::canonicalize(void) {
-  std::vector<kmatrix_entry> d;
+// stable counting sort of entries by row (byRow) or by column
+inline void kmatrix_counting_sort(std::vector<kmatrix_entry> &entries,
+                                  std::vector<kmatrix_entry> &tmp,
+                                  unsigned int numKeys, bool byRow) {
+  std::vector<unsigned int> next(numKeys + 1, 0);
+  FOR_EACH(ei, entries) {
+    unsigned int key = byRow ? ei->r : ei->c;
+    assert(key < numKeys);
+    next[key + 1]++;
+  }
+  FOR(k, numKeys) { next[k + 1] += next[k]; }
+  tmp.resize(entries.size());
+  FOR_EACH(ei, entries) { tmp[next[byRow ? ei->r : ei->c]++] = *ei; }
+  entries.swap(tmp);
+}
 
-  // sort in column-major order
-  std::stable_sort(data.begin(), data.end(), ColumnMajorCompare());
+inline void kmatrix::canonicalize(void) {
+  // sort in column-major order.  a radix sort with one pass by row
+  // and one by column is linear in the number of entries, and being
+  // stable it keeps entries with the same (r,c) in insertion order.
+  std::vector<kmatrix_entry> tmp;
+  kmatrix_counting_sort(data, tmp, size1_, /* byRow = */ true);
+  kmatrix_counting_sort(data, tmp, size2_, /* byRow = */ false);
 
   // ensure there is at most one entry with each (r,c) coordinate.
   // among all the entries with the same (r,c), keep the last one.
   // note that this operation does *not* get rid of near-zero entries.
-  FOR(i, data.size()) {
-    if (!d.empty() && rc_equal(d.back(), data[i])) {
-      d.back() = data[i];
+  size_t n = 0;
+  FOR_EACH(di, data) {
+    if (n > 0 && rc_equal(data[n - 1], *di)) {
+      data[n - 1] = *di;
     } else {
-      d.push_back(data[i]);
+      data[n++] = *di;
     }
   }
-  data.swap(d);
+  data.resize(n);
 }
 
 inline void kmatrix::read(std::istream &in) {
@@ -537,7 +960,7 @@ inline void cmatrix::resize(unsigned int _size1, unsigned int _size2,
 }
 
 inline void cmatrix::push_back(unsigned int r, unsigned int c, double value) {
-  data.push_back(cvector_entry(r, value));
+  data.push_back(r, value);
   col_starts[c + 1] = data.size();
 }
 
@@ -549,6 +972,17 @@ inline void cmatrix::canonicalize(void) {
   }
 }
 
+inline void cmatrix::view(unsigned int _size1, unsigned int _size2,
+                          const unsigned int *_cs,
+                          const unsigned int *_indices, const double *_values,
+                          unsigned int nnz) {
+  size1_ = _size1;
+  size2_ = _size2;
+  col_starts.view(_cs, _size2 + 1);
+  data.indices.view(_indices, nnz);
+  data.values.view(_values, nnz);
+}
+
 inline void cmatrix::read(std::istream &in) {
   kmatrix km;
   km.read(in);
@@ -568,16 +1002,69 @@ inline void cmatrix::write(std::ostream &out) const {
   }
 }
 
+/**********************************************************************
+ * SPARSE ACCUMULATOR FUNCTIONS
+ **********************************************************************/
+
+inline void sparse_accum::resize(unsigned int _size) {
+  clear();
+  size_ = _size;
+  if (vals.size() < _size) {
+    vals.resize(_size);
+    occupied.resize((_size + 63) / 64, 0);
+  }
+}
+
+inline void sparse_accum::clear(void) {
+  FOR_EACH(ti, touched) { occupied[(*ti) >> 6] = 0; }
+  touched.clear();
+  canonical = true;
+}
+
+inline void sparse_accum::canonicalize(void) {
+  if (canonical) return;
+  if (touched.size() > size_ / 16) {
+    // dense enough that walking the bitmap beats sorting
+    unsigned int numWords = (size_ + 63) / 64;
+    touched.clear();
+    FOR(w, numWords) {
+      uint64_t word = occupied[w];
+      while (word) {
+        touched.push_back(w * 64 + __builtin_ctzll(word));
+        word &= word - 1;
+      }
+    }
+  } else {
+    std::sort(touched.begin(), touched.end());
+  }
+  canonical = true;
+}
+
+// returns the calling thread's accumulator for the given slot
+inline sparse_accum &thread_sparse_accum(int slot) {
+  static thread_local sparse_accum accums[SLA_NUM_ACCUMS];
+  return accums[slot];
+}
+
 /**********************************************************************
  * NON-MEMBER FUNCTIONS
  **********************************************************************/
 
-inline void copy(dvector &result, const cvector &x) {
+template <class V, class W>
+inline void copy(basic_cvector<V> &result, const basic_cvector<W> &x) {
+  result.resize(x.size());
+  result.data.indices = x.data.indices;
+  result.data.values.assign(x.data.values.begin(), x.data.values.end());
+}
+
+template <class V>
+inline void copy(dvector &result, const basic_cvector<V> &x) {
   result.resize(x.size());
   FOR_EACH(xi, x.data) { result.data[xi->index] = xi->value; }
 }
 
-inline void copy(cvector &result, const dvector &x) {
+template <class V>
+inline void copy(basic_cvector<V> &result, const dvector &x) {
   int i;
 
   result.resize(x.size());
@@ -590,6 +1077,16 @@ inline void copy(cvector &result, const dvector &x) {
   }
 }
 
+// result = x
+template <class V>
+inline void copy(basic_cvector<V> &result, const sparse_accum &x) {
+  assert(x.canonical);
+  result.resize(x.size());
+  result.data.indices = x.touched;
+  result.data.values.resize(x.filled());
+  FOR(i, x.filled()) { result.data.values[i] = x.vals[x.touched[i]]; }
+}
+
 inline void copy(cmatrix &result, kmatrix &A) {
   A.canonicalize();
   result.resize(A.size1(), A.size2());
@@ -602,7 +1099,8 @@ inline void copy(cmatrix &result, kmatrix &A) {
 }
 
 // result = A(:,c)
-inline void copy_from_column(cvector &result, const cmatrix &A,
+template <class V>
+inline void copy_from_column(basic_cvector<V> &result, const cmatrix &A,
                              unsigned int c) {
   assert(0 <= c && c < A.size2());
 
@@ -640,7 +1138,8 @@ inline void set_to_one(dvector &result, unsigned int rsize) {
 }
 
 // result = ones(rsize)
-inline void set_to_one(cvector &result, unsigned int rsize) {
+template <class V>
+inline void set_to_one(basic_cvector<V> &result, unsigned int rsize) {
   result.resize(rsize);
   FOR(s, rsize) { result.push_back(s, 1.0); }
   result.canonicalize();
@@ -659,13 +1158,15 @@ inline void kmatrix_transpose_in_place(kmatrix &A) {
   A.canonicalize();
 }
 
-inline double norm_1(const cvector &x) {
+template <class V>
+inline double norm_1(const basic_cvector<V> &x) {
   double sum = 0.0;
   FOR_EACH(xi, x.data) { sum += fabs(xi->value); }
   return sum;
 }
 
-inline double norm_inf(const cvector &x) {
+template <class V>
+inline double norm_inf(const basic_cvector<V> &x) {
   double val, max = 0.0;
   FOR_EACH(xi, x.data) {
     val = fabs(xi->value);
@@ -683,7 +1184,8 @@ inline double norm_inf(const dvector &x) {
   return max;
 }
 
-inline double sum(const cvector &x) {
+template <class V>
+inline double sum(const basic_cvector<V> &x) {
   double sum = 0.0;
   FOR_EACH(xi, x.data) { sum += xi->value; }
   return sum;
@@ -696,7 +1198,9 @@ inline double sum(const dvector &x) {
 }
 
 // result = A * x
-inline void mult(dvector &result, const cmatrix &A, const cvector &x) {
+template <class V>
+inline void mult(dvector &result, const cmatrix &A,
+                 const basic_cvector<V> &x) {
   typeof(A.data.begin()) Ai, col_end;
   int xind;
   double xval;
@@ -706,53 +1210,62 @@ inline void mult(dvector &result, const cmatrix &A, const cvector &x) {
   FOR_EACH(xi, x.data) {
     xind = xi->index;
     xval = xi->value;
-    col_end = A.data.begin() + A.col_starts[xind + 1];
-    for (Ai = A.data.begin() + A.col_starts[xind]; Ai != col_end; Ai++) {
+    unsigned int cbegin = A.col_starts[xind], cend = A.col_starts[xind + 1];
+    if (cend - cbegin >= SLA_SIMD_MIN_LENGTH) {
+      (*slaKernelsG.scatter_add)(result.data.data(), xval,
+                                 A.data.indices.data() + cbegin,
+                                 A.data.values.data() + cbegin, cend - cbegin);
+      continue;
+    }
+    col_end = A.data.begin() + cend;
+    for (Ai = A.data.begin() + cbegin; Ai != col_end; Ai++) {
       result.data[Ai->index] += xval * Ai->value;
     }
   }
 }
 
-// result = A * x
-inline void mult(cvector &result, const cmatrix &A, const cvector &x) {
-  if (x.filled() * A.filled() < 0.1 * A.size1() * A.size2()) {
-    // this sparse accumulator technique is only a good idea if both A
-    // and x are very sparse.  in that case, allocating and
-    // initializing a dense vector of the right size for temporary
-    // storage can dominate running time.  but for somewhat denser
-    // operands, the alternate implementation below is likely to be
-    // better.
-
-    typeof(A.data.begin()) Ai, col_end;
-    int xind;
-    double xval;
-    cvector tmp;
-    cvector accum;
-
-    accum.resize(x.size());
-    FOR_EACH(xi, x.data) {
-      xind = xi->index;
-      xval = xi->value;
-      col_end = A.data.begin() + A.col_starts[xind + 1];
-      tmp.resize(x.size());
-      for (Ai = A.data.begin() + A.col_starts[xind]; Ai != col_end; Ai++) {
-        tmp.push_back(Ai->index, xval * Ai->value);
-      }
-      accum += tmp;
-    }
+// result += A * x
+template <class V>
+inline void mult_add(sparse_accum &result, const cmatrix &A,
+                     const basic_cvector<V> &x) {
+  assert(A.size2() == x.size());
+  assert(A.size1() == result.size());
+  const unsigned int *Aidx = A.data.indices.data();
+  const double *Aval = A.data.values.data();
 
-    result.resize(x.size());
-    FOR_EACH(ai, accum.data) {
-      if (fabs(ai->value) > SPARSE_EPS) {
-        result.data.push_back(*ai);
-      }
+  FOR_EACH(xi, x.data) {
+    double xval = xi->value;
+    unsigned int cend = A.col_starts[xi->index + 1];
+    for (unsigned int k = A.col_starts[xi->index]; k != cend; k++) {
+      result.add(Aidx[k], xval * Aval[k]);
     }
-  } else {
-    dvector tmp;
+  }
+}
+
+// result = A * x
+template <class V>
+inline void mult(sparse_accum &result, const cmatrix &A,
+                 const basic_cvector<V> &x) {
+  result.resize(A.size1());
+  mult_add(result, A, x);
+  result.canonicalize();
+}
 
-    mult(tmp, A, x);
-    copy(result, tmp);
+// result = A * x
+template <class V, class W>
+inline void mult(basic_cvector<V> &result, const cmatrix &A,
+                 const basic_cvector<W> &x) {
+  sparse_accum &accum = thread_sparse_accum(SLA_ACCUM_INNER);
+  mult(accum, A, x);
+
+  result.resize(accum.size());
+  FOR_EACH(ti, accum.touched) {
+    double val = accum.vals[*ti];
+    if (fabs(val) > SPARSE_EPS) {
+      result.push_back(*ti, val);
+    }
   }
+  result.canonicalize();
 }
 
 // result = x * A
@@ -771,7 +1284,9 @@ inline void mult(dvector &result, const dvector &x, const cmatrix &A) {
 }
 
 // result = x * A
-inline void mult(dvector &result, const cvector &x, const cmatrix &A) {
+template <class V>
+inline void mult(dvector &result, const basic_cvector<V> &x,
+                 const cmatrix &A) {
   assert(x.size() == A.size1());
   result.resize(A.size2());
 
@@ -779,7 +1294,9 @@ inline void mult(dvector &result, const cvector &x, const cmatrix &A) {
 }
 
 // result = x * A
-inline void mult(cvector &result, const cvector &x, const cmatrix &A) {
+template <class V, class W>
+inline void mult(basic_cvector<V> &result, const basic_cvector<W> &x,
+                 const cmatrix &A) {
   dvector tmp;
   mult(tmp, x, A);
   copy(result, tmp);
@@ -793,8 +1310,8 @@ inline void emult(dvector &result, const dvector &x, const dvector &y) {
 }
 
 // result = x .* y [for all i, result(i) = x(i) * y(i)]
-template <class T, class U>
-void emult_cc_internal(cvector &result, T xbegin, T xend, U ybegin, U yend) {
+template <class R, class T, class U>
+void emult_cc_internal(R &result, T xbegin, T xend, U ybegin, U yend) {
   U yi = ybegin;
   for (T xi = xbegin; xi != xend; xi++) {
     while (1) {
@@ -811,7 +1328,9 @@ void emult_cc_internal(cvector &result, T xbegin, T xend, U ybegin, U yend) {
 }
 
 // result = x .* y [for all i, result(i) = x(i) * y(i)]
-inline void emult(cvector &result, const cvector &x, const cvector &y) {
+template <class V, class W, class X>
+inline void emult(basic_cvector<V> &result, const basic_cvector<W> &x,
+                  const basic_cvector<X> &y) {
   assert(x.size() == y.size());
   result.resize(x.size());
 
@@ -822,8 +1341,9 @@ inline void emult(cvector &result, const cvector &x, const cvector &y) {
 }
 
 // result = A(:,c) .* x
-inline void emult_column(cvector &result, const cmatrix &A, unsigned int c,
-                         const cvector &x) {
+template <class V, class W>
+inline void emult_column(basic_cvector<V> &result, const cmatrix &A,
+                         unsigned int c, const basic_cvector<W> &x) {
   assert(A.size1() == x.size());
   assert(0 <= c && c < A.size2());
   result.resize(x.size());
@@ -835,21 +1355,76 @@ inline void emult_column(cvector &result, const cmatrix &A, unsigned int c,
   result.canonicalize();
 }
 
+// result = A(:,c) .* x.  entries of x with magnitude at most SPARSE_EPS
+// are treated as zero, as they would be if x were first copied into a
+// cvector by mult(cvector, cmatrix, cvector).
+template <class V>
+inline void emult_column(basic_cvector<V> &result, const cmatrix &A,
+                         unsigned int c, const sparse_accum &x) {
+  assert(A.size1() == x.size());
+  assert(0 <= c && c < A.size2());
+  assert(x.canonical);
+  result.resize(x.size());
+
+  const unsigned int *cbegin = A.data.indices.data() + A.col_starts[c];
+  const unsigned int *cend = A.data.indices.data() + A.col_starts[c + 1];
+  const double *cvals = A.data.values.data() + A.col_starts[c];
+  double xval;
+
+  if (8 * x.filled() < static_cast<unsigned int>(cend - cbegin)) {
+    // x is much sparser than the column; look up each entry of x
+    const unsigned int *ci = cbegin;
+    FOR_EACH(ti, x.touched) {
+      ci = std::lower_bound(ci, cend, *ti);
+      if (ci == cend) break;
+      if (*ci != *ti) continue;
+      xval = x.vals[*ti];
+      if (fabs(xval) > SPARSE_EPS) {
+        result.push_back(*ti, cvals[ci - cbegin] * xval);
+      }
+    }
+  } else {
+    for (const unsigned int *ci = cbegin; ci != cend; ci++) {
+      if (!x.contains(*ci)) continue;
+      xval = x.vals[*ci];
+      if (fabs(xval) > SPARSE_EPS) {
+        result.push_back(*ci, cvals[ci - cbegin] * xval);
+      }
+    }
+  }
+  result.canonicalize();
+}
+
 // result = x .* y [for all i, result(i) = x(i) * y(i)]
-template <class T>
-void emult_dc_internal(dvector &result, const dvector &x, T ybegin, T yend) {
+template <class V>
+inline void emult_dc_internal(dvector &result, const dvector &x,
+                              const unsigned int *yidx, const V *yval,
+                              unsigned int n) {
   int yind;
-  for (T yi = ybegin; yi != yend; yi++) {
-    yind = yi->index;
-    result(yind) = x(yind) * yi->value;
+  FOR(i, n) {
+    yind = yidx[i];
+    result(yind) = x(yind) * yval[i];
+  }
+}
+
+inline void emult_dc_internal(dvector &result, const dvector &x,
+                              const unsigned int *yidx, const double *yval,
+                              unsigned int n) {
+  if (n >= SLA_SIMD_MIN_LENGTH) {
+    (*slaKernelsG.dc_emult)(result.data.data(), x.data.data(), yidx, yval, n);
+    return;
   }
+  emult_dc_internal<double>(result, x, yidx, yval, n);
 }
 
 // result = x .* y
-inline void emult(dvector &result, const dvector &x, const cvector &y) {
+template <class V>
+inline void emult(dvector &result, const dvector &x,
+                  const basic_cvector<V> &y) {
   assert(x.size() == y.size());
   result.resize(x.size());
-  emult_dc_internal(result, x, y.data.begin(), y.data.end());
+  emult_dc_internal(result, x, y.data.indices.data(), y.data.values.data(),
+                    y.filled());
 }
 
 // result = A(:,c) .* x
@@ -858,14 +1433,21 @@ inline void emult_column(dvector &result, const cmatrix &A, unsigned int c,
   assert(A.size1() == x.size());
   assert(0 <= c && c < A.size2());
   result.resize(x.size());
-  emult_dc_internal(result, x, A.data.begin() + A.col_starts[c],
-                    A.data.begin() + A.col_starts[c + 1]);
+  unsigned int cbegin = A.col_starts[c];
+  emult_dc_internal(result, x, A.data.indices.data() + cbegin,
+                    A.data.values.data() + cbegin,
+                    A.col_starts[c + 1] - cbegin);
 }
 
 // result = max(x,y)
 inline void emax(dvector &result, const dvector &x, const dvector &y) {
   assert(x.size() == y.size());
   result.resize(x.size());
+  if (x.size() >= SLA_SIMD_MIN_LENGTH) {
+    (*slaKernelsG.emax)(result.data.data(), x.data.data(), y.data.data(),
+                        x.size());
+    return;
+  }
 
   typeof(y.data.begin()) yi = y.data.begin();
   typeof(result.data.begin()) ri = result.data.begin();
@@ -879,6 +1461,10 @@ inline void emax(dvector &result, const dvector &x, const dvector &y) {
 // result = max(result,x)
 inline void max_assign(dvector &result, const dvector &x) {
   assert(result.size() == x.size());
+  if (x.size() >= SLA_SIMD_MIN_LENGTH) {
+    (*slaKernelsG.max_assign)(result.data.data(), x.data.data(), x.size());
+    return;
+  }
 
   typeof(x.data.begin()) xi = x.data.begin();
   double xval;
@@ -890,14 +1476,43 @@ inline void max_assign(dvector &result, const dvector &x) {
   }
 }
 
-// return x' * y
-inline double inner_prod(const dvector &x, const cvector &y) {
-  assert(x.size() == y.size());
+// return sum over i < n of x(yidx[i]) * yval[i]
+template <class V>
+inline double inner_prod_dc_internal(const dvector &x, const unsigned int *yidx,
+                                     const V *yval, unsigned int n) {
   double sum = 0.0;
-  FOR_EACH(yi, y.data) { sum += x(yi->index) * yi->value; }
+  FOR(i, n) { sum += x(yidx[i]) * yval[i]; }
   return sum;
 }
 
+inline double inner_prod_dc_internal(const dvector &x, const unsigned int *yidx,
+                                     const double *yval, unsigned int n) {
+  if (n >= SLA_SIMD_MIN_LENGTH) {
+    return (*slaKernelsG.dc_inner_prod)(x.data.data(), yidx, yval, n);
+  }
+  return inner_prod_dc_internal<double>(x, yidx, yval, n);
+}
+
+// return min(init, min over i < n of x[yidx[i]] / yval[i])
+inline double min_ratio_dc_internal(const double *x, const unsigned int *yidx,
+                                    const double *yval, unsigned int n,
+                                    double init) {
+  if (n >= SLA_SIMD_MIN_LENGTH) {
+    return (*slaKernelsG.dc_min_ratio)(x, yidx, yval, n, init);
+  }
+  double m = init;
+  FOR(i, n) { m = std::min(m, x[yidx[i]] / yval[i]); }
+  return m;
+}
+
+// return x' * y
+template <class V>
+inline double inner_prod(const dvector &x, const basic_cvector<V> &y) {
+  assert(x.size() == y.size());
+  return inner_prod_dc_internal(x, y.data.indices.data(),
+                                y.data.values.data(), y.filled());
+}
+
 // result = x .* y [for all i, result(i) = x(i) * y(i)]
 template <class T, class U>
 double inner_prod_cvector_internal(T xbegin, T xend, U ybegin, U yend) {
@@ -919,15 +1534,18 @@ double inner_prod_cvector_internal(T xbegin, T xend, U ybegin, U yend) {
 }
 
 // return x' * y
-inline double inner_prod(const cvector &x, const cvector &y) {
+template <class V, class W>
+inline double inner_prod(const basic_cvector<V> &x,
+                         const basic_cvector<W> &y) {
   assert(x.size() == y.size());
   return inner_prod_cvector_internal(x.data.begin(), x.data.end(),
                                      y.data.begin(), y.data.end());
 }
 
 // return A(:,c)' * x
+template <class V>
 inline double inner_prod_column(const cmatrix &A, unsigned int c,
-                                const cvector &x) {
+                                const basic_cvector<V> &x) {
   assert(A.size1() == x.size());
   assert(0 <= c && c < A.size2());
   return inner_prod_cvector_internal(A.data.begin() + A.col_starts[c],
@@ -935,7 +1553,9 @@ inline double inner_prod_column(const cmatrix &A, unsigned int c,
                                      x.data.begin(), x.data.end());
 }
 
-inline void add(cvector &result, const cvector &x, const cvector &y) {
+template <class V>
+inline void add(basic_cvector<V> &result, const basic_cvector<V> &x,
+                const basic_cvector<V> &y) {
   typeof(x.data.begin()) xi, xend;
   typeof(y.data.begin()) yi, yend;
   unsigned int xind, yind;
@@ -1000,7 +1620,9 @@ main_loop_done:
   result.canonicalize();
 }
 
-inline void subtract(cvector &result, const cvector &x, const cvector &y) {
+template <class V>
+inline void subtract(basic_cvector<V> &result, const basic_cvector<V> &x,
+                     const basic_cvector<V> &y) {
   typeof(x.data.begin()) xi, xend;
   typeof(y.data.begin()) yi, yend;
   unsigned int xind, yind;
@@ -1067,6 +1689,10 @@ main_loop_done:
 
 // return true if for all i: x(i) >= y(i) - eps
 inline bool dominates(const dvector &x, const dvector &y, double eps) {
+  if (x.size() >= SLA_SIMD_MIN_LENGTH) {
+    return (*slaKernelsG.dominates)(x.data.data(), y.data.data(), x.size(),
+                                    eps);
+  }
   FOR(i, x.size()) {
     if (x(i) < y(i) - eps) return false;
   }
@@ -1074,7 +1700,9 @@ inline bool dominates(const dvector &x, const dvector &y, double eps) {
 }
 
 // return true if for all i: x(i) >= y(i) - eps
-inline bool dominates(const cvector &x, const cvector &y, double eps) {
+template <class V>
+inline bool dominates(const basic_cvector<V> &x, const basic_cvector<V> &y,
+                      double eps) {
   typeof(x.data.begin()) xi, xend;
   typeof(y.data.begin()) yi, yend;
   unsigned int xind, yind;
@@ -1174,6 +1802,9 @@ void write_to_file(const T &x, const std::string &file_name) {
 // select storage types of the data structures we use
 typedef sla::cvector state_vector;
 typedef sla::cvector belief_vector;
+// alpha vectors can be switched to sla::fcvector to store their values
+// as floats, which shrinks each entry from 12 bytes (uint32 index +
+// double) to 8 bytes (uint32 index + float), saving about a third
 typedef sla::cvector alpha_vector;
 typedef sla::dvector outcome_prob_vector;
 typedef sla::dvector obs_prob_vector;
@@ -41,10 +41,14 @@
 // FIX adjusting this based on observed bounds violations
 #define HASH_VECTOR_PRECISION "%6d:%15.9lf "
 #define HASH_VECTOR_LEN (24)
+// binary equivalent of HASH_VECTOR_PRECISION used by BeliefHash: values
+//   are rounded to this many units before hashing and comparison
+#define HASH_VECTOR_SCALE (1e+9)
 
 #if 0
 #define HASH_VECTOR_PRECISION "%5d:%6.4lf "
 #define HASH_VECTOR_LEN (14)
+#define HASH_VECTOR_SCALE (1e+4)
 #endif
 
 // convenience macros for iterating through compressed matrices and vectors
@@ -80,7 +84,8 @@ void set_to_zero(dmatrix &M);
 void set_to_zero(kmatrix &M);
 void set_to_zero(cmatrix &M);
 void set_to_zero(dvector &v);
-void set_to_zero(cvector &v);
+template <class V>
+void set_to_zero(basic_cvector<V> &v);
 
 /**********************************************************************
  * FUNCTIONS
@@ -95,7 +100,8 @@ inline void set_to_zero(cmatrix &M) { M.resize(M.size1(), M.size2()); }
 
 inline void set_to_zero(dvector &v) { v.resize(v.size()); }
 
-inline void set_to_zero(cvector &v) { v.resize(v.size()); }
+template <class V>
+inline void set_to_zero(basic_cvector<V> &v) { v.resize(v.size()); }
 
 }  // namespace MatrixUtils
 
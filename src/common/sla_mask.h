@@ -37,20 +37,40 @@ typedef cvector mvector;
 void mask_set_all(mvector &m, int msize);
 
 // for all i: result(i) = m(i) ? 1 : 0
-void mask_set_to_one(cvector &result, const mvector &m);
+template <class V, class W>
+void mask_set_to_one(basic_cvector<V> &result, const basic_cvector<W> &m);
 
 // return true if non-zeros of x constitute a subset of m
-bool mask_subset(const cvector &x, const mvector &m);
+template <class V>
+bool mask_subset(const basic_cvector<V> &x, const mvector &m);
+
+// the bit that index i sets in a mask signature
+uint64_t mask_signature_bit(unsigned int i);
+
+// returns a 64-bit Bloom-style signature of the entries of x.  if
+// mask_subset(x, m) then (mask_signature(x) & ~mask_signature(m)) == 0,
+// so most pairs that fail mask_subset() can be rejected without it.
+template <class V>
+uint64_t mask_signature(const basic_cvector<V> &x);
 
 // for all i: result(i) = m(i) ? x(i) : 0
-void mask_copy(cvector &result, const dvector &x, const mvector &m);
+template <class V>
+void mask_copy(basic_cvector<V> &result, const dvector &x, const mvector &m);
 
 // for all i: result(i) = mask(i) ? x(i) : 0
-void mask_copy(cvector &result, const cvector &x, const mvector &m);
+template <class V, class W>
+void mask_copy(basic_cvector<V> &result, const basic_cvector<W> &x,
+               const mvector &m);
+
+// for all i: result(i) = m(i) ? x(i) : 0
+template <class V>
+void mask_copy(basic_cvector<V> &result, const sparse_accum &x,
+               const mvector &m);
 
 // return true if [ym is a subset of xm] and [for all i: x(i) >= y(i) - eps]
-bool mask_dominates(const cvector &x, const cvector &y, double eps,
-                    const mvector &xm, const mvector &ym);
+template <class V>
+bool mask_dominates(const basic_cvector<V> &x, const basic_cvector<V> &y,
+                    double eps, const mvector &xm, const mvector &ym);
 
 /**********************************************************************
  * FUNCTIONS
@@ -64,10 +84,12 @@ inline void mask_set_all(mvector &m, int msize) {
 }
 
 // for all i: result(i) = m(i) ? 1 : 0
-inline void mask_set_to_one(cvector &result, const mvector &m) {
+template <class V, class W>
+inline void mask_set_to_one(basic_cvector<V> &result,
+                            const basic_cvector<W> &m) {
   typeof(result.data.begin()) ri, rend;
 
-  result = m;
+  copy(result, m);
   rend = result.data.end();
   for (ri = result.data.begin(); ri != rend; ri++) {
     ri->value = 1;
@@ -75,7 +97,8 @@ inline void mask_set_to_one(cvector &result, const mvector &m) {
 }
 
 // return true if non-zeros of x constitute a subset of m
-inline bool mask_subset(const cvector &x, const mvector &m) {
+template <class V>
+inline bool mask_subset(const basic_cvector<V> &x, const mvector &m) {
   assert(x.size() == m.size());
   typeof(x.data.begin()) xi, xend = x.data.end();
   typeof(m.data.begin()) mi, mend = m.data.end();
@@ -96,8 +119,24 @@ inline bool mask_subset(const cvector &x, const mvector &m) {
   return true;
 }
 
+// the bit that index i sets in a mask signature.  the multiplicative
+// hash spreads out indices that differ only in their high bits.
+inline uint64_t mask_signature_bit(unsigned int i) {
+  return ((uint64_t)1) << ((i * 0x9E3779B97F4A7C15ULL) >> 58);
+}
+
+// returns a 64-bit Bloom-style signature of the entries of x
+template <class V>
+inline uint64_t mask_signature(const basic_cvector<V> &x) {
+  uint64_t sig = 0;
+  FOR_EACH(xi, x.data) { sig |= mask_signature_bit(xi->index); }
+  return sig;
+}
+
 // for all i: result(i) = m(i) ? x(i) : 0
-inline void mask_copy(cvector &result, const dvector &x, const mvector &m) {
+template <class V>
+inline void mask_copy(basic_cvector<V> &result, const dvector &x,
+                      const mvector &m) {
   assert(x.size() == m.size());
   int mind;
 
@@ -110,7 +149,9 @@ inline void mask_copy(cvector &result, const dvector &x, const mvector &m) {
 }
 
 // for all i: result(i) = mask(i) ? x(i) : 0
-inline void mask_copy(cvector &result, const cvector &x, const mvector &m) {
+template <class V, class W>
+inline void mask_copy(basic_cvector<V> &result, const basic_cvector<W> &x,
+                      const mvector &m) {
   assert(x.size() == m.size());
   typeof(x.data.begin()) xi, xend = x.data.end();
   typeof(m.data.begin()) mi, mend = m.data.end();
@@ -134,8 +175,23 @@ inline void mask_copy(cvector &result, const cvector &x, const mvector &m) {
   result.canonicalize();
 }
 
+// for all i: result(i) = m(i) ? x(i) : 0
+template <class V>
+inline void mask_copy(basic_cvector<V> &result, const sparse_accum &x,
+                      const mvector &m) {
+  assert(x.size() == m.size());
+  result.resize(x.size());
+  FOR_EACH(mi, m.data) {
+    if (x.contains(mi->index)) {
+      result.push_back(mi->index, x.vals[mi->index]);
+    }
+  }
+}
+
 // return true if [ym is a subset of xm] and [for all i: x(i) >= y(i) - eps]
-inline bool mask_dominates(const cvector &x, const cvector &y, double eps,
+template <class V>
+inline bool mask_dominates(const basic_cvector<V> &x,
+                           const basic_cvector<V> &y, double eps,
                            const mvector &xm, const mvector &ym) {
   return mask_subset(ym, xm) && dominates(x, y, eps);
 }
@@ -0,0 +1,440 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+// the kernels must round exactly like the scalar code in sla.h, so
+// multiplies and adds must not be fused
+#pragma GCC optimize("fp-contract=off")
+
+#include "sla_simd.h"
+
+#include <algorithm>
+
+#include "sla.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SLA_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace sla {
+
+/**********************************************************************
+ * SCALAR KERNELS
+ **********************************************************************/
+
+static double scalar_dc_inner_prod(const double *x, const unsigned int *yidx,
+                                   const double *yval, unsigned int n) {
+  double sum = 0.0;
+  FOR(i, n) { sum += x[yidx[i]] * yval[i]; }
+  return sum;
+}
+
+static void scalar_scatter_add(double *result, double s,
+                               const unsigned int *yidx, const double *yval,
+                               unsigned int n) {
+  FOR(i, n) { result[yidx[i]] += s * yval[i]; }
+}
+
+static void scalar_dc_emult(double *result, const double *x,
+                            const unsigned int *yidx, const double *yval,
+                            unsigned int n) {
+  FOR(i, n) { result[yidx[i]] = x[yidx[i]] * yval[i]; }
+}
+
+static double scalar_dc_min_ratio(const double *x, const unsigned int *yidx,
+                                  const double *yval, unsigned int n,
+                                  double init) {
+  double m = init;
+  FOR(i, n) { m = std::min(m, x[yidx[i]] / yval[i]); }
+  return m;
+}
+
+static void scalar_emax(double *result, const double *x, const double *y,
+                        unsigned int n) {
+  FOR(i, n) { result[i] = std::max(x[i], y[i]); }
+}
+
+static void scalar_max_assign(double *result, const double *x,
+                              unsigned int n) {
+  FOR(i, n) {
+    if (x[i] > result[i]) result[i] = x[i];
+  }
+}
+
+static bool scalar_dominates(const double *x, const double *y, unsigned int n,
+                             double eps) {
+  FOR(i, n) {
+    if (x[i] < y[i] - eps) return false;
+  }
+  return true;
+}
+
+#if SLA_SIMD_X86
+
+/**********************************************************************
+ * AVX2 KERNELS
+ **********************************************************************/
+
+// indices are 32 bits and values are in a separate array, so each
+// step is one 128-bit index load, one 256-bit value load and a gather
+// with 32-bit offsets.
+
+#define SLA_AVX2_TARGET __attribute__((target("avx2")))
+
+// x[idx[k]] for k = 0..3.  the masked form with a zero source avoids
+// gcc's maybe-uninitialized warning on the unmasked intrinsic.
+SLA_AVX2_TARGET
+static inline __m256d avx2_gather(const double *x, __m128i idx) {
+  return _mm256_mask_i32gather_pd(
+      _mm256_setzero_pd(), x, idx,
+      _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+SLA_AVX2_TARGET
+static double avx2_dc_inner_prod(const double *x, const unsigned int *yidx,
+                                 const double *yval, unsigned int n) {
+  unsigned int i = 0;
+  __m256d acc = _mm256_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(yidx + i));
+    __m256d xv = avx2_gather(x, idx);
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(xv, _mm256_loadu_pd(yval + i)));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, acc);
+  double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < n; i++) {
+    sum += x[yidx[i]] * yval[i];
+  }
+  return sum;
+}
+
+SLA_AVX2_TARGET
+static void avx2_scatter_add(double *result, double s,
+                             const unsigned int *yidx, const double *yval,
+                             unsigned int n) {
+  unsigned int i = 0;
+  __m256d sv = _mm256_set1_pd(s);
+  for (; i + 4 <= n; i += 4) {
+    __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(yidx + i));
+    __m256d rv = avx2_gather(result, idx);
+    rv = _mm256_add_pd(rv, _mm256_mul_pd(sv, _mm256_loadu_pd(yval + i)));
+    // no scatter instruction in AVX2; the row indices within a column
+    // are distinct, so the stores can go in any order
+    double rx[4];
+    _mm256_storeu_pd(rx, rv);
+    result[yidx[i]] = rx[0];
+    result[yidx[i + 1]] = rx[1];
+    result[yidx[i + 2]] = rx[2];
+    result[yidx[i + 3]] = rx[3];
+  }
+  for (; i < n; i++) {
+    result[yidx[i]] += s * yval[i];
+  }
+}
+
+SLA_AVX2_TARGET
+static void avx2_dc_emult(double *result, const double *x,
+                          const unsigned int *yidx, const double *yval,
+                          unsigned int n) {
+  unsigned int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(yidx + i));
+    __m256d rv = _mm256_mul_pd(avx2_gather(x, idx),
+                               _mm256_loadu_pd(yval + i));
+    double rx[4];
+    _mm256_storeu_pd(rx, rv);
+    result[yidx[i]] = rx[0];
+    result[yidx[i + 1]] = rx[1];
+    result[yidx[i + 2]] = rx[2];
+    result[yidx[i + 3]] = rx[3];
+  }
+  for (; i < n; i++) {
+    result[yidx[i]] = x[yidx[i]] * yval[i];
+  }
+}
+
+// minpd(r,acc) returns acc unless r < acc, like std::min(acc, r)
+
+SLA_AVX2_TARGET
+static double avx2_dc_min_ratio(const double *x, const unsigned int *yidx,
+                                const double *yval, unsigned int n,
+                                double init) {
+  unsigned int i = 0;
+  __m256d acc = _mm256_set1_pd(init);
+  for (; i + 4 <= n; i += 4) {
+    __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(yidx + i));
+    __m256d rv = _mm256_div_pd(avx2_gather(x, idx), _mm256_loadu_pd(yval + i));
+    acc = _mm256_min_pd(rv, acc);
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, acc);
+  double m = init;
+  FOR(k, 4) { m = std::min(m, lanes[k]); }
+  for (; i < n; i++) {
+    m = std::min(m, x[yidx[i]] / yval[i]);
+  }
+  return m;
+}
+
+// note: maxpd(a,b) returns b unless a > b, so these match std::max()
+// and the scalar max_assign() exactly, including for NaNs and signed
+// zeros.
+
+SLA_AVX2_TARGET
+static void avx2_emax(double *result, const double *x, const double *y,
+                      unsigned int n) {
+  unsigned int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(result + i, _mm256_max_pd(_mm256_loadu_pd(y + i),
+                                                _mm256_loadu_pd(x + i)));
+  }
+  for (; i < n; i++) result[i] = std::max(x[i], y[i]);
+}
+
+SLA_AVX2_TARGET
+static void avx2_max_assign(double *result, const double *x, unsigned int n) {
+  unsigned int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(result + i, _mm256_max_pd(_mm256_loadu_pd(x + i),
+                                                _mm256_loadu_pd(result + i)));
+  }
+  for (; i < n; i++) {
+    if (x[i] > result[i]) result[i] = x[i];
+  }
+}
+
+SLA_AVX2_TARGET
+static bool avx2_dominates(const double *x, const double *y, unsigned int n,
+                           double eps) {
+  __m256d epsv = _mm256_set1_pd(eps);
+  unsigned int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d lt =
+        _mm256_cmp_pd(_mm256_loadu_pd(x + i),
+                      _mm256_sub_pd(_mm256_loadu_pd(y + i), epsv), _CMP_LT_OQ);
+    if (_mm256_movemask_pd(lt)) return false;
+  }
+  for (; i < n; i++) {
+    if (x[i] < y[i] - eps) return false;
+  }
+  return true;
+}
+
+/**********************************************************************
+ * AVX-512 KERNELS
+ **********************************************************************/
+
+// eight entries per step; a 256-bit load covers eight 32-bit indices.
+
+#define SLA_AVX512_TARGET __attribute__((target("avx512f")))
+
+// x[idx[k]] for k = 0..7 (see avx2_gather)
+SLA_AVX512_TARGET
+static inline __m512d avx512_gather(const double *x, __m256i idx) {
+  return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, idx, x, 8);
+}
+
+SLA_AVX512_TARGET
+static double avx512_dc_inner_prod(const double *x, const unsigned int *yidx,
+                                   const double *yval, unsigned int n) {
+  unsigned int i = 0;
+  __m512d acc = _mm512_setzero_pd();
+  for (; i + 8 <= n; i += 8) {
+    __m256i idx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(yidx + i));
+    __m512d xv = avx512_gather(x, idx);
+    acc = _mm512_add_pd(acc, _mm512_mul_pd(xv, _mm512_loadu_pd(yval + i)));
+  }
+  double lanes[8];
+  _mm512_storeu_pd(lanes, acc);
+  double sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+               ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+  for (; i < n; i++) {
+    sum += x[yidx[i]] * yval[i];
+  }
+  return sum;
+}
+
+SLA_AVX512_TARGET
+static void avx512_scatter_add(double *result, double s,
+                               const unsigned int *yidx, const double *yval,
+                               unsigned int n) {
+  unsigned int i = 0;
+  __m512d sv = _mm512_set1_pd(s);
+  for (; i + 8 <= n; i += 8) {
+    __m256i idx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(yidx + i));
+    __m512d rv = avx512_gather(result, idx);
+    rv = _mm512_add_pd(rv, _mm512_mul_pd(sv, _mm512_loadu_pd(yval + i)));
+    _mm512_i32scatter_pd(result, idx, rv, 8);
+  }
+  for (; i < n; i++) {
+    result[yidx[i]] += s * yval[i];
+  }
+}
+
+SLA_AVX512_TARGET
+static void avx512_dc_emult(double *result, const double *x,
+                            const unsigned int *yidx, const double *yval,
+                            unsigned int n) {
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i idx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(yidx + i));
+    __m512d rv = _mm512_mul_pd(avx512_gather(x, idx),
+                               _mm512_loadu_pd(yval + i));
+    _mm512_i32scatter_pd(result, idx, rv, 8);
+  }
+  for (; i < n; i++) {
+    result[yidx[i]] = x[yidx[i]] * yval[i];
+  }
+}
+
+SLA_AVX512_TARGET
+static double avx512_dc_min_ratio(const double *x, const unsigned int *yidx,
+                                  const double *yval, unsigned int n,
+                                  double init) {
+  unsigned int i = 0;
+  __m512d acc = _mm512_set1_pd(init);
+  for (; i + 8 <= n; i += 8) {
+    __m256i idx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(yidx + i));
+    __m512d rv =
+        _mm512_div_pd(avx512_gather(x, idx), _mm512_loadu_pd(yval + i));
+    // see avx2_dc_min_ratio; maskz form as in avx512_emax
+    acc = _mm512_maskz_min_pd(0xff, rv, acc);
+  }
+  double lanes[8];
+  _mm512_storeu_pd(lanes, acc);
+  double m = init;
+  FOR(k, 8) { m = std::min(m, lanes[k]); }
+  for (; i < n; i++) {
+    m = std::min(m, x[yidx[i]] / yval[i]);
+  }
+  return m;
+}
+
+SLA_AVX512_TARGET
+static void avx512_emax(double *result, const double *x, const double *y,
+                        unsigned int n) {
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // maskz form for the same reason as avx512_gather
+    __m512d m = _mm512_maskz_max_pd(0xff, _mm512_loadu_pd(y + i),
+                                    _mm512_loadu_pd(x + i));
+    _mm512_storeu_pd(result + i, m);
+  }
+  for (; i < n; i++) result[i] = std::max(x[i], y[i]);
+}
+
+SLA_AVX512_TARGET
+static void avx512_max_assign(double *result, const double *x,
+                              unsigned int n) {
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d m = _mm512_maskz_max_pd(0xff, _mm512_loadu_pd(x + i),
+                                    _mm512_loadu_pd(result + i));
+    _mm512_storeu_pd(result + i, m);
+  }
+  for (; i < n; i++) {
+    if (x[i] > result[i]) result[i] = x[i];
+  }
+}
+
+SLA_AVX512_TARGET
+static bool avx512_dominates(const double *x, const double *y, unsigned int n,
+                             double eps) {
+  __m512d epsv = _mm512_set1_pd(eps);
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __mmask8 lt = _mm512_cmp_pd_mask(
+        _mm512_loadu_pd(x + i), _mm512_sub_pd(_mm512_loadu_pd(y + i), epsv),
+        _CMP_LT_OQ);
+    if (lt) return false;
+  }
+  for (; i < n; i++) {
+    if (x[i] < y[i] - eps) return false;
+  }
+  return true;
+}
+
+#endif  // SLA_SIMD_X86
+
+/**********************************************************************
+ * DISPATCH
+ **********************************************************************/
+
+static const SlaKernels scalarKernels = {
+    SLA_KERNELS_SCALAR,  "scalar",          scalar_dc_inner_prod,
+    scalar_scatter_add,  scalar_dc_emult,   scalar_dc_min_ratio,
+    scalar_emax,         scalar_max_assign, scalar_dominates};
+
+#if SLA_SIMD_X86
+static const SlaKernels avx2Kernels = {
+    SLA_KERNELS_AVX2,    "avx2",          avx2_dc_inner_prod,
+    avx2_scatter_add,    avx2_dc_emult,   avx2_dc_min_ratio,
+    avx2_emax,           avx2_max_assign, avx2_dominates};
+
+static const SlaKernels avx512Kernels = {
+    SLA_KERNELS_AVX512,  "avx512",          avx512_dc_inner_prod,
+    avx512_scatter_add,  avx512_dc_emult,   avx512_dc_min_ratio,
+    avx512_emax,         avx512_max_assign, avx512_dominates};
+#endif
+
+// statically initialized to the scalar kernels, so sla operations in
+// other static initializers are safe; upgraded below during startup
+SlaKernels slaKernelsG = {
+    SLA_KERNELS_SCALAR,  "scalar",          scalar_dc_inner_prod,
+    scalar_scatter_add,  scalar_dc_emult,   scalar_dc_min_ratio,
+    scalar_emax,         scalar_max_assign, scalar_dominates};
+
+int sla_get_max_kernel_level(void) {
+#if SLA_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SLA_KERNELS_AVX512;
+  if (__builtin_cpu_supports("avx2")) return SLA_KERNELS_AVX2;
+#endif
+  return SLA_KERNELS_SCALAR;
+}
+
+int sla_set_kernel_level(int level) {
+  level = std::min(level, sla_get_max_kernel_level());
+  switch (level) {
+#if SLA_SIMD_X86
+    case SLA_KERNELS_AVX512:
+      slaKernelsG = avx512Kernels;
+      break;
+    case SLA_KERNELS_AVX2:
+      slaKernelsG = avx2Kernels;
+      break;
+#endif
+    default:
+      slaKernelsG = scalarKernels;
+      level = SLA_KERNELS_SCALAR;
+  }
+  return level;
+}
+
+struct SlaKernelsInitializer {
+  SlaKernelsInitializer(void) {
+    sla_set_kernel_level(sla_get_max_kernel_level());
+  }
+};
+static SlaKernelsInitializer slaKernelsInitializerG;
+
+}  // namespace sla
@@ -0,0 +1,83 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_COMMON_SLA_SIMD_H_
+#define ZMDP_SRC_COMMON_SLA_SIMD_H_
+
+// Vectorized versions of the inner loops of some sla.h operations.  The
+// implementation is selected when the program starts, according to the
+// instruction set extensions the CPU supports (AVX-512, AVX2, or plain
+// scalar code).  All kernels give exactly the same results as the
+// scalar loops in sla.h, except dc_inner_prod, which accumulates
+// partial sums in several lanes.  for n terms its result can differ
+// from the scalar sum by up to about 2 * n * DBL_EPSILON * (sum over i
+// of |x(i) * y(i)|).  (dc_min_ratio takes its minimum over several
+// lanes too, but min is exact, so only the sign of a zero result can
+// differ.)
+
+// vectors shorter than this are always handled by the inline scalar code
+#define SLA_SIMD_MIN_LENGTH (8)
+
+#define SLA_KERNELS_SCALAR (0)
+#define SLA_KERNELS_AVX2 (1)
+#define SLA_KERNELS_AVX512 (2)
+
+namespace sla {
+
+struct SlaKernels {
+  int level;
+  const char *name;
+
+  // the sparse operand y is given as n entries of the parallel arrays
+  // yidx (indices) and yval (values)
+
+  // return sum over y entries of x[index] * value
+  double (*dc_inner_prod)(const double *x, const unsigned int *yidx,
+                          const double *yval, unsigned int n);
+  // for each y entry: result[index] += s * value
+  void (*scatter_add)(double *result, double s, const unsigned int *yidx,
+                      const double *yval, unsigned int n);
+  // for each y entry: result[index] = x[index] * value
+  void (*dc_emult)(double *result, const double *x, const unsigned int *yidx,
+                   const double *yval, unsigned int n);
+  // return min(init, min over y entries of x[index] / value), taking
+  // each min with std::min(acc, ratio) semantics
+  double (*dc_min_ratio)(const double *x, const unsigned int *yidx,
+                         const double *yval, unsigned int n, double init);
+  // result[i] = max(x[i], y[i]), with std::max semantics
+  void (*emax)(double *result, const double *x, const double *y,
+               unsigned int n);
+  // if (x[i] > result[i]) result[i] = x[i]
+  void (*max_assign)(double *result, const double *x, unsigned int n);
+  // true if for all i: x[i] >= y[i] - eps
+  bool (*dominates)(const double *x, const double *y, unsigned int n,
+                    double eps);
+};
+
+// the kernels currently in use
+extern SlaKernels slaKernelsG;
+
+// returns the best level the CPU supports
+int sla_get_max_kernel_level(void);
+
+// switches to the given level (clipped to what the CPU supports) and
+// returns the level actually selected
+int sla_set_kernel_level(int level);
+
+}  // namespace sla
+
+#endif  // ZMDP_SRC_COMMON_SLA_SIMD_H_
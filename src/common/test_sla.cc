@@ -16,6 +16,10 @@
  ***************************************************************************/
 
 #include <assert.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include <fstream>
@@ -105,6 +109,44 @@ void test_cvector(void) {
        << xc(2) << " " << xc(3) << endl;
 }
 
+void test_fcvector(void) {
+  istringstream iss(
+      "5 "
+      "3 "
+      "0 0.5 "
+      "2 1.25 "
+      "4 -2 ");
+  fcvector xf;
+  xf.read(iss);
+  cout << "--xf: size=5 data=0.5 0 1.25 0 -2" << endl;
+  cout << "  xf: size=" << xf.size() << " data=" << xf(0) << " " << xf(1)
+       << " " << xf(2) << " " << xf(3) << " " << xf(4) << endl;
+
+  // mixed float/double operations
+  cvector yc;
+  copy(yc, xf);
+  yc *= 2;
+  cout << "--inner_prod(xf,yc): 11.625" << endl;
+  cout << "  inner_prod(xf,yc): " << inner_prod(xf, yc) << endl;
+
+  dvector yd;
+  copy(yd, yc);
+  cout << "--inner_prod(yd,xf): 11.625" << endl;
+  cout << "  inner_prod(yd,xf): " << inner_prod(yd, xf) << endl;
+
+  fcvector zf;
+  add(zf, xf, xf);
+  cout << "--zf: data=1 0 2.5 0 -4" << endl;
+  cout << "  zf: data=" << zf(0) << " " << zf(1) << " " << zf(2) << " "
+       << zf(3) << " " << zf(4) << endl;
+
+  cout << "--entry bytes: double=12 float=8" << endl;
+  cout << "  entry bytes: double="
+       << sizeof(unsigned int) + sizeof(cvector::value_type)
+       << " float=" << sizeof(unsigned int) + sizeof(fcvector::value_type)
+       << endl;
+}
+
 void test_dmatrix(void) {
   dmatrix Ad;
   Ad.resize(2, 2);
@@ -436,6 +478,53 @@ void test_binary(void) {
   cout << "  ydx: " << ydx << endl;
 }
 
+void test_accum(void) {
+  cmatrix Ac;
+  cvector xc, yc, zc;
+  sparse_accum acc;
+
+  istringstream iss(
+      "3 3 "
+      "4 "
+      "0 0 2 "
+      "2 0 1 "
+      "0 1 5 "
+      "1 2 3 ");
+  Ac.read(iss);
+
+  istringstream iss2(
+      "3 "
+      "2 "
+      "0 7 "
+      "1 11 ");
+  xc.read(iss2);
+
+  // acc = A * x, then acc += A * x
+  mult(acc, Ac, xc);
+  cout << "--acc: filled=2 data=69 0 7" << endl;
+  cout << "  acc: filled=" << acc.filled() << " data=" << acc(0) << " "
+       << acc(1) << " " << acc(2) << endl;
+  mult_add(acc, Ac, xc);
+  acc.canonicalize();
+  copy(yc, acc);
+  cout << "--yc: filled=2 data=138 0 14" << endl;
+  cout << "  yc: filled=" << yc.filled() << " data=" << yc(0) << " " << yc(1)
+       << " " << yc(2) << endl;
+
+  emult_column(zc, Ac, 0, acc);
+  cout << "--zc: 276 0 14" << endl;
+  cout << "  zc: " << zc(0) << " " << zc(1) << " " << zc(2) << endl;
+
+  // reuse after clear() only sees the new entries
+  acc.clear();
+  acc.add(1, 4);
+  acc.canonicalize();
+  copy(yc, acc);
+  cout << "--yc: filled=1 data=0 4 0" << endl;
+  cout << "  yc: filled=" << yc.filled() << " data=" << yc(0) << " " << yc(1)
+       << " " << yc(2) << endl;
+}
+
 void test_mask(void) {
   dvector zd;
   cvector xc, yc, zc;
@@ -526,6 +615,125 @@ void test_performance(void) {
   write_to_file(result_out, "result.dat");
 }
 
+static double elapsed_seconds(const timeval &start_time,
+                              const timeval &end_time) {
+  return (end_time.tv_sec - start_time.tv_sec) +
+         1e-6 * (end_time.tv_usec - start_time.tv_usec);
+}
+
+// fill x with a random sparse vector of the given size, with roughly
+// the given fraction of entries filled
+static void random_cvector(cvector &x, unsigned int size, double density) {
+  x.resize(size);
+  FOR(i, size) {
+    if (drand48() < density) {
+      x.push_back(i, drand48() - 0.3);
+    }
+  }
+}
+
+static void random_dvector(dvector &x, unsigned int size) {
+  x.resize(size);
+  FOR(i, size) { x(i) = drand48() - 0.3; }
+}
+
+// runs each of the kernel-backed operations at the given kernel level
+// and stores the results
+struct SimdResults {
+  dvector multResult, emultResult, emaxResult, maxAssignResult;
+  std::vector<double> innerProds;
+  double minRatio;
+  bool dom1, dom2;
+  double seconds;
+};
+
+static void run_simd_ops(SimdResults &r, int numReps, const cmatrix &A,
+                         const cvector &xc, const dvector &xd,
+                         const dvector &yd) {
+  timeval start_time, end_time;
+  gettimeofday(&start_time, 0);
+  r.innerProds.clear();
+  FOR(rep, numReps) {
+    mult(r.multResult, A, xc);
+    emult_column(r.emultResult, A, rep % A.size2(), xd);
+    emax(r.emaxResult, xd, yd);
+    r.maxAssignResult = xd;
+    max_assign(r.maxAssignResult, yd);
+    r.innerProds.push_back(inner_prod(xd, xc));
+    r.minRatio = min_ratio_dc_internal(xd.data.data(), xc.data.indices.data(),
+                                       xc.data.values.data(), xc.filled(),
+                                       99e+20);
+    r.dom1 = dominates(r.emaxResult, xd, 0);
+    r.dom2 = dominates(xd, yd, 1e-10);
+  }
+  gettimeofday(&end_time, 0);
+  r.seconds = elapsed_seconds(start_time, end_time);
+}
+
+static bool same_dvector(const dvector &x, const dvector &y) {
+  if (x.size() != y.size()) return false;
+  return 0 == memcmp(x.data.data(), y.data.data(), x.size() * sizeof(double));
+}
+
+// check that the vectorized kernels match the scalar ones, and time them
+void test_simd_kernels(void) {
+  const unsigned int n = 2000;
+  const int numReps = 200;
+  srand48(17);
+
+  kmatrix Ak(n, n);
+  FOR(c, n) {
+    FOR(k, 20) { Ak.push_back(lrand48() % n, c, drand48()); }
+  }
+  Ak.canonicalize();
+  cmatrix A;
+  copy(A, Ak);
+
+  cvector xc;
+  dvector xd, yd;
+  random_cvector(xc, n, 0.3);
+  random_dvector(xd, n);
+  random_dvector(yd, n);
+
+  int maxLevel = sla_get_max_kernel_level();
+  SimdResults base;
+  sla_set_kernel_level(SLA_KERNELS_SCALAR);
+  run_simd_ops(base, numReps, A, xc, xd, yd);
+  printf("kernels %-8s %8.3f ms per rep\n", slaKernelsG.name,
+         1000 * base.seconds / numReps);
+
+  for (int level = SLA_KERNELS_SCALAR + 1; level <= maxLevel; level++) {
+    sla_set_kernel_level(level);
+    SimdResults r;
+    run_simd_ops(r, numReps, A, xc, xd, yd);
+
+    bool exactOk = same_dvector(r.multResult, base.multResult) &&
+                   same_dvector(r.emultResult, base.emultResult) &&
+                   same_dvector(r.emaxResult, base.emaxResult) &&
+                   same_dvector(r.maxAssignResult, base.maxAssignResult) &&
+                   r.minRatio == base.minRatio &&
+                   r.dom1 == base.dom1 && r.dom2 == base.dom2;
+
+    // inner_prod sums in a different order; check against the bound
+    // documented in sla_simd.h
+    double absSum = 0.0;
+    FOR_EACH(xi, xc.data) { absSum += fabs(xd(xi->index) * xi->value); }
+    double tol = 2 * xc.filled() * DBL_EPSILON * absSum;
+    bool sumOk = true;
+    FOR(i, r.innerProds.size()) {
+      if (fabs(r.innerProds[i] - base.innerProds[i]) > tol) sumOk = false;
+    }
+
+    cout << "--" << slaKernelsG.name << " exact: 1 inner_prod: 1" << endl;
+    cout << "  " << slaKernelsG.name << " exact: " << exactOk
+         << " inner_prod: " << sumOk << endl;
+    printf("kernels %-8s %8.3f ms per rep (%.2fx)\n", slaKernelsG.name,
+           1000 * r.seconds / numReps, base.seconds / r.seconds);
+  }
+
+  sla_set_kernel_level(maxLevel);
+}
+
 void usage(void) {
   cerr << "usage: test_sla\n"
           "  -h or --help   Print this help\n";
@@ -550,6 +758,7 @@ int main(int argc, char **argv) {
 
   test_dvector();
   test_cvector();
+  test_fcvector();
   test_dmatrix();
   test_kmatrix();
   test_cmatrix();
@@ -557,6 +766,8 @@ int main(int argc, char **argv) {
   test_unary();
   test_binary();
   test_mask();
+  test_accum();
+  test_simd_kernels();
 
   test_performance();
 
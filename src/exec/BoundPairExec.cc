@@ -73,6 +73,8 @@ void BoundPairExec::initReadFiles(const std::string &modelFileName,
   gettimeofday(&tv1, NULL);
   if (policyType == "maxPlanes") {
     lb->readFromFile(policyFileName);
+  } else if (policyType == "maxPlanesBinary") {
+    lb->readFromBinaryFile(policyFileName);
   } else if (policyType == "cassandraAlpha") {
     lb->readFromCassandraAlphaFile(policyFileName);
   } else {
@@ -99,13 +101,17 @@ void BoundPairExec::setToInitialState(void) {
   currentStateInitialized = true;
 }
 
+// actions and observations passed in and out of the exec use the ids
+// of the model file
 int BoundPairExec::chooseAction(void) {
-  return bounds->chooseAction(currentState);
+  return mdp->getOriginalActionId(bounds->chooseAction(currentState));
 }
 
 void BoundPairExec::advanceToNextState(int a, int o) {
   state_vector nextState;
-  mdp->getNextState(nextState, currentState, a, o);
+  a = mdp->getCompactActionId(a);
+  mdp->getNextState(nextState, currentState, a,
+                    mdp->getMergedOutcomeId(a, o));
   currentState = nextState;
 }
 
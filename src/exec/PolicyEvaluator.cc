@@ -200,7 +200,9 @@ void PolicyEvaluator::doBatchCache(dvector &rewards, double &successRate,
         a = simState->userInt;
       }
 
-      Qa = modelCache->getQ(*simState, a);
+      // the exec uses the action ids of the model file
+      int simA = simModel->getCompactActionId(a);
+      Qa = modelCache->getQ(*simState, simA);
       int o = chooseFromDistribution(Qa->opv);
       CMDPEdge *e = Qa->outcomes[o];
       assert(NULL != e);
@@ -209,7 +211,7 @@ void PolicyEvaluator::doBatchCache(dvector &rewards, double &successRate,
       } else {
         e->userInt++;
       }
-      trials[i].push_back(PESimLogEntry(simState, a, o));
+      trials[i].push_back(PESimLogEntry(simState, simA, o));
 
       if (simOutFileTmp) {
         (*simOutFileTmp) << "sim: [" << sparseRep(simState->s) << "] " << a
@@ -331,7 +333,7 @@ void PolicyEvaluator::doBatchSimple(dvector &rewards, double &successRate,
          (j < evaluationMaxStepsPerTrial) || (0 == evaluationMaxStepsPerTrial);
          j++) {
       int a = exec->chooseAction();
-      sim->performAction(a);
+      sim->performAction(simModel->getCompactActionId(a));
       if (assumeIdenticalModels) {
         (reinterpret_cast<MDPExec *>(exec))->currentState = sim->state;
       } else {
@@ -149,23 +149,11 @@ void TestDriver::batchTestIncremental(
       logLastSimTime = ::log(timeSoFar);
 
       // write output policy at each evaluation epoch if that was requested
+      // (writePolicy() replaces the file atomically, so the policy from
+      // the last epoch survives if writing is interrupted)
       if (NULL != outPolicyFileName) {
-        // create a backup of the policy from the last epoch in case policy
-        // writing is interrupted
-        string cmd = string("mv ") + outPolicyFileName + " " +
-                     outPolicyFileName + ".bak >& /dev/null";
-        if (0 != system(cmd.c_str())) {
-          fprintf(stderr, "failed to make policy backup");
-        }
-
         so.bounds->writePolicy(outPolicyFileName,
                                /* canModifyBounds = */ false);
-
-        // delete the backup
-        cmd = string("rm -f ") + outPolicyFileName + ".bak >& /dev/null";
-        if (0 != system(cmd.c_str())) {
-          fprintf(stderr, "failed to delete policy backup");
-        }
       }
 
       // simulate running the policy many times and collect the per-run total
@@ -205,32 +193,35 @@ void TestDriver::batchTestIncremental(
 
         AbstractBound *lb = so.bounds->lowerBound;
         int lbNumElts1 = 0, lbNumEntries1 = 0, lbNumElts2 = 0,
-            lbNumEntries2 = 0;
+            lbNumEntries2 = 0, lbNumIndexEntries = 0;
         if (lb) {
           lbNumElts1 = lb->getStorage(ZMDP_S_NUM_ELTS);
           lbNumEntries1 = lb->getStorage(ZMDP_S_NUM_ENTRIES);
           lbNumElts2 = lb->getStorage(ZMDP_S_NUM_ELTS_TABULAR);
           lbNumEntries2 = lb->getStorage(ZMDP_S_NUM_ENTRIES_TABULAR);
+          lbNumIndexEntries = lb->getStorage(ZMDP_S_NUM_INDEX_ENTRIES);
         }
 
         AbstractBound *ub = so.bounds->upperBound;
         int ubNumElts1 = 0, ubNumEntries1 = 0, ubNumElts2 = 0,
-            ubNumEntries2 = 0;
+            ubNumEntries2 = 0, ubNumIndexEntries = 0;
         if (ub) {
           ubNumElts1 = ub->getStorage(ZMDP_S_NUM_ELTS);
           ubNumEntries1 = ub->getStorage(ZMDP_S_NUM_ENTRIES);
           ubNumElts2 = ub->getStorage(ZMDP_S_NUM_ELTS_TABULAR);
           ubNumEntries2 = ub->getStorage(ZMDP_S_NUM_ENTRIES_TABULAR);
+          ubNumIndexEntries = ub->getStorage(ZMDP_S_NUM_INDEX_ENTRIES);
         }
 
         int totalEntries =
             lbNumEntries1 + lbNumEntries2 + ubNumEntries1 + ubNumEntries2;
 
         snprintf(sbuf, sizeof(sbuf),
-                 "%10lf %10d %10d %10d %10d %10d %10d %10d %10d %10d",
+                 "%10lf %10d %10d %10d %10d %10d %10d %10d %10d %10d"
+                 " %10d %10d",
                  timeSoFar, totalEntries, lbNumElts1, lbNumEntries1, lbNumElts2,
                  lbNumEntries2, ubNumElts1, ubNumEntries1, ubNumElts2,
-                 ubNumEntries2);
+                 ubNumEntries2, lbNumIndexEntries, ubNumIndexEntries);
 
         (*storageOutputFile) << sbuf << endl;
         storageOutputFile->flush();
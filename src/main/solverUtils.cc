@@ -31,6 +31,7 @@
 #include <string>
 
 #include "MatrixUtils.h"
+#include "ThreadPool.h"
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTime.h"
 
@@ -114,6 +115,9 @@ void SolverParams::setValues(const ZMDPConfig &config) {
   // depend on ZMDPConfig
   zmdpDebugLevelG = config.getInt("debugLevel");
 
+  // size the global thread pool
+  threadPoolG.setNumThreads(config.getInt("numThreads"));
+
   if (zmdpDebugLevelG >= 1) {
     cout << "[params begin]" << endl;
     config.writeToStream(cout);
@@ -163,14 +167,14 @@ void SolverParams::setValues(const ZMDPConfig &config) {
 void SolverParams::inferMissingValues(void) {
   // fill in default and inferred values
   if (-1 == modelType) {
-    if (endsWith(probName, ".pomdp")) {
+    if (endsWith(probName, ".pomdp") || endsWith(probName, ".pomdpc")) {
       if (zmdpDebugLevelG >= 1) {
         printf(
             "[params] inferred modelType='pomdp' from model filename "
             "extension\n");
       }
       modelType = T_POMDP;
-    } else if (endsWith(probName, ".mdp")) {
+    } else if (endsWith(probName, ".mdp") || endsWith(probName, ".mdpc")) {
       if (zmdpDebugLevelG >= 1) {
         printf(
             "[params] inferred modelType='mdp' from model filename "
@@ -27,6 +27,7 @@
 #include "LSPathAndReactExec.h"
 #include "MDPSim.h"
 #include "MatrixUtils.h"
+#include "MaxPlanesLowerBound.h"
 #include "PolicyEvaluator.h"
 #include "TestDriver.h"
 #include "embedFiles.h"
@@ -39,7 +40,13 @@ using namespace std;
 using namespace MatrixUtils;
 using namespace zmdp;
 
-enum CommandsEnum { CMD_SOLVE, CMD_BENCHMARK, CMD_EVALUATE };
+enum CommandsEnum {
+  CMD_SOLVE,
+  CMD_BENCHMARK,
+  CMD_EVALUATE,
+  CMD_CONVERT,
+  CMD_COMPILE
+};
 
 bool userTerminatedG = false;
 
@@ -127,6 +134,10 @@ void doSolve(const ZMDPConfig &config) {
            static_cast<int>(run.elapsedTime()));
   }
 
+  if (zmdpDebugLevelG >= 1 && NULL != so.bounds) {
+    so.bounds->arena.printMemoryReport(stdout, "search graph");
+  }
+
   // write out a policy
   if (NULL == p.policyOutputFile) {
     printf("%05d (not outputting policy)\n",
@@ -193,7 +204,8 @@ void doEvaluate(const ZMDPConfig &config) {
   MDPExecCore *exec = NULL;
   MDPExec *mdpExec = NULL;
   std::string policyType = config.getString("policyType");
-  if (policyType == "maxPlanes" || policyType == "cassandraAlpha") {
+  if (policyType == "maxPlanes" || policyType == "maxPlanesBinary" ||
+      policyType == "cassandraAlpha") {
     BoundPairExec *bpExec = new BoundPairExec();
     bpExec->initReadFiles(plannerModelFileName, policyFileName, config);
     exec = mdpExec = bpExec;
@@ -220,12 +232,17 @@ void doEvaluate(const ZMDPConfig &config) {
     simPomdp = reinterpret_cast<Pomdp *>(mdpExec->mdp);
     assumeIdenticalModels = true;
   } else {
-    simPomdp = new Pomdp(simModelFileName, &config);
+    // the simulator should draw observations the way the model file
+    // does, so don't merge them
+    ZMDPConfig simConfig(config);
+    simConfig.setBool("aggregateObservationsAndActions", false);
+    simPomdp = new Pomdp(simModelFileName, &simConfig);
 
     if (mdpExec != NULL) {
       Pomdp *plannerPomdp = reinterpret_cast<Pomdp *>(mdpExec->mdp);
 
-      if (!((plannerPomdp->getNumActions() == simPomdp->getNumActions()) &&
+      if (!((plannerPomdp->getNumOriginalActions() ==
+             simPomdp->getNumActions()) &&
             (plannerPomdp->getNumObservations() ==
              simPomdp->getNumObservations()))) {
         printf(
@@ -259,6 +276,100 @@ void doEvaluate(const ZMDPConfig &config) {
          quantile2);
 }
 
+void doConvert(const ZMDPConfig &config) {
+  const char *modelFileName = config.getString("plannerModel").c_str();
+  if (0 == strcmp(modelFileName, "-")) {
+    modelFileName = config.getString("simulatorModel").c_str();
+  }
+  std::string inFileName = config.getString("policyInputFile");
+  std::string outFileName = config.getString("policyOutputFile");
+  std::string policyType = config.getString("policyType");
+  if (outFileName == "none") {
+    fprintf(stderr,
+            "ERROR: zmdp convert needs an output file, specify it with -o "
+            "(use -h for help)\n");
+    exit(EXIT_FAILURE);
+  }
+  if (policyType != "maxPlanes" && policyType != "maxPlanesBinary") {
+    fprintf(stderr,
+            "ERROR: zmdp convert can only write policies of type 'maxPlanes' "
+            "or 'maxPlanesBinary' (got '%s')\n",
+            policyType.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  // the model is needed for its number of states and actions.  the
+  // policy is copied as-is, so keep every state and action of the model.
+  ZMDPConfig modelConfig(config);
+  modelConfig.setBool("compactReachableStates", false);
+  modelConfig.setBool("aggregateObservationsAndActions", false);
+  Pomdp *pomdp = new Pomdp(modelFileName, &modelConfig);
+  MaxPlanesLowerBound lb(pomdp, &config);
+
+  StopWatch run;
+  bool inputIsBinary = MaxPlanesLowerBound::isBinaryFile(inFileName);
+  printf("reading policy of type '%s' from %s\n",
+         inputIsBinary ? "maxPlanesBinary" : "maxPlanes", inFileName.c_str());
+  if (inputIsBinary) {
+    lb.readFromBinaryFile(inFileName);
+  } else {
+    lb.readFromFile(inFileName);
+  }
+  printf("  (read %d planes in %.3f seconds)\n", (int)lb.planes.size(),
+         run.elapsedTime());
+
+  run.restart();
+  printf("writing policy of type '%s' to %s\n", policyType.c_str(),
+         outFileName.c_str());
+  lb.writePolicyFile(outFileName, policyType == "maxPlanesBinary");
+  printf("  (took %.3f seconds)\n", run.elapsedTime());
+}
+
+void doCompile(const ZMDPConfig &config) {
+  SolverParams p;
+  p.setValues(config);
+
+  std::string outFileName;
+  if (NULL == p.policyOutputFile) {
+    outFileName = std::string(p.probName) + "c";
+  } else {
+    outFileName = p.policyOutputFile;
+  }
+  if (CassandraModel::isCompiledFile(p.probName)) {
+    fprintf(stderr, "ERROR: model %s is already compiled\n", p.probName);
+    exit(EXIT_FAILURE);
+  }
+
+  // the compiled model has the same states, actions and observations
+  // as the model file
+  ZMDPConfig modelConfig(config);
+  modelConfig.setBool("compactReachableStates", false);
+  modelConfig.setBool("aggregateObservationsAndActions", false);
+
+  StopWatch run;
+  printf("reading model from %s\n", p.probName);
+  CassandraModel *model;
+  switch (p.modelType) {
+    case T_POMDP:
+      model = new Pomdp(p.probName, &modelConfig);
+      break;
+    case T_MDP:
+      model = new GenericDiscreteMDP(p.probName, &modelConfig);
+      break;
+    default:
+      fprintf(stderr,
+              "ERROR: zmdp compile only handles models of type 'pomdp' or "
+              "'mdp' (use -h for help)\n");
+      exit(EXIT_FAILURE);
+  }
+  printf("  (took %.3f seconds)\n", run.elapsedTime());
+
+  run.restart();
+  printf("writing compiled model to %s\n", outFileName.c_str());
+  model->writeCompiledFile(outFileName);
+  printf("  (took %.3f seconds)\n", run.elapsedTime());
+}
+
 void solveUsage(const char *cmd0) {
   cerr
       << "usage: " << cmd0
@@ -398,6 +509,71 @@ void evaluateUsage(const char *cmd0) {
   exit(-1);
 }
 
+void convertUsage(const char *cmd0) {
+  cerr << "usage: " << cmd0
+       << " convert [options] <model>\n"
+          "  Run 'zmdp -h' for an overview of commands and generic options.\n"
+          "\n"
+          "  'zmdp convert' converts a policy output by 'zmdp solve' or 'zmdp\n"
+          "  benchmark' between the text format (policyType 'maxPlanes') and\n"
+          "  the binary format (policyType 'maxPlanesBinary').  The format of "
+          "the\n"
+          "  input policy is detected automatically; the output policy has "
+          "the\n"
+          "  format given by policyType.  The model is used to check that the\n"
+          "  policy fits it.\n"
+          "\n"
+          "Commonly used options:\n"
+          "  -f                      Use fast model parser\n"
+          "  -o <file>               Specify where to write the converted "
+          "policy\n"
+          "  --policyInputFile <file> Specify the policy to convert "
+          "[out.policy]\n"
+          "  --policyType <type>     Output format, 'maxPlanes' or "
+          "'maxPlanesBinary'\n"
+          "\n"
+          "Examples:\n"
+          "  "
+       << cmd0
+       << " convert --policyType maxPlanesBinary -o out.bpolicy "
+          "RockSample_4_4.pomdp\n"
+          "  "
+       << cmd0
+       << " convert --policyInputFile out.bpolicy --policyType maxPlanes -o "
+          "out.policy RockSample_4_4.pomdp\n"
+          "\n";
+  exit(-1);
+}
+
+void compileUsage(const char *cmd0) {
+  cerr << "usage: " << cmd0
+       << " compile [options] <model>\n"
+          "  Run 'zmdp -h' for an overview of commands and generic options.\n"
+          "\n"
+          "  'zmdp compile' parses a POMDP or MDP model in Cassandra's text\n"
+          "  format and writes it out in a binary format that loads much\n"
+          "  faster.  Compiled models can be passed to the other commands in\n"
+          "  place of the text model; they are recognized by their contents,\n"
+          "  and the extensions '.pomdpc' and '.mdpc' are used to infer the\n"
+          "  model type.\n"
+          "\n"
+          "Commonly used options:\n"
+          "  -f                      Use fast model parser\n"
+          "  -o <file>               Specify where to write the compiled model\n"
+          "                            [<model>c, e.g. foo.pomdp -> "
+          "foo.pomdpc]\n"
+          "\n"
+          "Examples:\n"
+          "  "
+       << cmd0
+       << " compile -f RockSample_7_8.pomdp\n"
+          "  "
+       << cmd0
+       << " solve RockSample_7_8.pomdpc\n"
+          "\n";
+  exit(-1);
+}
+
 void genericUsage(const char *cmd0) {
   cerr
       << "usage: " << cmd0
@@ -410,6 +586,10 @@ void genericUsage(const char *cmd0) {
          "the solution process\n"
          "  zmdp evaluate   Evaluates a policy output by 'solve' or "
          "'benchmark'\n"
+         "  zmdp convert    Converts a policy between the text and binary "
+         "formats\n"
+         "  zmdp compile    Compiles a model to a binary file that loads "
+         "quickly\n"
          "\n"
          "  For more information on a command, run (for example), 'zmdp solve "
          "-h'.\n"
@@ -458,6 +638,10 @@ void usage(const char *cmd0, const std::string &cmd1) {
     benchmarkUsage(cmd0);
   } else if (cmd1 == "evaluate") {
     evaluateUsage(cmd0);
+  } else if (cmd1 == "convert") {
+    convertUsage(cmd0);
+  } else if (cmd1 == "compile") {
+    compileUsage(cmd0);
   } else {
     genericUsage(cmd0);
   }
@@ -487,7 +671,8 @@ int main(int argc, char **argv) {
     if (args == "bench") {
       args = "benchmark";
     }
-    if (args == "solve" || args == "benchmark" || args == "evaluate") {
+    if (args == "solve" || args == "benchmark" || args == "evaluate" ||
+        args == "convert" || args == "compile") {
       cmd1 = args;
     }
 
@@ -560,6 +745,10 @@ int main(int argc, char **argv) {
     cmd = CMD_BENCHMARK;
   } else if (cmdStr == "evaluate") {
     cmd = CMD_EVALUATE;
+  } else if (cmdStr == "convert") {
+    cmd = CMD_CONVERT;
+  } else if (cmdStr == "compile") {
+    cmd = CMD_COMPILE;
   } else {
     fprintf(stderr, "ERROR: unknown command '%s' (use -h for help)\n",
             cmdStr.c_str());
@@ -584,6 +773,8 @@ int main(int argc, char **argv) {
         break;
       case CMD_BENCHMARK:
       case CMD_EVALUATE:
+      case CMD_CONVERT:
+      case CMD_COMPILE:
         config.setString("policyOutputFile", "none");
         break;
       default:
@@ -609,6 +800,12 @@ int main(int argc, char **argv) {
     case CMD_EVALUATE:
       doEvaluate(config);
       break;
+    case CMD_CONVERT:
+      doConvert(config);
+      break;
+    case CMD_COMPILE:
+      doCompile(config);
+      break;
     default:
       assert(0);  // never reach this point
   }
@@ -114,9 +114,9 @@ CMDPNode *CacheMDP::getNode(const state_vector &s) {
 }
 
 CMDPNode *CacheMDP::getNodeX(const state_vector &s) {
-  string hs = hashable(s);
-  CMDPHash::iterator pr = lookup.find(hs);
-  if (lookup.end() == pr) {
+  uint64_t hs = hashStateVector(s);
+  int *pr = lookup.findHashed(s, hs);
+  if (NULL == pr) {
     // create a new fringe node
     int si = nodeTable.size();
     CMDPNode &cn = *(new CMDPNode);
@@ -126,11 +126,11 @@ CMDPNode *CacheMDP::getNodeX(const state_vector &s) {
     cn.Q.resize(problem->getNumActions(), NULL);
     cn.userInt = -1;
     nodeTable.push_back(&cn);
-    lookup[hs] = si;
+    lookup.insertHashed(&cn.s, si, hs);
     return &cn;
   } else {
     // return existing node
-    return nodeTable[pr->second];
+    return nodeTable[*pr];
   }
 }
 
@@ -138,14 +138,13 @@ CMDPQEntry *CacheMDP::getQ(CMDPNode &cn, int a) {
   if (NULL == cn.Q[a]) {
     CMDPQEntry &Qa = *(new CMDPQEntry);
     Qa.immediateReward = problem->getReward(cn.s, a);
-    problem->getOutcomeProbVector(Qa.opv, cn.s, a);
+    std::vector<state_vector> nextStates;
+    problem->getOutcomes(Qa.opv, nextStates, cn.s, a);
     Qa.outcomes.resize(Qa.opv.size(), NULL);
     FOR(o, Qa.opv.size()) {
       if (Qa.opv(o) > OBS_IS_ZERO_EPS) {
         CMDPEdge *e = new CMDPEdge;
-        state_vector sp;
-        problem->getNextState(sp, cn.s, a, o);
-        e->nextState = getNodeX(sp);
+        e->nextState = getNodeX(nextStates[o]);
         e->userInt = -1;
         e->userDouble = 0.0;
         Qa.outcomes[o] = e;
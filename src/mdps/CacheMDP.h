@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "AbstractBound.h"
+#include "BeliefHash.h"
 #include "MDPModel.h"
 #include "zmdpConfig.h"
 
@@ -64,7 +65,8 @@ struct CMDPNode {
   size_t getNumActions(void) const { return Q.size(); }
 };
 
-typedef EXT_NAMESPACE::hash_map<std::string, int> CMDPHash;
+// maps each node's state vector to its index in the node table
+typedef BeliefHash<int> CMDPHash;
 typedef std::vector<CMDPNode *> CMDPNodeTable;
 
 struct CacheMDP : public MDP {
@@ -47,11 +47,15 @@ GenericDiscreteMDP::GenericDiscreteMDP(const std::string &fileName,
                                        const ZMDPConfig *config)
     : boundsInitialized(false) {
   bool useFastModelParser = config->getBool("useFastModelParser");
-  if (useFastModelParser) {
+  bool useCanonicalModelParser = config->getBool("useCanonicalModelParser");
+  if (isCompiledFile(fileName)) {
+    readCompiledFile(fileName, /* expectPomdp = */ false);
+  } else if (useFastModelParser && !useCanonicalModelParser) {
     FastParser parser;
     parser.readGenericDiscreteMDPFromFile(*this, fileName);
   } else {
     CassandraParser parser;
+    parser.useCanonicalParser = useCanonicalModelParser;
     parser.readGenericDiscreteMDPFromFile(*this, fileName);
   }
 
@@ -109,6 +113,26 @@ state_vector &GenericDiscreteMDP::getNextState(state_vector &result,
   assert(0);  // never reach this point
 }
 
+void GenericDiscreteMDP::getOutcomes(outcome_prob_vector &opv,
+                                     std::vector<state_vector> &nextStates,
+                                     const state_vector &sv, int a) {
+  int s = static_cast<int>(sv(0));
+
+  // a single pass over column s of Ttr[a] gives both the outcome
+  // probabilities and the corresponding next states, avoiding the
+  // quadratic cost of calling getNextState() for each outcome.
+  int n = Ttr[a].filled_in_column(s);
+  opv.resize(n);
+  nextStates.resize(n);
+  int o = 0;
+  FOR_CM_MINOR(s, Ttr[a]) {
+    opv(o) = CM_VAL(Ttr[a]);
+    nextStates[o].resize(1);
+    nextStates[o].push_back(0, CM_ROW(s, Ttr[a]));
+    o++;
+  }
+}
+
 double GenericDiscreteMDP::getReward(const state_vector &sv, int a) {
   int s = static_cast<int>(sv(0));
   return R(s, a);
@@ -49,6 +49,9 @@ struct GenericDiscreteMDP : public CassandraModel {
                                             const state_vector &b, int a);
   state_vector &getNextState(state_vector &result, const state_vector &s, int a,
                              int o);
+  void getOutcomes(outcome_prob_vector &opv,
+                   std::vector<state_vector> &nextStates,
+                   const state_vector &s, int a);
 
   double getLongTermFactor(void);
 
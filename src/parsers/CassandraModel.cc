@@ -22,19 +22,206 @@
 #include "CassandraModel.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
+#include "slaMatrixUtils.h"
+
 using namespace std;
 
 namespace zmdp {
 
-CassandraModel::CassandraModel(void) : numStates(-1), numObservations(-1) {}
+/**********************************************************************
+ * COMPILED MODEL HELPER FUNCTIONS
+ **********************************************************************/
+
+// writes bytes, then zeros up to the next multiple of 8 bytes
+static void cmWrite(FILE *out, const void *data, size_t bytes) {
+  static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  if (bytes > 0) fwrite(data, 1, bytes, out);
+  if (0 != bytes % 8) fwrite(zeros, 1, 8 - bytes % 8, out);
+}
+
+static void cmWriteVector(FILE *out, const cvector &x) {
+  uint32_t sizes[2] = {x.size(), x.filled()};
+  cmWrite(out, sizes, sizeof(sizes));
+  cmWrite(out, x.data.indices.data(), x.filled() * sizeof(unsigned int));
+  cmWrite(out, x.data.values.data(), x.filled() * sizeof(double));
+}
+
+static void cmWriteMatrix(FILE *out, const cmatrix &A) {
+  uint32_t sizes[2] = {A.size1(), A.size2()};
+  uint64_t nnz = A.filled();
+  cmWrite(out, sizes, sizeof(sizes));
+  cmWrite(out, &nnz, sizeof(nnz));
+  cmWrite(out, A.col_starts.data(), (A.size2() + 1) * sizeof(unsigned int));
+  cmWrite(out, A.data.indices.data(), nnz * sizeof(unsigned int));
+  cmWrite(out, A.data.values.data(), nnz * sizeof(double));
+}
+
+// position in a mapped compiled model file
+struct CMCursor {
+  const char *fileName;
+  const char *base;
+  size_t size;
+  size_t pos;
+};
+
+// returns a pointer to the next bytes of the file and skips past them
+// and their padding
+static const void *cmTake(CMCursor &c, size_t bytes) {
+  size_t padded = (bytes + 7) & ~static_cast<size_t>(7);
+  if (padded < bytes || padded > c.size - c.pos) {
+    fprintf(stderr, "ERROR: %s: compiled model file is truncated\n",
+            c.fileName);
+    exit(EXIT_FAILURE);
+  }
+  const void *result = c.base + c.pos;
+  c.pos += padded;
+  return result;
+}
+
+static void cmReadVector(CMCursor &c, cvector &result,
+                         unsigned int expectedSize) {
+  const uint32_t *sizes =
+      reinterpret_cast<const uint32_t *>(cmTake(c, 2 * sizeof(uint32_t)));
+  if (sizes[0] != expectedSize || sizes[1] > expectedSize) {
+    fprintf(stderr, "ERROR: %s: compiled model has a bad initial vector\n",
+            c.fileName);
+    exit(EXIT_FAILURE);
+  }
+  unsigned int nnz = sizes[1];
+  const unsigned int *indices = reinterpret_cast<const unsigned int *>(
+      cmTake(c, nnz * sizeof(unsigned int)));
+  const double *values =
+      reinterpret_cast<const double *>(cmTake(c, nnz * sizeof(double)));
+  // small enough to copy
+  result.resize(expectedSize);
+  FOR(i, nnz) { result.push_back(indices[i], values[i]); }
+}
+
+static void cmReadMatrix(CMCursor &c, cmatrix &result, unsigned int size1,
+                         unsigned int size2) {
+  const uint32_t *sizes =
+      reinterpret_cast<const uint32_t *>(cmTake(c, 2 * sizeof(uint32_t)));
+  uint64_t nnz = *reinterpret_cast<const uint64_t *>(cmTake(c, sizeof(uint64_t)));
+  if (sizes[0] != size1 || sizes[1] != size2 || nnz > UINT_MAX) {
+    fprintf(stderr,
+            "ERROR: %s: compiled model has a %ux%u matrix where a %ux%u "
+            "matrix was expected\n",
+            c.fileName, sizes[0], sizes[1], size1, size2);
+    exit(EXIT_FAILURE);
+  }
+  const unsigned int *colStarts = reinterpret_cast<const unsigned int *>(
+      cmTake(c, (size2 + 1) * sizeof(unsigned int)));
+  const unsigned int *indices = reinterpret_cast<const unsigned int *>(
+      cmTake(c, nnz * sizeof(unsigned int)));
+  const double *values =
+      reinterpret_cast<const double *>(cmTake(c, nnz * sizeof(double)));
+
+  // check the column structure, which is small; the entries are trusted
+  // so that they need not be paged in now
+  bool ok = (0 == colStarts[0] && nnz == colStarts[size2]);
+  FOR(col, size2) {
+    if (colStarts[col] > colStarts[col + 1]) ok = false;
+  }
+  if (!ok) {
+    fprintf(stderr, "ERROR: %s: compiled model has bad column starts\n",
+            c.fileName);
+    exit(EXIT_FAILURE);
+  }
+
+  result.view(size1, size2, colStarts, indices, values, nnz);
+}
+
+/**********************************************************************
+ * STACKED TRANSITIONS
+ **********************************************************************/
+
+void StackedTransitions::init(const std::vector<cmatrix> &Ttr) {
+  numActions = Ttr.size();
+  numStates = (0 == numActions) ? 0 : Ttr[0].size2();
+  size_t numEntries = 0;
+  FOR(a, numActions) { numEntries += Ttr[a].filled(); }
+
+  starts.resize(numStates * numActions + 1);
+  data.clear();
+  data.reserve(numEntries);
+  starts[0] = 0;
+  FOR(s, numStates) {
+    FOR(a, numActions) {
+      // column s of Ttr[a] is row s of T[a]
+      const cmatrix &A = Ttr[a];
+      for (unsigned int k = A.col_starts[s]; k != A.col_starts[s + 1]; k++) {
+        data.push_back(A.data.indices[k], A.data.values[k]);
+      }
+      starts[s * numActions + a + 1] = data.size();
+    }
+  }
+}
+
+void StackedTransitions::multAllActions(std::vector<sparse_accum> &result,
+                                        const belief_vector &b) const {
+  const unsigned int *idx = data.indices.data();
+  const double *vals = data.values.data();
+
+  result.resize(numActions);
+  FOR(a, numActions) { result[a].resize(numStates); }
+  FOR_CV(b) {
+    double bval = CV_VAL(b);
+    const unsigned int *rowStarts = &starts[CV_INDEX(b) * numActions];
+    FOR(a, numActions) {
+      sparse_accum &accum = result[a];
+      for (unsigned int k = rowStarts[a]; k != rowStarts[a + 1]; k++) {
+        accum.add(idx[k], bval * vals[k]);
+      }
+    }
+  }
+  FOR(a, numActions) { result[a].canonicalize(); }
+}
+
+void StackedTransitions::rowProductsAllActions(dmatrix &result,
+                                               const dvector &x) const {
+  const unsigned int *idx = data.indices.data();
+  const double *vals = data.values.data();
+
+  result.resize(numActions, numStates);
+  FOR(s, numStates) {
+    const unsigned int *rowStarts = &starts[s * numActions];
+    FOR(a, numActions) {
+      double sum = 0.0;
+      for (unsigned int k = rowStarts[a]; k != rowStarts[a + 1]; k++) {
+        sum += x(idx[k]) * vals[k];
+      }
+      result(a, s) = sum;
+    }
+  }
+}
+
+/**********************************************************************
+ * CASSANDRA MODEL
+ **********************************************************************/
+
+CassandraModel::CassandraModel(void)
+    : numStates(-1), numObservations(-1), mappedData(NULL), mappedSize(0) {}
+
+CassandraModel::~CassandraModel(void) {
+  if (NULL != mappedData) {
+    munmap(mappedData, mappedSize);
+  }
+}
 
 void CassandraModel::checkForTerminalStates(void) {
   if (zmdpDebugLevelG >= 1) {
@@ -53,6 +240,323 @@ void CassandraModel::checkForTerminalStates(void) {
   }
 }
 
+// drops the states that can't be reached from the initial belief under
+// any sequence of actions and renumbers the rest.  states keep their
+// relative order, so sparse vectors stay sorted when mapped back to the
+// ids in the model file.  only valid for POMDPs.
+void CassandraModel::compactReachableStates(void) {
+  assert(-1 != numObservations);
+  timeval startTime, endTime;
+  gettimeofday(&startTime, 0);
+
+  // breadth-first search over the union of the T[a]; column s of Ttr[a]
+  // holds the successors of s
+  std::vector<bool> reached(numStates, false);
+  std::vector<int> queue;
+  FOR_CV(initialBelief) {
+    int s = CV_INDEX(initialBelief);
+    if (!reached[s]) {
+      reached[s] = true;
+      queue.push_back(s);
+    }
+  }
+  for (size_t head = 0; head < queue.size(); head++) {
+    int s = queue[head];
+    FOR(a, numActions) {
+      FOR_CM_MINOR(s, Ttr[a]) {
+        int sp = CM_ROW(s, Ttr[a]);
+        if (!reached[sp]) {
+          reached[sp] = true;
+          queue.push_back(sp);
+        }
+      }
+    }
+  }
+
+  int numReached = queue.size();
+  if (numReached == numStates) {
+    printf("model initialization -- all %d states are reachable\n",
+           numStates);
+    return;
+  }
+
+  std::vector<int> newIds(numStates, -1);
+  std::vector<int> oldIds;
+  oldIds.reserve(numReached);
+  FOR(s, numStates) {
+    if (reached[s]) {
+      newIds[s] = oldIds.size();
+      oldIds.push_back(s);
+    }
+  }
+
+  // the reachable set is closed under transitions, so every successor of
+  // a kept state is also kept
+  kmatrix Tk(numReached, numReached), Ok, Rk(numReached, numActions);
+  FOR(a, numActions) {
+    Tk.data.clear();
+    FOR(s, numReached) {
+      FOR_CM_MINOR(oldIds[s], Ttr[a]) {
+        Tk.push_back(s, newIds[CM_ROW(oldIds[s], Ttr[a])],
+                     CM_VAL(Ttr[a]));
+      }
+    }
+    copy(T[a], Tk);
+    kmatrix_transpose_in_place(Tk);
+    copy(Ttr[a], Tk);
+
+    Ok.resize(numReached, numObservations);
+    FOR_CM_MAJOR(o, O[a]) {
+      FOR_CM_MINOR(o, O[a]) {
+        int sp = newIds[CM_ROW(o, O[a])];
+        if (-1 != sp) {
+          Ok.push_back(sp, o, CM_VAL(O[a]));
+        }
+      }
+    }
+    copy(O[a], Ok);
+
+    FOR_CM_MINOR(a, R) {
+      int s = newIds[CM_ROW(a, R)];
+      if (-1 != s) {
+        Rk.push_back(s, a, CM_VAL(R));
+      }
+    }
+  }
+  copy(R, Rk);
+
+  cvector b;
+  b.resize(numReached);
+  FOR_CV(initialBelief) {
+    b.push_back(newIds[CV_INDEX(initialBelief)], CV_VAL(initialBelief));
+  }
+  initialBelief = b;
+
+  std::vector<bool> terminal(numReached);
+  FOR(s, numReached) { terminal[s] = isTerminalState[oldIds[s]]; }
+  isTerminalState.swap(terminal);
+
+  originalStateIds.swap(oldIds);
+  compactStateIds.swap(newIds);
+  numStates = numReached;
+
+  gettimeofday(&endTime, 0);
+  double numSeconds = (endTime.tv_sec - startTime.tv_sec) +
+                      1e-6 * (endTime.tv_usec - startTime.tv_usec);
+  printf("model initialization -- compacted to %d reachable states of %d "
+         "(%.3f seconds)\n",
+         numReached, getNumOriginalStates(), numSeconds);
+}
+
+// true if A and B have exactly the same entries
+static bool cmEqual(const cmatrix &A, const cmatrix &B) {
+  if (A.size1() != B.size1() || A.size2() != B.size2() ||
+      A.filled() != B.filled()) {
+    return false;
+  }
+  return (0 == memcmp(A.col_starts.data(), B.col_starts.data(),
+                      (A.size2() + 1) * sizeof(unsigned int)) &&
+          0 == memcmp(A.data.indices.data(), B.data.indices.data(),
+                      A.filled() * sizeof(unsigned int)) &&
+          0 == memcmp(A.data.values.data(), B.data.values.data(),
+                      A.filled() * sizeof(double)));
+}
+
+// true if columns a and b of R have exactly the same entries
+static bool cmColumnsEqual(const cmatrix &R, int a, int b) {
+  unsigned int ai = R.col_starts[a], bi = R.col_starts[b];
+  unsigned int n = R.col_starts[a + 1] - ai;
+  if (n != R.col_starts[b + 1] - bi) return false;
+  FOR(k, n) {
+    if (R.data.indices[ai + k] != R.data.indices[bi + k] ||
+        R.data.values[ai + k] != R.data.values[bi + k]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// orders the columns of an observation matrix by support, then by
+// entries scaled by the column sum, so proportional columns end up
+// next to each other
+struct ObsColumnLess {
+  const cmatrix &O;
+  const std::vector<double> &colSums;
+
+  ObsColumnLess(const cmatrix &_O, const std::vector<double> &_colSums)
+      : O(_O), colSums(_colSums) {}
+
+  bool operator()(int o1, int o2) const {
+    unsigned int i1 = O.col_starts[o1], i2 = O.col_starts[o2];
+    unsigned int n1 = O.col_starts[o1 + 1] - i1;
+    unsigned int n2 = O.col_starts[o2 + 1] - i2;
+    if (n1 != n2) return n1 < n2;
+    FOR(k, n1) {
+      unsigned int r1 = O.data.indices[i1 + k], r2 = O.data.indices[i2 + k];
+      if (r1 != r2) return r1 < r2;
+    }
+    FOR(k, n1) {
+      double v1 = O.data.values[i1 + k] / colSums[o1];
+      double v2 = O.data.values[i2 + k] / colSums[o2];
+      if (v1 != v2) return v1 < v2;
+    }
+    return o1 < o2;
+  }
+};
+
+// true if columns o1 and o2 of O are proportional (within SPARSE_EPS
+// after scaling by the column sums)
+static bool obsColumnsProportional(const cmatrix &O,
+                                   const std::vector<double> &colSums,
+                                   int o1, int o2) {
+  unsigned int i1 = O.col_starts[o1], i2 = O.col_starts[o2];
+  unsigned int n = O.col_starts[o1 + 1] - i1;
+  if (n != O.col_starts[o2 + 1] - i2) return false;
+  FOR(k, n) {
+    if (O.data.indices[i1 + k] != O.data.indices[i2 + k]) return false;
+    if (fabs(O.data.values[i1 + k] / colSums[o1] -
+             O.data.values[i2 + k] / colSums[o2]) > SPARSE_EPS) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// collapses actions whose T, O and R are identical into the first of
+// them, then, for each remaining action, merges observations whose
+// columns of O[a] are proportional: they lead to the same next belief,
+// so one outcome with their summed probability stands in for all of
+// them.  the merged outcome keeps the lowest observation id of its
+// group and the other columns are left empty, so observation ids don't
+// change.  only valid for POMDPs.
+void CassandraModel::aggregateObservationsAndActions(void) {
+  assert(-1 != numObservations);
+  timeval startTime, endTime;
+  gettimeofday(&startTime, 0);
+
+  // duplicate actions
+  std::vector<int> newActionIds(numActions, -1);
+  std::vector<int> oldActionIds;
+  FOR(a, numActions) {
+    FOR(k, oldActionIds.size()) {
+      int b = oldActionIds[k];
+      if (cmColumnsEqual(R, a, b) && cmEqual(T[a], T[b]) &&
+          cmEqual(O[a], O[b])) {
+        newActionIds[a] = k;
+        break;
+      }
+    }
+    if (-1 == newActionIds[a]) {
+      newActionIds[a] = oldActionIds.size();
+      oldActionIds.push_back(a);
+    }
+  }
+
+  int numKeptActions = oldActionIds.size();
+  if (numKeptActions < numActions) {
+    kmatrix Rk(numStates, numKeptActions);
+    FOR(k, numKeptActions) {
+      int a = oldActionIds[k];
+      FOR_CM_MINOR(a, R) { Rk.push_back(CM_ROW(a, R), k, CM_VAL(R)); }
+      if (static_cast<int>(k) != a) {
+        T[k] = T[a];
+        Ttr[k] = Ttr[a];
+        O[k] = O[a];
+      }
+    }
+    copy(R, Rk);
+    T.resize(numKeptActions);
+    Ttr.resize(numKeptActions);
+    O.resize(numKeptActions);
+    originalActionIds.swap(oldActionIds);
+    compactActionIds.swap(newActionIds);
+    numActions = numKeptActions;
+  }
+
+  // proportional observation columns
+  std::vector<std::vector<int> > merged(numActions);
+  std::vector<double> colSums(numObservations);
+  std::vector<int> order;
+  std::vector<double> vals;
+  int numPairs = 0, numKeptPairs = 0;
+  kmatrix Ok;
+  FOR(a, numActions) {
+    std::vector<int> &rep = merged[a];
+    rep.resize(numObservations);
+    order.clear();
+    FOR(o, numObservations) {
+      rep[o] = o;
+      colSums[o] = 0.0;
+      FOR_CM_MINOR(o, O[a]) { colSums[o] += CM_VAL(O[a]); }
+      if (colSums[o] > 0.0) order.push_back(o);
+    }
+    numPairs += order.size();
+    std::sort(order.begin(), order.end(), ObsColumnLess(O[a], colSums));
+
+    bool changed = false;
+    for (size_t i = 0; i < order.size();) {
+      size_t j = i + 1;
+      while (j < order.size() &&
+             obsColumnsProportional(O[a], colSums, order[i], order[j])) {
+        j++;
+      }
+      int first = order[i];
+      for (size_t k = i + 1; k < j; k++) {
+        first = std::min(first, order[k]);
+      }
+      for (size_t k = i; k < j; k++) {
+        rep[order[k]] = first;
+      }
+      if (j > i + 1) changed = true;
+      numKeptPairs++;
+      i = j;
+    }
+    if (!changed) continue;
+
+    // every column in a group has the same support, so the merged
+    // column is the entry-by-entry sum, accumulated in place of the
+    // representative's entries
+    const cmatrix &Oa = O[a];
+    vals.assign(Oa.data.values.data(), Oa.data.values.data() + Oa.filled());
+    FOR(o, numObservations) {
+      unsigned int r = rep[o];
+      if (r == o) continue;
+      unsigned int n = Oa.col_starts[o + 1] - Oa.col_starts[o];
+      FOR(k, n) {
+        vals[Oa.col_starts[r] + k] += Oa.data.values[Oa.col_starts[o] + k];
+      }
+    }
+    Ok.resize(numStates, numObservations);
+    FOR(o, numObservations) {
+      if (rep[o] != static_cast<int>(o)) continue;
+      for (unsigned int k = Oa.col_starts[o]; k < Oa.col_starts[o + 1]; k++) {
+        Ok.push_back(Oa.data.indices[k], o, vals[k]);
+      }
+    }
+    copy(O[a], Ok);
+  }
+
+  if (numKeptPairs < numPairs) {
+    mergedOutcomeIds.swap(merged);
+  }
+
+  gettimeofday(&endTime, 0);
+  double numSeconds = (endTime.tv_sec - startTime.tv_sec) +
+                      1e-6 * (endTime.tv_usec - startTime.tv_usec);
+  printf("model initialization -- kept %d of %d actions and %d of %d "
+         "possible (action, observation) pairs (%.3f seconds)\n",
+         numActions, getNumOriginalActions(), numKeptPairs, numPairs,
+         numSeconds);
+}
+
+void CassandraModel::buildStackedTransitions(void) {
+  Tstack.init(Ttr);
+  if (zmdpDebugLevelG >= 1) {
+    printf("model initialization -- stacked transitions: %d entries\n",
+           Tstack.data.size());
+  }
+}
+
 void CassandraModel::debugDensity(void) {
   double T_size = -1, T_filled = -1;
   double O_size = -1, O_filled = -1;
@@ -80,4 +584,170 @@ void CassandraModel::debugDensity(void) {
   }
 }
 
+bool CassandraModel::isCompiledFile(const std::string &fileName) {
+  char magic[8];
+  FILE *in = fopen(fileName.c_str(), "rb");
+  if (NULL == in) return false;
+  bool result = (1 == fread(magic, sizeof(magic), 1, in) &&
+                 0 == memcmp(magic, CM_COMPILED_MAGIC, sizeof(magic)));
+  fclose(in);
+  return result;
+}
+
+void CassandraModel::writeCompiledFile(const std::string &outFileName) const {
+  FILE *out = fopen(outFileName.c_str(), "wb");
+  if (NULL == out) {
+    fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+            outFileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+  bool isPomdp = (-1 != numObservations);
+  CompiledModelHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CM_COMPILED_MAGIC, sizeof(header.magic));
+  header.version = CM_COMPILED_VERSION;
+  header.isPomdp = isPomdp;
+  header.numStates = numStates;
+  header.numActions = numActions;
+  header.numObservations = numObservations;
+  header.discount = discount;
+  cmWrite(out, &header, sizeof(header));
+
+  cmWriteVector(out, isPomdp ? initialBelief : initialState);
+  cmWriteMatrix(out, R);
+  FOR(a, numActions) { cmWriteMatrix(out, T[a]); }
+  FOR(a, numActions) { cmWriteMatrix(out, Ttr[a]); }
+  if (isPomdp) {
+    FOR(a, numActions) { cmWriteMatrix(out, O[a]); }
+  }
+
+  std::vector<uint64_t> terminalBits((numStates + 63) / 64, 0);
+  FOR(s, numStates) {
+    if (isTerminalState[s]) {
+      terminalBits[s / 64] |= (static_cast<uint64_t>(1) << (s % 64));
+    }
+  }
+  cmWrite(out, terminalBits.data(), terminalBits.size() * sizeof(uint64_t));
+
+  if (ferror(out) || 0 != fclose(out)) {
+    fprintf(stderr, "ERROR: error writing %s: %s\n", outFileName.c_str(),
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+}
+
+void CassandraModel::readCompiledFile(const std::string &_fileName,
+                                      bool expectPomdp) {
+  fileName = _fileName;
+  const char *fname = fileName.c_str();
+
+  timeval startTime, endTime;
+  if (zmdpDebugLevelG >= 1) {
+    cout << "reading compiled model from " << fileName << endl;
+    gettimeofday(&startTime, 0);
+  }
+
+  int fd = open(fname, O_RDONLY);
+  if (-1 == fd) {
+    fprintf(stderr, "ERROR: couldn't open %s for reading: %s\n", fname,
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  struct stat st;
+  if (0 != fstat(fd, &st)) {
+    fprintf(stderr, "ERROR: couldn't stat %s: %s\n", fname, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  mappedSize = st.st_size;
+  if (mappedSize < sizeof(CompiledModelHeader)) {
+    fprintf(stderr, "ERROR: %s: file is too short to be a compiled model\n",
+            fname);
+    exit(EXIT_FAILURE);
+  }
+  // a shared read-only mapping: pages are loaded on first use, and
+  // processes that load the same model share them
+  mappedData = mmap(NULL, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+  if (MAP_FAILED == mappedData) {
+    fprintf(stderr, "ERROR: couldn't mmap %s: %s\n", fname, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+
+  CMCursor c;
+  c.fileName = fname;
+  c.base = reinterpret_cast<const char *>(mappedData);
+  c.size = mappedSize;
+  c.pos = 0;
+
+  const CompiledModelHeader &header =
+      *reinterpret_cast<const CompiledModelHeader *>(
+          cmTake(c, sizeof(CompiledModelHeader)));
+  if (0 != memcmp(header.magic, CM_COMPILED_MAGIC, sizeof(header.magic))) {
+    fprintf(stderr, "ERROR: %s: not a compiled model file\n", fname);
+    exit(EXIT_FAILURE);
+  }
+  if (CM_COMPILED_VERSION != header.version) {
+    fprintf(stderr,
+            "ERROR: %s: unsupported compiled model version %u (expected %d; "
+            "was the file written on a machine with a different byte "
+            "order?)\n",
+            fname, header.version, CM_COMPILED_VERSION);
+    exit(EXIT_FAILURE);
+  }
+  if (static_cast<bool>(header.isPomdp) != expectPomdp) {
+    fprintf(stderr, "ERROR: %s: compiled model is %s, expected %s\n", fname,
+            header.isPomdp ? "a POMDP" : "an MDP",
+            expectPomdp ? "a POMDP" : "an MDP");
+    exit(EXIT_FAILURE);
+  }
+  if (header.numStates <= 0 || header.numActions <= 0 ||
+      (expectPomdp && header.numObservations <= 0)) {
+    fprintf(stderr, "ERROR: %s: compiled model has bad dimensions\n", fname);
+    exit(EXIT_FAILURE);
+  }
+
+  numStates = header.numStates;
+  numActions = header.numActions;
+  numObservations = expectPomdp ? header.numObservations : -1;
+  discount = header.discount;
+
+  if (expectPomdp) {
+    cmReadVector(c, initialBelief, numStates);
+  } else {
+    cmReadVector(c, initialState, 1);
+  }
+  cmReadMatrix(c, R, numStates, numActions);
+  T.resize(numActions);
+  Ttr.resize(numActions);
+  FOR(a, numActions) { cmReadMatrix(c, T[a], numStates, numStates); }
+  FOR(a, numActions) { cmReadMatrix(c, Ttr[a], numStates, numStates); }
+  if (expectPomdp) {
+    O.resize(numActions);
+    FOR(a, numActions) { cmReadMatrix(c, O[a], numStates, numObservations); }
+  }
+
+  const uint64_t *terminalBits = reinterpret_cast<const uint64_t *>(
+      cmTake(c, ((numStates + 63) / 64) * sizeof(uint64_t)));
+  isTerminalState.resize(numStates);
+  FOR(s, numStates) {
+    isTerminalState[s] = (terminalBits[s / 64] >> (s % 64)) & 1;
+  }
+
+  if (c.pos != c.size) {
+    fprintf(stderr, "ERROR: %s: unexpected data at the end of the file\n",
+            fname);
+    exit(EXIT_FAILURE);
+  }
+
+  if (zmdpDebugLevelG >= 1) {
+    gettimeofday(&endTime, 0);
+    double numSeconds = (endTime.tv_sec - startTime.tv_sec) +
+                        1e-6 * (endTime.tv_usec - startTime.tv_usec);
+    cout << "[file reading took " << numSeconds << " seconds]" << endl;
+    debugDensity();
+  }
+}
+
 };  // namespace zmdp
@@ -18,6 +18,9 @@
 #ifndef ZMDP_SRC_PARSERS_CASSANDRAMODEL_H_
 #define ZMDP_SRC_PARSERS_CASSANDRAMODEL_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <iostream>
 #include <string>
 #include <vector>
@@ -29,10 +32,62 @@ using namespace sla;
 
 namespace zmdp {
 
+// All-actions copy of the transition matrices: for each source state s,
+// the nonzeros of T[a](s,:) for every action a are stored adjacently, so
+// one pass over the support of a belief or value function touches the
+// transitions of every action with unit-stride reads.
+struct StackedTransitions {
+  int numStates, numActions;
+  // row (s,a) holds entries starts[s * numActions + a] ..
+  // starts[s * numActions + a + 1] - 1 of data
+  std::vector<unsigned int> starts;
+  sparse_entries<double> data;
+
+  StackedTransitions(void) : numStates(0), numActions(0) {}
+
+  bool empty(void) const { return starts.empty(); }
+  void init(const std::vector<cmatrix> &Ttr);
+
+  // result[a] = Ttr[a] * b for every action a; the same values as
+  // mult(result[a], Ttr[a], b)
+  void multAllActions(std::vector<sparse_accum> &result,
+                      const belief_vector &b) const;
+
+  // result(a,s) = T[a](s,:) * x for every action a and state s
+  void rowProductsAllActions(dmatrix &result, const dvector &x) const;
+};
+
+// Compiled model files, written by 'zmdp compile'.  The file is a
+// CompiledModelHeader followed by these sections, each starting on an
+// 8-byte boundary:
+//   the initial belief (POMDP) or initial state (MDP), as a vector
+//   R, then T[a] for each a, Ttr[a] for each a, and (POMDP) O[a] for
+//     each a, as matrices
+//   the terminal state bitmap, ceil(numStates / 64) uint64 words
+// A vector is uint32 size, uint32 nnz, then nnz indices and nnz values.
+// A matrix is uint32 size1, uint32 size2, uint64 nnz, then size2 + 1
+// column starts, nnz indices and nnz values, in the same CSC layout as
+// cmatrix.  Each array is padded to a multiple of 8 bytes.  All fields
+// are in native byte order.
+#define CM_COMPILED_MAGIC "ZMDPMODL"
+#define CM_COMPILED_VERSION (1)
+
+struct CompiledModelHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t isPomdp;
+  int32_t numStates;
+  int32_t numActions;
+  int32_t numObservations;
+  uint32_t reserved;
+  double discount;
+};
+
 struct CassandraModel : public MDP {
   int numStates, numObservations;
 
   CassandraModel(void);
+  ~CassandraModel(void);
 
   // initialState -- for MDPs
   state_vector initialState;
@@ -42,6 +97,9 @@ struct CassandraModel : public MDP {
   cmatrix R;
   // T[a](s,s'), Ttr[a](s',s), O[a](s',o)
   std::vector<cmatrix> T, Ttr, O;
+  // optional all-actions copy of T (empty unless
+  // useStackedTransitions=1)
+  StackedTransitions Tstack;
   // isTerminalState[s] -- true if s is an absorbing state with 0 reward for all
   // actions
   std::vector<bool> isTerminalState;
@@ -49,8 +107,24 @@ struct CassandraModel : public MDP {
   // maxHorizon: see main/zmdp.config for an explanation
   int maxHorizon;
 
+  // the number of states in the model file, before any compaction
+  int getNumOriginalStates(void) const {
+    return compactStateIds.empty() ? numStates : compactStateIds.size();
+  }
+
+  // with a compiled model, R, T, Ttr and O view the mapped file
+  void *mappedData;
+  size_t mappedSize;
+
   void checkForTerminalStates(void);
+  void compactReachableStates(void);
+  void aggregateObservationsAndActions(void);
+  void buildStackedTransitions(void);
   void debugDensity(void);
+
+  static bool isCompiledFile(const std::string &fileName);
+  void readCompiledFile(const std::string &fileName, bool expectPomdp);
+  void writeCompiledFile(const std::string &fileName) const;
 };
 
 };  // namespace zmdp
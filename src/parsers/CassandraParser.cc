@@ -15,6 +15,7 @@
 
  ***************************************************************************/
 
+
 /***************************************************************************
  * INCLUDES
  ***************************************************************************/
@@ -22,25 +23,1047 @@
 #include "CassandraParser.h"
 
 #include <assert.h>
+#include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
 #include <sys/time.h>
-#include <unistd.h>
 
-#include <fstream>
+#include <algorithm>
 #include <iostream>
+#include <map>
 
 #include "MatrixUtils.h"
+#include "TextInput.h"
+#include "ThreadPool.h"
 #include "slaMatrixUtils.h"
 #include "sla_cassandra.h"
 #include "sparse-matrix.h"
 #include "zmdpCommonDefs.h"
 
+// tolerance for probability distributions summing to 1 (same as
+// Cassandra's parser)
+#define CP_PROB_SUM_EPS (1e-5)
+
+// values this small are treated as zero, and overwrite earlier entries
+// by removing them (same as IS_ZERO() in Cassandra's sparse matrices)
+#define CP_IS_ZERO(x) (fabs(x) < 1e-10)
+
 using namespace std;
 using namespace MatrixUtils;
 
 namespace zmdp {
 
+/***************************************************************************
+ * STATIC HELPER FUNCTIONS
+ ***************************************************************************/
+
+enum CPTokenType {
+  CP_END,
+  CP_INT,
+  CP_FLOAT,
+  CP_STRING,
+  CP_COLON,
+  CP_ASTERISK,
+  CP_PLUS,
+  CP_MINUS,
+  // reserved words, in the same order as cpReservedWords
+  CP_DISCOUNT,
+  CP_VALUES,
+  CP_STATES,
+  CP_ACTIONS,
+  CP_OBSERVATIONS,
+  CP_T,
+  CP_O,
+  CP_R,
+  CP_UNIFORM,
+  CP_IDENTITY,
+  CP_REWARD,
+  CP_COST,
+  CP_START,
+  CP_INCLUDE,
+  CP_EXCLUDE,
+  CP_RESET,
+  CP_NUM_TOKEN_TYPES
+};
+
+static const char *cpReservedWords[] = {
+    "discount", "values",  "states",  "actions",  "observations", "T",
+    "O",        "R",       "uniform", "identity", "reward",       "cost",
+    "start",    "include", "exclude", "reset"};
+
+// kinds of names that can be declared in the preamble
+enum CPNameKind { CP_STATE_NAME, CP_ACTION_NAME, CP_OBS_NAME };
+
+static const char *cpNameKinds[] = {"state", "action", "observation"};
+
+// R statements, by which indices their values run over
+enum CPRewardKind {
+  CP_REWARD_VALUE,        // a single value
+  CP_REWARD_BY_OBS,       // POMDP 'R: a : s : s'', one per observation
+  CP_REWARD_BY_NEXT,      // MDP 'R: a : s', one per next state
+  CP_REWARD_BY_NEXT_OBS,  // POMDP 'R: a : s', one per (next state, obs)
+  CP_REWARD_BY_CUR_NEXT   // MDP 'R: a', one per (state, next state)
+};
+
+struct CPReward {
+  int kind;
+  int a, s, sp, o;  // -1 for wildcards
+  size_t values;    // offset of the first value in CPReader::rewardValues
+};
+
+static bool cpIsLetter(char c) {
+  return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+}
+
+// the range of indices selected by i, which is -1 for a wildcard
+static void cpRange(int i, int n, int &lo, int &hi) {
+  if (-1 == i) {
+    lo = 0;
+    hi = n - 1;
+  } else {
+    lo = hi = i;
+  }
+}
+
+// drops the entries of A that were overwritten by a later write to their
+// whole row.  cleared[r] is the number of entries A had when row r was
+// last written as a whole (cleared may be empty if no rows were).
+static void cpDropClearedEntries(kmatrix &A,
+                                 const std::vector<size_t> &cleared) {
+  if (cleared.empty()) return;
+  size_t n = 0;
+  FOR(i, A.data.size()) {
+    if (i >= cleared[A.data[i].r]) {
+      A.data[n++] = A.data[i];
+    }
+  }
+  A.data.resize(n);
+}
+
+// drops zero entries, which are left behind by writes of zero
+// probabilities (they remove any earlier entry at the same position)
+static void cpDropZeroEntries(kmatrix &A) {
+  size_t n = 0;
+  FOR_EACH(Ai, A.data) {
+    if (0.0 != Ai->value) {
+      A.data[n++] = *Ai;
+    }
+  }
+  A.data.resize(n);
+}
+
+// col_starts for the canonical kmatrix A: the entries in column c are
+// [starts[c], starts[c+1])
+static void cpColumnStarts(std::vector<size_t> &starts, const kmatrix &A) {
+  starts.assign(A.size2() + 1, 0);
+  FOR_EACH(Ai, A.data) { starts[Ai->c + 1]++; }
+  FOR(c, A.size2()) { starts[c + 1] += starts[c]; }
+}
+
+// returns the first column of the canonical kmatrix A whose entries
+// don't sum to 1, or -1 if there is none
+static int cpFindBadColumn(const kmatrix &A,
+                           const std::vector<size_t> &starts,
+                           double &badSum) {
+  FOR(c, A.size2()) {
+    double sum = 0.0;
+    for (size_t i = starts[c]; i < starts[c + 1]; i++) {
+      sum += A.data[i].value;
+    }
+    if (sum < 1.0 - CP_PROB_SUM_EPS || sum > 1.0 + CP_PROB_SUM_EPS) {
+      badSum = sum;
+      return c;
+    }
+  }
+  return -1;
+}
+
+static size_t cpPeakResidentBytes(void) {
+  struct rusage usage;
+  if (0 != getrusage(RUSAGE_SELF, &usage)) return 0;
+  // ru_maxrss is in kilobytes on Linux
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+/***************************************************************************
+ * CPREADER
+ ***************************************************************************/
+
+// Single-pass reader for the full Cassandra POMDP/MDP format, the
+// language defined by pomdp_spec.l and pomdp_spec.y.  T and O
+// statements are appended to per-action kmatrix buffers as they are
+// read; later statements override earlier ones.  Expected rewards are
+// computed from the R statements once the whole file has been read.
+struct CPReader {
+  CassandraModel &p;
+  bool expectPomdp;
+  const char *pos, *end;
+  int lineNumber;
+
+  // current token (tokLine is 0 for errors not tied to a line)
+  int tok;
+  const char *tokBegin, *tokEnd;
+  int tokLine;
+
+  bool isPomdp;
+  std::map<std::string, int> names[3];
+
+  // T(a) and O(a) in (s,s') and (s',o) coordinates, and the row
+  // overwrite marks used by cpDropClearedEntries()
+  std::vector<kmatrix> Tk, Ok;
+  std::vector<std::vector<size_t> > Tcleared, Ocleared;
+  dvector initialBeliefD;
+  int initialState;
+
+  std::vector<CPReward> rewards;
+  std::vector<double> rewardValues;
+
+  // scratch space for lists of numbers
+  std::vector<double> numbers;
+
+  CPReader(CassandraModel &_p, bool _expectPomdp, const char *data,
+           size_t size);
+
+  void read(void);
+  void finish(void);
+  size_t bufferBytes(void) const;
+
+ protected:
+  void error(const char *fmt, ...);
+  void next(void);
+  void expect(int type, const char *what);
+  bool accept(int type);
+  int tokenInt(void);
+  double tokenDouble(void);
+
+  double readNumber(void);
+  double readProb(void);
+  void readNumbers(std::vector<double> &result, bool probs);
+  void readCount(int nameKind, int &count);
+  int numNames(int nameKind) const;
+  int readIndex(int nameKind);
+  void readDistribution(std::vector<double> &row, int n, bool allowReset);
+
+  void readPreamble(void);
+  void readStart(void);
+  void readT(void);
+  void readO(void);
+  void readR(void);
+  void addReward(int kind, int a, int s, int sp, int o, size_t numValues);
+
+  void setEntries(std::vector<kmatrix> &M, int a, int r, int c, double v);
+  void setRow(std::vector<kmatrix> &M,
+              std::vector<std::vector<size_t> > &cleared, int a, int r,
+              const std::vector<double> &row);
+  void setMatrix(std::vector<kmatrix> &M,
+                 std::vector<std::vector<size_t> > &cleared, int a,
+                 const std::vector<double> &vals);
+
+  double getReward(const std::vector<int> &matches, int s, int sp,
+                   int o) const;
+};
+
+CPReader::CPReader(CassandraModel &_p, bool _expectPomdp, const char *data,
+                   size_t size)
+    : p(_p),
+      expectPomdp(_expectPomdp),
+      pos(data),
+      end(data + size),
+      lineNumber(1),
+      tok(CP_END),
+      tokBegin(data),
+      tokEnd(data),
+      tokLine(1),
+      isPomdp(false),
+      initialState(-1) {}
+
+void CPReader::error(const char *fmt, ...) {
+  char msg[1024];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, args);
+  va_end(args);
+  cerr << "ERROR: " << p.fileName << ": ";
+  if (tokLine > 0) {
+    cerr << "line " << tokLine << ": ";
+  }
+  cerr << msg << endl;
+  exit(EXIT_FAILURE);
+}
+
+void CPReader::next(void) {
+  for (;;) {
+    while (pos != end && fastIsSpace(*pos)) pos++;
+    if (pos == end) break;
+    if ('\n' == *pos) {
+      lineNumber++;
+      pos++;
+    } else if ('#' == *pos) {
+      while (pos != end && '\n' != *pos) pos++;
+    } else {
+      break;
+    }
+  }
+
+  tokBegin = pos;
+  tokLine = lineNumber;
+  if (pos == end) {
+    tok = CP_END;
+  } else if (fastIsDigit(*pos)) {
+    tok = CP_INT;
+    while (pos != end && fastIsDigit(*pos)) pos++;
+    if (pos != end && '.' == *pos) {
+      tok = CP_FLOAT;
+      pos++;
+      while (pos != end && fastIsDigit(*pos)) pos++;
+    }
+    if (pos != end && ('e' == *pos || 'E' == *pos)) {
+      const char *t = pos + 1;
+      if (t != end && ('-' == *t || '+' == *t)) t++;
+      if (t != end && fastIsDigit(*t)) {
+        tok = CP_FLOAT;
+        pos = t;
+        while (pos != end && fastIsDigit(*pos)) pos++;
+      }
+    }
+  } else if (cpIsLetter(*pos)) {
+    while (pos != end && (cpIsLetter(*pos) || fastIsDigit(*pos) ||
+                          '-' == *pos || '_' == *pos)) {
+      pos++;
+    }
+    tok = CP_STRING;
+    size_t len = pos - tokBegin;
+    FOR(i, CP_NUM_TOKEN_TYPES - CP_DISCOUNT) {
+      if (len == strlen(cpReservedWords[i]) &&
+          0 == strncmp(tokBegin, cpReservedWords[i], len)) {
+        tok = CP_DISCOUNT + i;
+        break;
+      }
+    }
+  } else {
+    switch (*pos) {
+      case ':':
+        tok = CP_COLON;
+        break;
+      case '*':
+        tok = CP_ASTERISK;
+        break;
+      case '+':
+        tok = CP_PLUS;
+        break;
+      case '-':
+        tok = CP_MINUS;
+        break;
+      default:
+        error("illegal character '%c'", *pos);
+    }
+    pos++;
+  }
+  tokEnd = pos;
+}
+
+void CPReader::expect(int type, const char *what) {
+  if (tok != type) {
+    error("expected %s", what);
+  }
+  next();
+}
+
+bool CPReader::accept(int type) {
+  if (tok != type) return false;
+  next();
+  return true;
+}
+
+int CPReader::tokenInt(void) {
+  const char *s = tokBegin;
+  int result;
+  if (!fastScanInt(s, tokEnd, result)) {
+    error("integer '%.*s' is too large", static_cast<int>(tokEnd - tokBegin),
+          tokBegin);
+  }
+  return result;
+}
+
+double CPReader::tokenDouble(void) {
+  const char *s = tokBegin;
+  double result;
+  if (!fastScanDouble(s, tokEnd, result) || s != tokEnd) {
+    error("can't parse number '%.*s'", static_cast<int>(tokEnd - tokBegin),
+          tokBegin);
+  }
+  return result;
+}
+
+// number : ['+' | '-'] (INT | FLOAT)
+double CPReader::readNumber(void) {
+  double sign = 1.0;
+  if (accept(CP_MINUS)) {
+    sign = -1.0;
+  } else {
+    accept(CP_PLUS);
+  }
+  if (CP_INT != tok && CP_FLOAT != tok) {
+    error("expected a number");
+  }
+  double result = sign * tokenDouble();
+  next();
+  return result;
+}
+
+// prob : INT | FLOAT, between 0 and 1
+double CPReader::readProb(void) {
+  if (CP_INT != tok && CP_FLOAT != tok) {
+    error("expected a probability");
+  }
+  double result = tokenDouble();
+  if (result < 0.0 || result > 1.0) {
+    error("probability %g is not between 0 and 1", result);
+  }
+  next();
+  return result;
+}
+
+void CPReader::readNumbers(std::vector<double> &result, bool probs) {
+  result.clear();
+  for (;;) {
+    if (CP_INT == tok || CP_FLOAT == tok) {
+      result.push_back(probs ? readProb() : readNumber());
+    } else if (!probs && (CP_MINUS == tok || CP_PLUS == tok)) {
+      result.push_back(readNumber());
+    } else {
+      break;
+    }
+  }
+}
+
+// the number of states, actions, or observations: an INT or a list of
+// names
+void CPReader::readCount(int nameKind, int &count) {
+  const char *kind = cpNameKinds[nameKind];
+  names[nameKind].clear();
+  if (CP_INT == tok) {
+    count = tokenInt();
+    if (count < 1) {
+      error("number of %ss must be positive", kind);
+    }
+    next();
+  } else if (CP_STRING == tok) {
+    count = 0;
+    while (CP_STRING == tok) {
+      std::string name(tokBegin, tokEnd);
+      if (!names[nameKind].insert(make_pair(name, count)).second) {
+        error("duplicate %s name '%s'", kind, name.c_str());
+      }
+      count++;
+      next();
+    }
+  } else {
+    error("expected the number of %ss or a list of %s names", kind, kind);
+  }
+}
+
+int CPReader::numNames(int nameKind) const {
+  switch (nameKind) {
+    case CP_STATE_NAME:
+      return p.numStates;
+    case CP_ACTION_NAME:
+      return p.numActions;
+    default:
+      return p.numObservations;
+  }
+}
+
+// a state, action, or observation: an INT, a name, or '*' (returns -1)
+int CPReader::readIndex(int nameKind) {
+  const char *kind = cpNameKinds[nameKind];
+  int n = numNames(nameKind);
+  int result;
+  if (CP_ASTERISK == tok) {
+    result = -1;
+  } else if (CP_INT == tok) {
+    result = tokenInt();
+    if (result >= n) {
+      error("%s index %d is out of range (must be less than %d)", kind,
+            result, n);
+    }
+  } else if (CP_STRING == tok) {
+    std::string name(tokBegin, tokEnd);
+    typeof(names[nameKind].begin()) ni = names[nameKind].find(name);
+    if (ni == names[nameKind].end()) {
+      error("unknown %s '%s'", kind, name.c_str());
+    }
+    result = ni->second;
+  } else {
+    error("expected %s", kind);
+    result = -1;  // avoid warning
+  }
+  next();
+  return result;
+}
+
+// u_matrix : 'uniform' | 'reset' | prob+ (n of them)
+void CPReader::readDistribution(std::vector<double> &row, int n,
+                                bool allowReset) {
+  if (accept(CP_UNIFORM)) {
+    row.assign(n, 1.0 / n);
+  } else if (CP_RESET == tok) {
+    if (!allowReset) {
+      error("'reset' is only valid in a row of a T statement");
+    }
+    // copy the start distribution; an MDP 'reset' is handled by readT()
+    row = initialBeliefD.data;
+    next();
+  } else {
+    readNumbers(row, /* probs = */ true);
+    if (static_cast<int>(row.size()) != n) {
+      error("expected %d probabilities, got %d", n,
+            static_cast<int>(row.size()));
+    }
+  }
+}
+
+// T(a)(r,c) = v, or O(a)(r,c) = v
+void CPReader::setEntries(std::vector<kmatrix> &M, int a, int r, int c,
+                          double v) {
+  int amin, amax, rmin, rmax, cmin, cmax;
+  cpRange(a, p.numActions, amin, amax);
+  cpRange(r, M[0].size1(), rmin, rmax);
+  cpRange(c, M[0].size2(), cmin, cmax);
+  if (CP_IS_ZERO(v)) {
+    // a zero entry is pushed so it replaces any earlier one
+    v = 0.0;
+  }
+  for (int ai = amin; ai <= amax; ai++) {
+    for (int ri = rmin; ri <= rmax; ri++) {
+      for (int ci = cmin; ci <= cmax; ci++) {
+        M[ai].push_back(ri, ci, v);
+      }
+    }
+  }
+}
+
+void CPReader::setRow(std::vector<kmatrix> &M,
+                      std::vector<std::vector<size_t> > &cleared, int a,
+                      int r, const std::vector<double> &row) {
+  int amin, amax, rmin, rmax;
+  cpRange(a, p.numActions, amin, amax);
+  cpRange(r, M[0].size1(), rmin, rmax);
+  for (int ai = amin; ai <= amax; ai++) {
+    if (cleared[ai].empty()) {
+      cleared[ai].resize(M[ai].size1(), 0);
+    }
+    for (int ri = rmin; ri <= rmax; ri++) {
+      cleared[ai][ri] = M[ai].data.size();
+      FOR(c, row.size()) {
+        if (!CP_IS_ZERO(row[c])) {
+          M[ai].push_back(ri, c, row[c]);
+        }
+      }
+    }
+  }
+}
+
+void CPReader::setMatrix(std::vector<kmatrix> &M,
+                         std::vector<std::vector<size_t> > &cleared, int a,
+                         const std::vector<double> &vals) {
+  int amin, amax;
+  cpRange(a, p.numActions, amin, amax);
+  int numCols = M[0].size2();
+  for (int ai = amin; ai <= amax; ai++) {
+    M[ai].data.clear();
+    cleared[ai].clear();
+    FOR(i, vals.size()) {
+      if (!CP_IS_ZERO(vals[i])) {
+        M[ai].push_back(i / numCols, i % numCols, vals[i]);
+      }
+    }
+  }
+}
+
+void CPReader::readPreamble(void) {
+  bool discountSet = false, valuesSet = false, statesSet = false,
+       actionsSet = false;
+  for (;;) {
+    switch (tok) {
+      case CP_DISCOUNT:
+        next();
+        expect(CP_COLON, "':' after 'discount'");
+        p.discount = readNumber();
+        if (p.discount < 0.0 || p.discount > 1.0) {
+          error("discount factor %g is not between 0 and 1", p.discount);
+        }
+        discountSet = true;
+        break;
+      case CP_VALUES:
+        next();
+        expect(CP_COLON, "':' after 'values'");
+        // as in Cassandra's parser, 'cost' is accepted but values are
+        // not negated
+        if (!accept(CP_REWARD) && !accept(CP_COST)) {
+          error("expected 'reward' or 'cost' after 'values:'");
+        }
+        valuesSet = true;
+        break;
+      case CP_STATES:
+        next();
+        expect(CP_COLON, "':' after 'states'");
+        readCount(CP_STATE_NAME, p.numStates);
+        statesSet = true;
+        break;
+      case CP_ACTIONS:
+        next();
+        expect(CP_COLON, "':' after 'actions'");
+        readCount(CP_ACTION_NAME, p.numActions);
+        actionsSet = true;
+        break;
+      case CP_OBSERVATIONS:
+        next();
+        expect(CP_COLON, "':' after 'observations'");
+        readCount(CP_OBS_NAME, p.numObservations);
+        isPomdp = true;
+        break;
+      default:
+        goto preambleDone;
+    }
+  }
+preambleDone:
+
+  if (!discountSet) error("no 'discount' statement in preamble");
+  if (!valuesSet) error("no 'values' statement in preamble");
+  if (!statesSet) error("no 'states' statement in preamble");
+  if (!actionsSet) error("no 'actions' statement in preamble");
+  if (expectPomdp && !isPomdp) {
+    error("expected a POMDP, but there is no 'observations' statement");
+  }
+  if (!expectPomdp && isPomdp) {
+    error("expected an MDP, but there is an 'observations' statement");
+  }
+  if (!isPomdp) {
+    p.numObservations = -1;
+  }
+
+  Tk.resize(p.numActions);
+  Tcleared.resize(p.numActions);
+  FOR(a, p.numActions) { Tk[a].resize(p.numStates, p.numStates); }
+  if (isPomdp) {
+    Ok.resize(p.numActions);
+    Ocleared.resize(p.numActions);
+    FOR(a, p.numActions) { Ok[a].resize(p.numStates, p.numObservations); }
+    initialBeliefD.resize(p.numStates);
+  }
+}
+
+void CPReader::readStart(void) {
+  int S = p.numStates;
+
+  if (CP_START != tok) {
+    // default: uniform for a POMDP, no start state for an MDP
+    if (isPomdp) {
+      FOR(s, S) { initialBeliefD(s) = 1.0 / S; }
+    }
+    return;
+  }
+  next();
+
+  if (CP_INCLUDE == tok || CP_EXCLUDE == tok) {
+    bool include = (CP_INCLUDE == tok);
+    if (!isPomdp) {
+      error("'start include' and 'start exclude' are only valid for POMDPs");
+    }
+    next();
+    expect(CP_COLON, "':'");
+    FOR(s, S) { initialBeliefD(s) = include ? 0.0 : 1.0; }
+    if (CP_INT != tok && CP_STRING != tok && CP_ASTERISK != tok) {
+      error("expected a list of states");
+    }
+    while (CP_INT == tok || CP_STRING == tok || CP_ASTERISK == tok) {
+      int smin, smax;
+      cpRange(readIndex(CP_STATE_NAME), S, smin, smax);
+      for (int s = smin; s <= smax; s++) {
+        initialBeliefD(s) = include ? 1.0 : 0.0;
+      }
+    }
+    double sum = 0.0;
+    FOR(s, S) { sum += initialBeliefD(s); }
+    if (sum <= 0.0) {
+      error("start distribution has no states");
+    }
+    FOR(s, S) { initialBeliefD(s) /= sum; }
+    return;
+  }
+
+  expect(CP_COLON, "':' after 'start'");
+  if (CP_STRING == tok) {
+    int s = readIndex(CP_STATE_NAME);
+    if (isPomdp) {
+      initialBeliefD(s) = 1.0;
+    } else {
+      initialState = s;
+    }
+  } else if (!isPomdp) {
+    if (CP_INT != tok) {
+      error("MDP start state must be a single state");
+    }
+    initialState = readIndex(CP_STATE_NAME);
+  } else {
+    readDistribution(numbers, S, /* allowReset = */ false);
+    double sum = 0.0;
+    FOR(s, S) {
+      initialBeliefD(s) = numbers[s];
+      sum += numbers[s];
+    }
+    if (sum < 1.0 - CP_PROB_SUM_EPS || sum > 1.0 + CP_PROB_SUM_EPS) {
+      error("start probabilities sum to %.5lf, not 1", sum);
+    }
+  }
+}
+
+// T: a : s : s' prob | T: a : s u_matrix | T: a ui_matrix
+void CPReader::readT(void) {
+  int S = p.numStates;
+  next();
+  expect(CP_COLON, "':' after 'T'");
+  int a = readIndex(CP_ACTION_NAME);
+  if (accept(CP_COLON)) {
+    int s = readIndex(CP_STATE_NAME);
+    if (accept(CP_COLON)) {
+      int sp = readIndex(CP_STATE_NAME);
+      setEntries(Tk, a, s, sp, readProb());
+    } else if (!isPomdp && CP_RESET == tok) {
+      // an MDP 'reset' only adds the transition to the start state
+      if (-1 == initialState) {
+        error("'reset' requires a 'start' statement");
+      }
+      next();
+      setEntries(Tk, a, s, initialState, 1.0);
+    } else {
+      readDistribution(numbers, S, /* allowReset = */ true);
+      setRow(Tk, Tcleared, a, s, numbers);
+    }
+  } else {
+    if (accept(CP_UNIFORM)) {
+      numbers.assign(static_cast<size_t>(S) * S, 1.0 / S);
+    } else if (accept(CP_IDENTITY)) {
+      numbers.assign(static_cast<size_t>(S) * S, 0.0);
+      FOR(s, S) { numbers[static_cast<size_t>(s) * S + s] = 1.0; }
+    } else {
+      readNumbers(numbers, /* probs = */ true);
+      if (numbers.size() != static_cast<size_t>(S) * S) {
+        error("expected %d probabilities, got %d", S * S,
+              static_cast<int>(numbers.size()));
+      }
+    }
+    setMatrix(Tk, Tcleared, a, numbers);
+  }
+}
+
+// O: a : s' : o prob | O: a : s' u_matrix | O: a u_matrix
+void CPReader::readO(void) {
+  int S = p.numStates;
+  int O = p.numObservations;
+  if (!isPomdp) {
+    error("'O' statements are only valid for POMDPs");
+  }
+  next();
+  expect(CP_COLON, "':' after 'O'");
+  int a = readIndex(CP_ACTION_NAME);
+  if (accept(CP_COLON)) {
+    int sp = readIndex(CP_STATE_NAME);
+    if (accept(CP_COLON)) {
+      int o = readIndex(CP_OBS_NAME);
+      setEntries(Ok, a, sp, o, readProb());
+    } else {
+      readDistribution(numbers, O, /* allowReset = */ false);
+      setRow(Ok, Ocleared, a, sp, numbers);
+    }
+  } else {
+    if (accept(CP_UNIFORM)) {
+      numbers.assign(static_cast<size_t>(S) * O, 1.0 / O);
+    } else {
+      readNumbers(numbers, /* probs = */ true);
+      if (numbers.size() != static_cast<size_t>(S) * O) {
+        error("expected %d probabilities, got %d", S * O,
+              static_cast<int>(numbers.size()));
+      }
+    }
+    setMatrix(Ok, Ocleared, a, numbers);
+  }
+}
+
+void CPReader::addReward(int kind, int a, int s, int sp, int o,
+                         size_t numValues) {
+  if (numbers.size() != numValues) {
+    error("expected %d values, got %d", static_cast<int>(numValues),
+          static_cast<int>(numbers.size()));
+  }
+  CPReward r;
+  r.kind = kind;
+  r.a = a;
+  r.s = s;
+  r.sp = sp;
+  r.o = o;
+  r.values = rewardValues.size();
+  rewards.push_back(r);
+  rewardValues.insert(rewardValues.end(), numbers.begin(), numbers.end());
+}
+
+// POMDP: R: a : s : s' : o num | R: a : s : s' num+ | R: a : s num+
+// MDP:   R: a : s : s' num | R: a : s num+ | R: a num+
+void CPReader::readR(void) {
+  size_t S = p.numStates;
+  size_t O = p.numObservations;
+  next();
+  expect(CP_COLON, "':' after 'R'");
+  int a = readIndex(CP_ACTION_NAME);
+  if (accept(CP_COLON)) {
+    int s = readIndex(CP_STATE_NAME);
+    if (accept(CP_COLON)) {
+      int sp = readIndex(CP_STATE_NAME);
+      if (accept(CP_COLON)) {
+        if (!isPomdp) {
+          error("'R: a : s : s' : o' is only valid for POMDPs");
+        }
+        int o = readIndex(CP_OBS_NAME);
+        numbers.assign(1, readNumber());
+        addReward(CP_REWARD_VALUE, a, s, sp, o, 1);
+      } else {
+        readNumbers(numbers, /* probs = */ false);
+        if (isPomdp) {
+          addReward(CP_REWARD_BY_OBS, a, s, sp, -1, O);
+        } else {
+          addReward(CP_REWARD_VALUE, a, s, sp, -1, 1);
+        }
+      }
+    } else {
+      readNumbers(numbers, /* probs = */ false);
+      if (isPomdp) {
+        addReward(CP_REWARD_BY_NEXT_OBS, a, s, -1, -1, S * O);
+      } else {
+        addReward(CP_REWARD_BY_NEXT, a, s, -1, -1, S);
+      }
+    }
+  } else {
+    if (isPomdp) {
+      error("'R: a' followed by a matrix is only valid for MDPs");
+    }
+    readNumbers(numbers, /* probs = */ false);
+    addReward(CP_REWARD_BY_CUR_NEXT, a, -1, -1, -1, S * S);
+  }
+}
+
+// the reward for (s,a,s',o) given the R statements that match (a,s), in
+// file order: the last statement that specifies it wins.  entries of R
+// matrices that are zero don't override earlier statements, since
+// Cassandra's parser stores those matrices sparsely.
+double CPReader::getReward(const std::vector<int> &matches, int s, int sp,
+                           int o) const {
+  size_t S = p.numStates;
+  size_t O = p.numObservations;
+  for (size_t k = matches.size(); k-- > 0;) {
+    const CPReward &r = rewards[matches[k]];
+    const double *vals = &rewardValues[r.values];
+    double v;
+    switch (r.kind) {
+      case CP_REWARD_VALUE:
+        if ((-1 == r.sp || sp == r.sp) && (-1 == r.o || o == r.o)) {
+          return vals[0];
+        }
+        break;
+      case CP_REWARD_BY_OBS:
+        if (-1 == r.sp || sp == r.sp) {
+          return vals[o];
+        }
+        break;
+      case CP_REWARD_BY_NEXT:
+        return vals[sp];
+      case CP_REWARD_BY_NEXT_OBS:
+        v = vals[sp * O + o];
+        if (!CP_IS_ZERO(v)) return v;
+        break;
+      case CP_REWARD_BY_CUR_NEXT:
+        v = vals[s * S + sp];
+        if (!CP_IS_ZERO(v)) return v;
+        break;
+      default:
+        assert(0);  // never reach this point
+    }
+  }
+  return 0.0;
+}
+
+size_t CPReader::bufferBytes(void) const {
+  size_t bytes = 0;
+  FOR(a, Tk.size()) {
+    bytes += Tk[a].data.capacity() * sizeof(kmatrix_entry) +
+             Tcleared[a].capacity() * sizeof(size_t);
+  }
+  FOR(a, Ok.size()) {
+    bytes += Ok[a].data.capacity() * sizeof(kmatrix_entry) +
+             Ocleared[a].capacity() * sizeof(size_t);
+  }
+  bytes += rewards.capacity() * sizeof(CPReward) +
+           rewardValues.capacity() * sizeof(double) +
+           numbers.capacity() * sizeof(double);
+  return bytes;
+}
+
+void CPReader::read(void) {
+  next();
+  readPreamble();
+  readStart();
+  for (;;) {
+    switch (tok) {
+      case CP_T:
+        readT();
+        break;
+      case CP_O:
+        readO();
+        break;
+      case CP_R:
+        readR();
+        break;
+      case CP_END:
+        return;
+      default:
+        error("expected a 'T', 'O', or 'R' statement");
+    }
+  }
+}
+
+// converts the buffers to the model's sla matrices, checks that the
+// distributions sum to 1, and computes the expected rewards
+void CPReader::finish(void) {
+  int S = p.numStates;
+  int A = p.numActions;
+
+  p.T.resize(A);
+  p.Ttr.resize(A);
+  if (isPomdp) {
+    p.O.resize(A);
+  }
+
+  // index the R statements by (a,s), with A and S standing for wildcards
+  std::vector<std::pair<size_t, int> > rewardIndex(rewards.size());
+  FOR(i, rewards.size()) {
+    const CPReward &r = rewards[i];
+    size_t a = (-1 == r.a) ? A : r.a;
+    size_t s = (-1 == r.s) ? S : r.s;
+    rewardIndex[i] = make_pair(a * (S + 1) + s, static_cast<int>(i));
+  }
+  std::sort(rewardIndex.begin(), rewardIndex.end());
+
+  std::vector<dvector> Q(A);
+  std::vector<int> badTrans(A, -1), badObs(A, -1);
+  std::vector<double> badTransSum(A), badObsSum(A);
+  threadPoolG.parallelFor(A, [&](int a) {
+    std::vector<size_t> Tstarts, Ostarts;
+
+    cpDropClearedEntries(Tk[a], Tcleared[a]);
+    Tk[a].canonicalize();
+    cpDropZeroEntries(Tk[a]);
+    copy(p.T[a], Tk[a]);
+    kmatrix_transpose_in_place(Tk[a]);
+    copy(p.Ttr[a], Tk[a]);
+    cpColumnStarts(Tstarts, Tk[a]);
+    badTrans[a] = cpFindBadColumn(Tk[a], Tstarts, badTransSum[a]);
+
+    if (isPomdp) {
+      cpDropClearedEntries(Ok[a], Ocleared[a]);
+      Ok[a].canonicalize();
+      cpDropZeroEntries(Ok[a]);
+      copy(p.O[a], Ok[a]);
+      kmatrix_transpose_in_place(Ok[a]);
+      cpColumnStarts(Ostarts, Ok[a]);
+      badObs[a] = cpFindBadColumn(Ok[a], Ostarts, badObsSum[a]);
+    }
+
+    // Q(s,a) = sum_{s',o} T(a)(s,s') O(a)(s',o) R(s,a,s',o), summed in
+    // the same order as Cassandra's computeRewards()
+    Q[a].resize(S);
+    std::vector<int> matches;
+    FOR(s, S) {
+      matches.clear();
+      size_t keys[4] = {static_cast<size_t>(A) * (S + 1) + S,
+                        static_cast<size_t>(A) * (S + 1) + s,
+                        static_cast<size_t>(a) * (S + 1) + S,
+                        static_cast<size_t>(a) * (S + 1) + s};
+      FOR(k, 4) {
+        typeof(rewardIndex.begin()) ri = std::lower_bound(
+            rewardIndex.begin(), rewardIndex.end(), make_pair(keys[k], -1));
+        for (; ri != rewardIndex.end() && ri->first == keys[k]; ri++) {
+          matches.push_back(ri->second);
+        }
+      }
+      std::sort(matches.begin(), matches.end());
+
+      double sum = 0.0;
+      for (size_t i = Tstarts[s]; i < Tstarts[s + 1]; i++) {
+        int sp = Tk[a].data[i].r;
+        double innerSum;
+        if (isPomdp) {
+          innerSum = 0.0;
+          for (size_t j = Ostarts[sp]; j < Ostarts[sp + 1]; j++) {
+            innerSum += Ok[a].data[j].value *
+                        getReward(matches, s, sp, Ok[a].data[j].r);
+          }
+        } else {
+          innerSum = getReward(matches, s, sp, 0);
+        }
+        sum += Tk[a].data[i].value * innerSum;
+      }
+      Q[a](s) = sum;
+    }
+
+    // release the buffers as we go
+    kmatrix().data.swap(Tk[a].data);
+    if (isPomdp) {
+      kmatrix().data.swap(Ok[a].data);
+    }
+  });
+
+  // these errors are about the model as a whole, not a line of the file
+  tokLine = 0;
+  FOR(a, A) {
+    if (-1 != badTrans[a]) {
+      error("transition probabilities for action=%d, state=%d sum to %.5lf, "
+            "not 1",
+            a, badTrans[a], badTransSum[a]);
+    }
+  }
+  FOR(a, A) {
+    if (-1 != badObs[a]) {
+      error("observation probabilities for action=%d, state=%d sum to %.5lf, "
+            "not 1",
+            a, badObs[a], badObsSum[a]);
+    }
+  }
+
+  kmatrix Rk(S, A);
+  FOR(s, S) {
+    FOR(a, A) {
+      if (!CP_IS_ZERO(Q[a](s))) {
+        Rk.push_back(s, a, Q[a](s));
+      }
+    }
+  }
+  copy(p.R, Rk);
+
+  if (isPomdp) {
+    copy(p.initialBelief, initialBeliefD);
+  } else {
+    p.initialState.resize(1);
+    p.initialState.push_back(0, initialState);
+  }
+}
+
+/***************************************************************************
+ * CASSANDRAPARSER
+ ***************************************************************************/
+
 void CassandraParser::readGenericDiscreteMDPFromFile(
     CassandraModel &mdp, const std::string &_fileName) {
   mdp.fileName = _fileName;
@@ -53,15 +1076,51 @@ void CassandraParser::readPomdpFromFile(CassandraModel &pomdp,
   readModelFromFile(pomdp, /* expectPomdp = */ true);
 }
 
+void CassandraParser::readModelFromFile(CassandraModel &p, bool expectPomdp) {
+  if (useCanonicalParser) {
+    readModelWithCanonicalParser(p, expectPomdp);
+    return;
+  }
+
+  timeval startTime, endTime;
+  if (zmdpDebugLevelG >= 1) {
+    cout << "reading problem from " << p.fileName << endl;
+    gettimeofday(&startTime, 0);
+  }
+
+  TextFile text;
+  text.read(p.fileName);
+  CPReader reader(p, expectPomdp, text.data, text.size);
+  reader.read();
+  size_t bufferBytes = reader.bufferBytes();
+  reader.finish();
+
+  p.checkForTerminalStates();
+
+  if (zmdpDebugLevelG >= 1) {
+    gettimeofday(&endTime, 0);
+    double numSeconds = (endTime.tv_sec - startTime.tv_sec) +
+                        1e-6 * (endTime.tv_usec - startTime.tv_usec);
+    cout << "[file reading took " << numSeconds << " seconds]" << endl;
+    cout << "[peak memory during load: "
+         << (cpPeakResidentBytes() / 1048576.0) << " MB resident, "
+         << (bufferBytes / 1048576.0) << " MB of parse buffers]" << endl;
+
+    p.debugDensity();
+  }
+}
+
 // This macro is a pure pass-through. I just use it to make clear
 // that the argument is a global variable declared in Tony Cassandra's
 // code base.
 #define CASSANDRA_GLOBAL(X) (X)
 
-void CassandraParser::readModelFromFile(CassandraModel &p, bool expectPomdp) {
+void CassandraParser::readModelWithCanonicalParser(CassandraModel &p,
+                                                   bool expectPomdp) {
   timeval startTime, endTime;
   if (zmdpDebugLevelG >= 1) {
-    cout << "reading problem from " << p.fileName << endl;
+    cout << "reading problem from " << p.fileName
+         << " (canonical parser)" << endl;
     gettimeofday(&startTime, 0);
   }
 
@@ -29,12 +29,21 @@ using namespace sla;
 namespace zmdp {
 
 struct CassandraParser {
+  // if true, models are read with Tony Cassandra's original yacc/lex
+  // parser instead of the single-pass reader.  it is much slower, and is
+  // kept as a reference to check the single-pass reader against.
+  bool useCanonicalParser;
+
+  CassandraParser(void) : useCanonicalParser(false) {}
+
   void readGenericDiscreteMDPFromFile(CassandraModel &mdp,
                                       const std::string &fileName);
   void readPomdpFromFile(CassandraModel &pomdp, const std::string &fileName);
 
  protected:
   void readModelFromFile(CassandraModel &problem, bool expectPomdp);
+  void readModelWithCanonicalParser(CassandraModel &problem,
+                                    bool expectPomdp);
 };
 
 };  // namespace zmdp
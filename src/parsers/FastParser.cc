@@ -24,13 +24,15 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
-#include <unistd.h>
 
-#include <fstream>
+#include <algorithm>
 #include <iostream>
 
 #include "MatrixUtils.h"
+#include "ThreadPool.h"
+#include "TextInput.h"
 #include "slaMatrixUtils.h"
 #include "sla_cassandra.h"
 #include "zmdpCommonDefs.h"
@@ -55,6 +57,153 @@ static void trimTrailingWhiteSpace(char *s) {
   s[i + 1] = '\0';
 }
 
+// the body of a model (its R, T and O statements) is split at line
+// boundaries into chunks that are parsed in parallel.  there are a few
+// chunks per thread so that uneven chunks balance out.
+#define FP_MIN_CHUNK_BYTES (1 << 20)
+#define FP_CHUNKS_PER_THREAD (4)
+
+// entries parsed from one chunk of the body, bucketed by action
+struct FPChunk {
+  const char *begin;
+  const char *end;
+  int numLines;
+  // line of the first error, counting from 0 at the start of the
+  // chunk, or -1 if there was no error
+  int errorLine;
+  std::string errorMsg;
+  std::vector<std::vector<kmatrix_entry> > T, O;
+  std::vector<kmatrix_entry> R;
+};
+
+#define FP_LINE_PREFIX_MATCHES(X) \
+  (lineEnd - line >= 2 && 0 == strncmp(line, (X), 2))
+
+// parses one line of the body into c.  on error, sets c.errorMsg and
+// returns false.
+static bool fpParseLine(FPChunk &c, const CassandraModel &p, bool expectPomdp,
+                        const char *rFormat, const char *line,
+                        const char *lineEnd) {
+  if (line != lineEnd && '#' == *line) return true;
+  while (lineEnd != line && isspace(lineEnd[-1])) lineEnd--;
+  if (line == lineEnd) return true;
+
+  const char *s = line + 2;
+  if (FP_LINE_PREFIX_MATCHES("R:")) {
+    int st, a;
+    double reward;
+    if (!(fastScanInt(s, lineEnd, a) && fastScanChar(s, lineEnd, ':') &&
+          fastScanInt(s, lineEnd, st) && fastScanChar(s, lineEnd, ':') &&
+          fastScanChar(s, lineEnd, '*') &&
+          (!expectPomdp ||
+           (fastScanChar(s, lineEnd, ':') && fastScanChar(s, lineEnd, '*'))) &&
+          fastScanDouble(s, lineEnd, reward))) {
+      c.errorMsg = std::string("syntax error in R statement\n") +
+                   "  (expected format is '" + rFormat + "')";
+      return false;
+    }
+    if (a < 0 || a >= p.numActions || st < 0 || st >= p.numStates) {
+      c.errorMsg = "index out of range in R statement";
+      return false;
+    }
+    c.R.push_back(kmatrix_entry(st, a, reward));
+  } else if (FP_LINE_PREFIX_MATCHES("T:")) {
+    int st, a, sp;
+    double prob;
+    if (!(fastScanInt(s, lineEnd, a) && fastScanChar(s, lineEnd, ':') &&
+          fastScanInt(s, lineEnd, st) && fastScanChar(s, lineEnd, ':') &&
+          fastScanInt(s, lineEnd, sp) && fastScanDouble(s, lineEnd, prob))) {
+      c.errorMsg = "syntax error in T statement";
+      return false;
+    }
+    if (a < 0 || a >= p.numActions || st < 0 || st >= p.numStates ||
+        sp < 0 || sp >= p.numStates) {
+      c.errorMsg = "index out of range in T statement";
+      return false;
+    }
+    c.T[a].push_back(kmatrix_entry(st, sp, prob));
+  } else if (FP_LINE_PREFIX_MATCHES("O:")) {
+    if (!expectPomdp) {
+      c.errorMsg = "got unexpected 'O' statement in MDP";
+      return false;
+    }
+    int sp, a, o;
+    double prob;
+    if (!(fastScanInt(s, lineEnd, a) && fastScanChar(s, lineEnd, ':') &&
+          fastScanInt(s, lineEnd, sp) && fastScanChar(s, lineEnd, ':') &&
+          fastScanInt(s, lineEnd, o) && fastScanDouble(s, lineEnd, prob))) {
+      c.errorMsg = "syntax error in O statement";
+      return false;
+    }
+    if (a < 0 || a >= p.numActions || sp < 0 || sp >= p.numStates || o < 0 ||
+        o >= p.numObservations) {
+      c.errorMsg = "index out of range in O statement";
+      return false;
+    }
+    c.O[a].push_back(kmatrix_entry(sp, o, prob));
+  } else {
+    c.errorMsg = "got unexpected statement type while parsing body";
+    return false;
+  }
+  return true;
+}
+
+static void fpParseChunk(FPChunk &c, const CassandraModel &p, bool expectPomdp,
+                         const char *rFormat) {
+  c.numLines = 0;
+  c.errorLine = -1;
+  c.T.resize(p.numActions);
+  if (expectPomdp) {
+    c.O.resize(p.numActions);
+  }
+
+  const char *line = c.begin;
+  while (line != c.end) {
+    const char *lineEnd =
+        static_cast<const char *>(memchr(line, '\n', c.end - line));
+    const char *next;
+    if (NULL == lineEnd) {
+      lineEnd = next = c.end;
+    } else {
+      next = lineEnd + 1;
+    }
+    if (!fpParseLine(c, p, expectPomdp, rFormat, line, lineEnd)) {
+      c.errorLine = c.numLines;
+      return;
+    }
+    c.numLines++;
+    line = next;
+  }
+}
+
+// moves the entries that bucket() selects from each chunk into result,
+// in file order
+template <class F>
+static void fpMergeChunks(kmatrix &result, std::vector<FPChunk> &chunks,
+                          F bucket) {
+  size_t total = 0;
+  FOR_EACH(ci, chunks) { total += bucket(*ci).size(); }
+  result.data.reserve(total);
+  FOR_EACH(ci, chunks) {
+    std::vector<kmatrix_entry> &b = bucket(*ci);
+    result.data.insert(result.data.end(), b.begin(), b.end());
+    std::vector<kmatrix_entry>().swap(b);
+  }
+}
+
+// returns the first column of A whose entries do not sum to 1, or -1
+static int fpFindBadColumn(const cmatrix &A, double &badSum) {
+  cvector checkTmp;
+  FOR(col, A.size2()) {
+    copy_from_column(checkTmp, A, col);
+    badSum = sum(checkTmp);
+    if (fabs(badSum - 1.0) > POMDP_READ_ERROR_EPS) {
+      return col;
+    }
+  }
+  return -1;
+}
+
 /***************************************************************************
  * POMDP FUNCTIONS
  ***************************************************************************/
@@ -72,24 +221,15 @@ void FastParser::readPomdpFromFile(CassandraModel &pomdp,
 }
 
 void FastParser::readModelFromFile(CassandraModel &problem, bool expectPomdp) {
-  ifstream in;
-
   timeval startTime, endTime;
   if (zmdpDebugLevelG >= 1) {
     cout << "reading problem (in fast mode) from " << problem.fileName << endl;
     gettimeofday(&startTime, 0);
   }
 
-  in.open(problem.fileName.c_str());
-  if (!in) {
-    cerr << "ERROR: couldn't open " << problem.fileName
-         << " for reading: " << strerror(errno) << endl;
-    exit(EXIT_FAILURE);
-  }
-
-  readModelFromStream(problem, in, expectPomdp);
-
-  in.close();
+  TextFile text;
+  text.read(problem.fileName);
+  readModelFromBuffer(problem, text.data, text.size, expectPomdp);
 
   if (zmdpDebugLevelG >= 1) {
     gettimeofday(&endTime, 0);
@@ -99,16 +239,13 @@ void FastParser::readModelFromFile(CassandraModel &problem, bool expectPomdp) {
   }
 }
 
-void FastParser::readModelFromStream(CassandraModel &p, std::istream &in,
-                                     bool expectPomdp) {
-  char buf[1 << 20];
+void FastParser::readModelFromBuffer(CassandraModel &p, const char *data,
+                                     size_t size, bool expectPomdp) {
+  std::vector<char> lineBuf;
   int lineNumber;
   char sbuf[512];
   bool inPreamble = true;
 
-  kmatrix Rx;
-  std::vector<kmatrix> Tx, Ox;
-
   bool discountSet = false;
   bool valuesSet = false;
   bool numStatesSet = false;
@@ -121,219 +258,231 @@ void FastParser::readModelFromStream(CassandraModel &p, std::istream &in,
 
 #define PM_PREFIX_MATCHES(X) (0 == strncmp(buf, (X), strlen(X)))
 
-  lineNumber = 1;
-  while (!in.eof()) {
-    in.getline(buf, sizeof(buf));
-    if (in.fail() && !in.eof()) {
-      cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-           << ": line too long for buffer"
-           << " (max length " << sizeof(buf) << ")" << endl;
-      exit(EXIT_FAILURE);
+  // parse the preamble one line at a time, stopping at the first line
+  // of the body
+  const char *end = data + size;
+  const char *line = data;
+  const char *next;
+  for (lineNumber = 1; line != end; line = next, lineNumber++) {
+    const char *lineEnd =
+        static_cast<const char *>(memchr(line, '\n', end - line));
+    if (NULL == lineEnd) {
+      lineEnd = next = end;
+    } else {
+      next = lineEnd + 1;
     }
+    lineBuf.assign(line, lineEnd);
+    lineBuf.push_back('\0');
+    char *buf = lineBuf.data();
 
     if ('#' == buf[0]) continue;
     trimTrailingWhiteSpace(buf);
     if ('\0' == buf[0]) continue;
 
-    if (inPreamble) {
-      if (PM_PREFIX_MATCHES("discount:")) {
-        if (1 != sscanf(buf, "discount: %lf", &p.discount)) {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": syntax error in 'discount' statement" << endl;
-          exit(EXIT_FAILURE);
-        }
-        discountSet = true;
-      } else if (PM_PREFIX_MATCHES("values:")) {
-        if (1 != sscanf(buf, "values: %s", sbuf)) {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": syntax error in 'values' statement" << endl;
-          exit(EXIT_FAILURE);
-        }
-        if (0 != strcmp(sbuf, "reward")) {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": expected 'values: reward', other types not supported by "
-                  "fast parser"
-               << endl;
-          exit(EXIT_FAILURE);
-        }
-        valuesSet = true;
-      } else if (PM_PREFIX_MATCHES("actions:")) {
-        if (1 != sscanf(buf, "actions: %d", &p.numActions)) {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": syntax error in 'actions' statement" << endl;
-          exit(EXIT_FAILURE);
-        }
-        numActionsSet = true;
-      } else if (PM_PREFIX_MATCHES("observations:")) {
-        if (expectPomdp) {
-          if (1 != sscanf(buf, "observations: %d", &p.numObservations)) {
-            cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-                 << ": syntax error in 'observations' statement" << endl;
-            exit(EXIT_FAILURE);
-          }
-          numObservationsSet = true;
-        } else {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": got unexpected 'observations' statement in MDP" << endl;
-          exit(EXIT_FAILURE);
-        }
-      } else if (PM_PREFIX_MATCHES("states:")) {
-        if (1 != sscanf(buf, "states: %d", &p.numStates)) {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": syntax error in 'states' statement" << endl;
-          exit(EXIT_FAILURE);
-        }
-        numStatesSet = true;
-      } else if (PM_PREFIX_MATCHES("start:")) {
-        if (!numStatesSet) {
+    if (PM_PREFIX_MATCHES("discount:")) {
+      if (1 != sscanf(buf, "discount: %lf", &p.discount)) {
+        cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+             << ": syntax error in 'discount' statement" << endl;
+        exit(EXIT_FAILURE);
+      }
+      discountSet = true;
+    } else if (PM_PREFIX_MATCHES("values:")) {
+      if (1 != sscanf(buf, "values: %s", sbuf)) {
+        cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+             << ": syntax error in 'values' statement" << endl;
+        exit(EXIT_FAILURE);
+      }
+      if (0 != strcmp(sbuf, "reward")) {
+        cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+             << ": expected 'values: reward', other types not supported by "
+                "fast parser"
+             << endl;
+        exit(EXIT_FAILURE);
+      }
+      valuesSet = true;
+    } else if (PM_PREFIX_MATCHES("actions:")) {
+      if (1 != sscanf(buf, "actions: %d", &p.numActions)) {
+        cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+             << ": syntax error in 'actions' statement" << endl;
+        exit(EXIT_FAILURE);
+      }
+      numActionsSet = true;
+    } else if (PM_PREFIX_MATCHES("observations:")) {
+      if (expectPomdp) {
+        if (1 != sscanf(buf, "observations: %d", &p.numObservations)) {
           cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": got 'start' statement before 'states' statement" << endl;
+               << ": syntax error in 'observations' statement" << endl;
           exit(EXIT_FAILURE);
         }
-        readStartVector(p, buf, expectPomdp);
-        startSet = true;
+        numObservationsSet = true;
       } else {
-        // the statement is not one that is expected in the preamble,
-        // check that we are ready to transition to parsing the body
+        cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+             << ": got unexpected 'observations' statement in MDP" << endl;
+        exit(EXIT_FAILURE);
+      }
+    } else if (PM_PREFIX_MATCHES("states:")) {
+      if (1 != sscanf(buf, "states: %d", &p.numStates)) {
+        cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+             << ": syntax error in 'states' statement" << endl;
+        exit(EXIT_FAILURE);
+      }
+      numStatesSet = true;
+    } else if (PM_PREFIX_MATCHES("start:")) {
+      if (!numStatesSet) {
+        cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+             << ": got 'start' statement before 'states' statement" << endl;
+        exit(EXIT_FAILURE);
+      }
+      readStartVector(p, buf, expectPomdp);
+      startSet = true;
+    } else {
+      // the statement is not one that is expected in the preamble,
+      // check that we are ready to transition to parsing the body
 
 #define FP_CHECK_SET(VAR, NAME)                                           \
   if (!(VAR)) {                                                           \
     cerr << "ERROR: " << p.fileName << ": line " << lineNumber            \
          << ": at end of preamble, no '" << (NAME) << "' statement found" \
          << endl;                                                         \
+    preambleOk = false;                                                   \
   }
 
-        FP_CHECK_SET(discountSet, "discount");
-        FP_CHECK_SET(valuesSet, "values");
-        FP_CHECK_SET(numStatesSet, "states");
-        FP_CHECK_SET(numActionsSet, "actions");
-        FP_CHECK_SET(startSet, "start");
-        if (expectPomdp) {
-          FP_CHECK_SET(numObservationsSet, "observations");
-        } else {
-          p.numObservations = -1;
-        }
-
-        // initialize data structures
-        Rx.resize(p.numStates, p.numActions);
-        Tx.resize(p.numActions);
-        if (expectPomdp) {
-          Ox.resize(p.numActions);
-        }
-        FOR(a, p.numActions) {
-          Tx[a].resize(p.numStates, p.numStates);
-          if (expectPomdp) {
-            Ox[a].resize(p.numStates, p.numObservations);
-          }
-        }
-
-        // henceforth expect body statements instead of preamble statements
-        inPreamble = false;
-      }
-    }
-
-    if (!inPreamble) {
-      if (PM_PREFIX_MATCHES("R:")) {
-        int s, a;
-        double reward;
-        if (3 != sscanf(buf, rFormat, &a, &s, &reward)) {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": syntax error in R statement\n"
-               << "  (expected format is '" << rFormat << "')" << endl;
-          exit(EXIT_FAILURE);
-        }
-        kmatrix_set_entry(Rx, s, a, reward);
-      } else if (PM_PREFIX_MATCHES("T:")) {
-        int s, a, sp;
-        double prob;
-        if (4 != sscanf(buf, "T: %d : %d : %d %lf", &a, &s, &sp, &prob)) {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": syntax error in T statement" << endl;
-          exit(EXIT_FAILURE);
-        }
-        kmatrix_set_entry(Tx[a], s, sp, prob);
-      } else if (PM_PREFIX_MATCHES("O:")) {
-        if (expectPomdp) {
-          int s, a, o;
-          double prob;
-          if (4 != sscanf(buf, "O: %d : %d : %d %lf", &a, &s, &o, &prob)) {
-            cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-                 << ": syntax error in O statement" << endl;
-            exit(EXIT_FAILURE);
-          }
-          kmatrix_set_entry(Ox[a], s, o, prob);
-        } else {
-          cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-               << ": got unexpected 'O' statement in MDP" << endl;
-          exit(EXIT_FAILURE);
-        }
+      bool preambleOk = true;
+      FP_CHECK_SET(discountSet, "discount");
+      FP_CHECK_SET(valuesSet, "values");
+      FP_CHECK_SET(numStatesSet, "states");
+      FP_CHECK_SET(numActionsSet, "actions");
+      FP_CHECK_SET(startSet, "start");
+      if (expectPomdp) {
+        FP_CHECK_SET(numObservationsSet, "observations");
       } else {
-        cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-             << ": got unexpected statement type while parsing body" << endl;
+        p.numObservations = -1;
+      }
+      if (!preambleOk) {
         exit(EXIT_FAILURE);
       }
+
+      // henceforth expect body statements instead of preamble statements
+      inPreamble = false;
+      break;
     }
+  }
+  if (inPreamble) {
+    cerr << "ERROR: " << p.fileName
+         << ": reached end of file without finding any R, T, or O statements"
+         << endl;
+    exit(EXIT_FAILURE);
+  }
 
-    lineNumber++;
+  // split the rest of the file into chunks at line boundaries
+  size_t bodySize = end - line;
+  size_t numChunks = std::min(
+      static_cast<size_t>(threadPoolG.getNumThreads() * FP_CHUNKS_PER_THREAD),
+      bodySize / FP_MIN_CHUNK_BYTES);
+  numChunks = std::max(numChunks, static_cast<size_t>(1));
+  std::vector<FPChunk> chunks(numChunks);
+  const char *chunkBegin = line;
+  FOR(i, numChunks) {
+    const char *chunkEnd = end;
+    if (i + 1 < numChunks) {
+      chunkEnd = std::max(chunkBegin, line + bodySize * (i + 1) / numChunks);
+      const char *nl =
+          static_cast<const char *>(memchr(chunkEnd, '\n', end - chunkEnd));
+      chunkEnd = (NULL == nl) ? end : (nl + 1);
+    }
+    chunks[i].begin = chunkBegin;
+    chunks[i].end = chunkEnd;
+    chunkBegin = chunkEnd;
   }
 
-  // post-process
-  copy(p.R, Rx);
-  Rx.clear();
+  threadPoolG.parallelFor(numChunks, [&](int i) {
+    fpParseChunk(chunks[i], p, expectPomdp, rFormat);
+  });
+
+  // report the first error in file order
+  int chunkLineNumber = lineNumber;
+  FOR_EACH(ci, chunks) {
+    if (-1 != ci->errorLine) {
+      cerr << "ERROR: " << p.fileName << ": line "
+           << (chunkLineNumber + ci->errorLine) << ": " << ci->errorMsg
+           << endl;
+      exit(EXIT_FAILURE);
+    }
+    chunkLineNumber += ci->numLines;
+  }
 
+  // merge the chunks and build the matrices, one action per job plus
+  // one job for R
   p.T.resize(p.numActions);
   p.Ttr.resize(p.numActions);
   if (expectPomdp) {
     p.O.resize(p.numActions);
   }
-  FOR(a, p.numActions) {
-    copy(p.T[a], Tx[a]);
-    kmatrix_transpose_in_place(Tx[a]);
-    copy(p.Ttr[a], Tx[a]);
+  // the first state whose outgoing transition or observation
+  // probabilities do not sum to 1, or -1
+  std::vector<int> badTransState(p.numActions, -1);
+  std::vector<int> badObsState(p.numActions, -1);
+  std::vector<double> badTransSum(p.numActions), badObsSum(p.numActions);
+  threadPoolG.parallelFor(p.numActions + 1, [&](int a) {
+    if (a == p.numActions) {
+      kmatrix Rk(p.numStates, p.numActions);
+      fpMergeChunks(Rk, chunks,
+                    [](FPChunk &c) -> std::vector<kmatrix_entry> & {
+                      return c.R;
+                    });
+      copy(p.R, Rk);
+      return;
+    }
+
+    kmatrix Tk(p.numStates, p.numStates);
+    fpMergeChunks(Tk, chunks,
+                  [a](FPChunk &c) -> std::vector<kmatrix_entry> & {
+                    return c.T[a];
+                  });
+    copy(p.T[a], Tk);
+    kmatrix_transpose_in_place(Tk);
+    copy(p.Ttr[a], Tk);
 
 #if 1
     // extra error checking
-    cvector checkTmp;
-    FOR(s, p.numStates) {
-      copy_from_column(checkTmp, p.Ttr[a], s);
-      if (fabs(sum(checkTmp) - 1.0) > POMDP_READ_ERROR_EPS) {
-        fprintf(stderr,
-                "ERROR: %s: outgoing transition probabilities do not sum to 1 "
-                "for:\n"
-                "  state %d, action %d, transition sum = %.10lf\n",
-                p.fileName.c_str(), static_cast<int>(s), static_cast<int>(a),
-                sum(checkTmp));
-        exit(EXIT_FAILURE);
-      }
-    }
+    badTransState[a] = fpFindBadColumn(p.Ttr[a], badTransSum[a]);
 #endif
 
-    Tx[a].clear();
-
     if (expectPomdp) {
-      copy(p.O[a], Ox[a]);
+      kmatrix Ok(p.numStates, p.numObservations);
+      fpMergeChunks(Ok, chunks,
+                    [a](FPChunk &c) -> std::vector<kmatrix_entry> & {
+                      return c.O[a];
+                    });
+      copy(p.O[a], Ok);
 
 #if 1
-      cmatrix checkObs;
-
       // extra error checking
-      kmatrix_transpose_in_place(Ox[a]);
-      copy(checkObs, Ox[a]);
-
-      FOR(s, p.numStates) {
-        copy_from_column(checkTmp, checkObs, s);
-        if (fabs(sum(checkTmp) - 1.0) > POMDP_READ_ERROR_EPS) {
-          fprintf(stderr,
-                  "ERROR: %s: observation probabilities do not sum to 1 for:\n"
-                  "  state %d, action %d, observation sum = %.10lf\n",
-                  p.fileName.c_str(), static_cast<int>(s), static_cast<int>(a),
-                  sum(checkTmp));
-          exit(EXIT_FAILURE);
-        }
-      }
+      cmatrix checkObs;
+      kmatrix_transpose_in_place(Ok);
+      copy(checkObs, Ok);
+      badObsState[a] = fpFindBadColumn(checkObs, badObsSum[a]);
 #endif
+    }
+  });
 
-      Ox[a].clear();
+  FOR(a, p.numActions) {
+    if (-1 != badTransState[a]) {
+      fprintf(stderr,
+              "ERROR: %s: outgoing transition probabilities do not sum to 1 "
+              "for:\n"
+              "  state %d, action %d, transition sum = %.10lf\n",
+              p.fileName.c_str(), badTransState[a], static_cast<int>(a),
+              badTransSum[a]);
+      exit(EXIT_FAILURE);
+    }
+    if (-1 != badObsState[a]) {
+      fprintf(stderr,
+              "ERROR: %s: observation probabilities do not sum to 1 for:\n"
+              "  state %d, action %d, observation sum = %.10lf\n",
+              p.fileName.c_str(), badObsState[a], static_cast<int>(a),
+              badObsSum[a]);
+      exit(EXIT_FAILURE);
     }
   }
 
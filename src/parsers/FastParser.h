@@ -18,6 +18,8 @@
 #ifndef ZMDP_SRC_PARSERS_FASTPARSER_H_
 #define ZMDP_SRC_PARSERS_FASTPARSER_H_
 
+#include <stddef.h>
+
 #include <iostream>
 #include <string>
 #include <vector>
@@ -35,8 +37,8 @@ struct FastParser {
 
  protected:
   void readModelFromFile(CassandraModel &problem, bool expectPomdp);
-  void readModelFromStream(CassandraModel &problem, std::istream &in,
-                           bool expectPomdp);
+  void readModelFromBuffer(CassandraModel &problem, const char *data,
+                           size_t size, bool expectPomdp);
   void readStartVector(CassandraModel &problem, char *data, bool expectPomdp);
 };
 
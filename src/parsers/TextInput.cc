@@ -0,0 +1,85 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2002-2005, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include "TextInput.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+
+using namespace std;
+
+namespace zmdp {
+
+TextFile::TextFile(void) : data(NULL), size(0), mapped(NULL) {}
+
+TextFile::~TextFile(void) {
+  if (NULL != mapped) {
+    munmap(mapped, size);
+  }
+}
+
+void TextFile::read(const std::string &fileName) {
+  assert(NULL == data);
+
+  int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat st;
+  if (-1 == fd || 0 != fstat(fd, &st)) {
+    cerr << "ERROR: couldn't open " << fileName
+         << " for reading: " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // map regular files; read anything else (e.g. a pipe) into memory
+  if (S_ISREG(st.st_mode) && st.st_size > 0) {
+    size = st.st_size;
+    mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == mapped) {
+      mapped = NULL;
+    }
+  }
+  if (NULL == mapped) {
+    char buf[1 << 16];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+      contents.insert(contents.end(), buf, buf + n);
+    }
+    if (n < 0) {
+      cerr << "ERROR: couldn't read " << fileName << ": " << strerror(errno)
+           << endl;
+      exit(EXIT_FAILURE);
+    }
+    size = contents.size();
+  }
+  close(fd);
+
+  data = (NULL != mapped) ? static_cast<const char *>(mapped) : contents.data();
+}
+
+};  // namespace zmdp
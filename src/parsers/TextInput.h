@@ -0,0 +1,190 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2002-2005, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_PARSERS_TEXTINPUT_H_
+#define ZMDP_SRC_PARSERS_TEXTINPUT_H_
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+namespace zmdp {
+
+// The contents of a model file, for the parsers.  Regular files are
+// memory-mapped; anything else (e.g. a pipe) is read into memory.  The
+// text is not NUL-terminated.
+struct TextFile {
+  const char *data;
+  size_t size;
+
+  TextFile(void);
+  ~TextFile(void);
+
+  // exits with an error message if the file can't be read
+  void read(const std::string &fileName);
+
+ protected:
+  void *mapped;
+  std::vector<char> contents;
+
+  // not copyable
+  TextFile(const TextFile &);
+  void operator=(const TextFile &);
+};
+
+// The scanning functions below read from s, never looking at or past
+// end, and on success advance s past what they read.
+
+// exact powers of ten that fit in a double
+static const double fastPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool fastIsSpace(char c) {
+  return (' ' == c || '\t' == c || '\r' == c || '\v' == c || '\f' == c);
+}
+
+inline bool fastIsDigit(char c) { return ('0' <= c && c <= '9'); }
+
+inline void fastSkipSpace(const char *&s, const char *end) {
+  while (s != end && fastIsSpace(*s)) s++;
+}
+
+// matches the character c after optional white space
+inline bool fastScanChar(const char *&s, const char *end, char c) {
+  fastSkipSpace(s, end);
+  if (s == end || *s != c) return false;
+  s++;
+  return true;
+}
+
+// reads an integer like sscanf("%d")
+inline bool fastScanInt(const char *&s, const char *end, int &result) {
+  fastSkipSpace(s, end);
+  bool negative = false;
+  if (s != end && ('-' == *s || '+' == *s)) {
+    negative = ('-' == *s);
+    s++;
+  }
+  if (s == end || !fastIsDigit(*s)) return false;
+  long long x = 0;
+  while (s != end && fastIsDigit(*s)) {
+    x = 10 * x + (*s - '0');
+    if (x > INT_MAX) return false;
+    s++;
+  }
+  result = negative ? -x : x;
+  return true;
+}
+
+// reads the number starting at start with strtod, which handles the
+// cases fastScanDouble() does not
+inline bool fastScanDoubleSlow(const char *&s, const char *start,
+                               const char *end, double &result) {
+  char buf[64];
+  size_t n = 0;
+  for (const char *t = start;
+       t != end && !fastIsSpace(*t) && n < sizeof(buf) - 1; t++) {
+    buf[n++] = *t;
+  }
+  buf[n] = '\0';
+  char *bufEnd;
+  result = strtod(buf, &bufEnd);
+  if (bufEnd == buf) return false;
+  s = start + (bufEnd - buf);
+  return true;
+}
+
+// reads a number like sscanf("%lf").  a decimal number with at most 15
+// significant digits and a power of ten within +/-22 is converted
+// exactly with one multiply or divide, which covers the probabilities
+// and rewards in typical models; anything else goes through strtod.
+inline bool fastScanDouble(const char *&s, const char *end, double &result) {
+  fastSkipSpace(s, end);
+  const char *start = s;
+  bool negative = false;
+  if (s != end && ('-' == *s || '+' == *s)) {
+    negative = ('-' == *s);
+    s++;
+  }
+
+  uint64_t mantissa = 0;
+  int numDigits = 0;  // significant digits, not counting leading zeros
+  int exponent = 0;
+  bool sawDigit = false;
+  while (s != end && fastIsDigit(*s)) {
+    sawDigit = true;
+    if (numDigits > 0 || '0' != *s) {
+      if (numDigits < 19) mantissa = 10 * mantissa + (*s - '0');
+      numDigits++;
+    }
+    s++;
+  }
+  if (s != end && '.' == *s) {
+    s++;
+    while (s != end && fastIsDigit(*s)) {
+      sawDigit = true;
+      if (numDigits > 0 || '0' != *s) {
+        if (numDigits < 19) mantissa = 10 * mantissa + (*s - '0');
+        numDigits++;
+      }
+      exponent--;
+      s++;
+    }
+  }
+  if (!sawDigit) {
+    // e.g. 'inf'
+    return fastScanDoubleSlow(s, start, end, result);
+  }
+  if (s != end && ('e' == *s || 'E' == *s)) {
+    const char *t = s + 1;
+    bool expNegative = false;
+    if (t != end && ('-' == *t || '+' == *t)) {
+      expNegative = ('-' == *t);
+      t++;
+    }
+    if (t != end && fastIsDigit(*t)) {
+      int e = 0;
+      while (t != end && fastIsDigit(*t)) {
+        if (e < 10000) e = 10 * e + (*t - '0');
+        t++;
+      }
+      exponent += expNegative ? -e : e;
+      s = t;
+    }
+  }
+  if (numDigits > 15 || exponent < -22 || exponent > 22) {
+    return fastScanDoubleSlow(s, start, end, result);
+  }
+
+  double x = static_cast<double>(mantissa);
+  if (exponent < 0) {
+    x /= fastPowersOfTen[-exponent];
+  } else {
+    x *= fastPowersOfTen[exponent];
+  }
+  result = negative ? -x : x;
+  return true;
+}
+
+};  // namespace zmdp
+
+#endif  // ZMDP_SRC_PARSERS_TEXTINPUT_H_
@@ -48,7 +48,7 @@ void BlindLBInitializer::initialize(double targetPrecision) {
   initBlind(targetPrecision);
 }
 
-void BlindLBInitializer::initBlindWorstCase(alpha_vector &weakAlpha) {
+void BlindLBInitializer::initBlindWorstCase(cvector &weakAlpha) {
   // set alpha to be a lower bound on the value of the best blind policy
 
   double worstStateVal;
@@ -104,11 +104,14 @@ void BlindLBInitializer::initBlindWorstCase(alpha_vector &weakAlpha) {
 }
 
 void BlindLBInitializer::initBlind(double targetPrecision) {
-  alpha_vector al(pomdp->numStates);
-  alpha_vector nextAl, tmp, diff;
-  alpha_vector weakAl;
+  // iterate in double precision even if alpha_vector stores floats, so
+  // the residual can always drop below targetPrecision
+  cvector al(pomdp->numStates);
+  cvector nextAl, tmp, diff;
+  cvector weakAl;
+  alpha_vector alpha;
   double maxResidual;
-  alpha_vector default_mask;
+  mvector default_mask;
 
   if (bound->useMaxPlanesMasking) {
     mask_set_all(default_mask, pomdp->numStates);
@@ -142,7 +145,8 @@ void BlindLBInitializer::initBlind(double targetPrecision) {
       cout << "initLowerBoundBlind: a=" << a << " al=" << sparseRep(al) << endl;
     }
 
-    bound->addLBPlane(new LBPlane(al, a, default_mask));
+    copy(alpha, al);
+    bound->addLBPlane(new LBPlane(alpha, a, default_mask));
   }
 }
 
@@ -34,7 +34,7 @@ struct BlindLBInitializer {
 
  protected:
   void initBlind(double targetPrecision);
-  void initBlindWorstCase(alpha_vector &weakAlpha);
+  void initBlindWorstCase(sla::cvector &weakAlpha);
 };
 
 };  // namespace zmdp
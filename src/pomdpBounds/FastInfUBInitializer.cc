@@ -53,7 +53,7 @@ void FastInfUBInitializer::initMDP(double targetPrecision) {
   // set alpha to be the mdp upper bound
   FullObsUBInitializer m;
   m.valueIteration(pomdp, targetPrecision);
-  cvector calpha;
+  alpha_vector calpha;
   copy(calpha, m.alpha);
 
   alphas.clear();
@@ -157,7 +157,8 @@ void FastInfUBInitializer::initFIB(double targetPrecision) {
 
   // write out result
   bound->pts.clear();
-  copy(bound->cornerPts, dalpha);
+  bound->store.clear();
+  bound->setCornerPts(dalpha);
 }
 
 };  // namespace zmdp
@@ -72,11 +72,25 @@ double FullObsUBInitializer::valueIterationOneStep(void) {
   dvector tmp;
   double maxResidual;
 
-  nextAlphaAction(nextAlpha, 0);
-  FOR(a, pomdp->numActions) {
-    nextAlphaAction(naa, a);
+  if (!pomdp->Tstack.empty()) {
+    // one pass over the stacked transitions computes T[a] * alpha for
+    // all actions
+    pomdp->Tstack.rowProductsAllActions(Talpha, alpha);
     FOR(s, pomdp->getBeliefSize()) {
-      if (naa(s) > nextAlpha(s)) nextAlpha(s) = naa(s);
+      double maxVal = -99e+20;
+      FOR(a, pomdp->numActions) {
+        double val = Talpha(a, s) * pomdp->discount + Rdense(a, s);
+        if (0 == a || val > maxVal) maxVal = val;
+      }
+      nextAlpha(s) = maxVal;
+    }
+  } else {
+    nextAlphaAction(nextAlpha, 0);
+    FOR(a, pomdp->numActions) {
+      nextAlphaAction(naa, a);
+      FOR(s, pomdp->getBeliefSize()) {
+        if (naa(s) > nextAlpha(s)) nextAlpha(s) = naa(s);
+      }
     }
   }
 
@@ -105,6 +119,15 @@ void FullObsUBInitializer::valueIteration(const Pomdp *_pomdp, double eps) {
   alpha.resize(pomdp->getBeliefSize());
   set_to_zero(alpha);
 
+  if (!pomdp->Tstack.empty()) {
+    dvector Rcol;
+    Rdense.resize(pomdp->numActions, pomdp->getBeliefSize());
+    FOR(a, pomdp->numActions) {
+      copy_from_column(Rcol, pomdp->R, a);
+      FOR(s, pomdp->getBeliefSize()) { Rdense(a, s) = Rcol(s); }
+    }
+  }
+
   double residual;
   if (zmdpDebugLevelG >= 1) {
     cout << "using mdp value iteration to generate initial upper bound" << endl
@@ -28,6 +28,9 @@ class FullObsUBInitializer {
  public:
   dvector alpha;
   const Pomdp *pomdp;
+  // with stacked transitions: Talpha(a,s) = T[a](s,:) * alpha, and
+  // Rdense(a,s) = R(s,a)
+  dmatrix Talpha, Rdense;
 
   void nextAlphaAction(dvector &result, int a);
   double valueIterationOneStep(void);
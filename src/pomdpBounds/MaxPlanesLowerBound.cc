@@ -22,21 +22,44 @@
 #include "MaxPlanesLowerBound.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #include "BlindLBInitializer.h"
 #include "MatrixUtils.h"
+#include "SimplexLP.h"
+#include "ThreadPool.h"
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTime.h"
 
 #define PRUNE_PLANES_INCREMENT (10)
 #define PRUNE_PLANES_FACTOR (1.1)
 
+// number of dominating planes the background pruning pass records for
+// each plane.  if all of them are pruned first, the plane is forwarded
+// to whatever plane they were forwarded to.
+#define PRUNE_MAX_DOMINATORS (4)
+
+// prunePlanesLP() keeps planes whose LP would have a larger tableau
+// than this many entries, rather than spend the memory
+#define PRUNE_LP_MAX_TABLEAU_SIZE (1 << 20)
+
+// largest amount the competitor rows of the pruning LP are relaxed by
+#define PRUNE_LP_PERTURBATION (1e-9)
+
 using namespace std;
 using namespace MatrixUtils;
 using namespace sla;
@@ -68,6 +91,8 @@ static std::string stripWhiteSpace(const std::string &s) {
 static bool dominates(const LBPlane *a, const LBPlane *b,
                       bool useMaxPlanesMasking) {
   if (useMaxPlanesMasking) {
+    // a can only dominate b if the mask of b is a subset of a's
+    if (0 != (b->maskSignature & ~a->maskSignature)) return false;
     return mask_dominates(a->alpha, b->alpha, ZMDP_BOUNDS_PRUNE_EPS, a->mask,
                           b->mask);
   } else {
@@ -79,42 +104,48 @@ static bool dominates(const LBPlane *a, const LBPlane *b,
  * LBPLANE
  **********************************************************************/
 
-LBPlane::LBPlane(void) {}
+LBPlane::LBPlane(void) : maskSignature(0) {}
 
 LBPlane::LBPlane(const alpha_vector &_alpha, int _action,
                  const sla::mvector &_mask)
-    : alpha(_alpha), action(_action), mask(_mask) {}
+    : alpha(_alpha), action(_action), mask(_mask), maskSignature(0) {}
 
-void LBPlane::write(std::ostream &out, bool useMaxPlanesMasking) const {
-  out << "    {" << endl;
-  out << "      action => " << action << "," << endl;
+void LBPlane::write(std::ostream &out, bool useMaxPlanesMasking,
+                    const MDP &model) const {
+  out << "    {\n";
+  out << "      action => " << model.getOriginalActionId(action) << ",\n";
 
   if (useMaxPlanesMasking) {
-    out << "      numEntries => " << mask.filled() << "," << endl;
+    out << "      numEntries => " << mask.filled() << ",\n";
   } else {
-    out << "      numEntries => " << alpha.size() << "," << endl;
+    out << "      numEntries => " << alpha.size() << ",\n";
   }
 
-  out << "      entries => [" << endl;
+  out << "      entries => [\n";
 
   if (useMaxPlanesMasking) {
     bool firstEntry = true;
     FOR_CV(mask) {
       if (!firstEntry) {
-        out << "," << endl;
+        out << ",\n";
       }
       int i = CV_INDEX(mask);
-      out << "        " << i << ", " << alpha(i) << "";
+      out << "        " << model.getOriginalStateId(i) << ", " << alpha(i)
+          << "";
       firstEntry = false;
     }
-    out << endl;
+    out << "\n";
   } else {
     int n = alpha.size();
-    FOR(i, n - 1) { out << "        " << i << ", " << alpha(i) << "," << endl; }
-    out << "        " << (n - 1) << ", " << alpha(n - 1) << endl;
+    FOR(i, n - 1) {
+      out << "        " << model.getOriginalStateId(i) << ", " << alpha(i)
+          << ",\n";
+    }
+    out << "        " << model.getOriginalStateId(n - 1) << ", "
+        << alpha(n - 1) << "\n";
   }
 
-  out << "      ]" << endl;
+  out << "      ]\n";
   out << "    }";
 }
 
@@ -127,20 +158,34 @@ MaxPlanesLowerBound::MaxPlanesLowerBound(const MDP *_pomdp,
     : pomdp((const Pomdp *)_pomdp),
       config(_config),
       core(NULL),
-      initialized(false) {
+      initialized(false),
+      newPlaneHandler(NULL),
+      newPlaneHandlerData(NULL),
+      pruneRunning(false),
+      pruneDone(false) {
   lastPruneNumPlanes = 0;
   lastPruneNumBackups = -1;
   useMaxPlanesMasking = config->getBool("useMaxPlanesMasking");
   useMaxPlanesSupportList = config->getBool("useMaxPlanesSupportList");
   useMaxPlanesCache = config->getBool("useMaxPlanesCache");
   useMaxPlanesExtraPruning = config->getBool("useMaxPlanesExtraPruning");
+  useMaxPlanesPackedStore = config->getBool("useMaxPlanesPackedStore");
+  useMaxPlanesBackgroundPruning =
+      config->getBool("useMaxPlanesBackgroundPruning");
+  useMaxPlanesLPPruning = config->getBool("useMaxPlanesLPPruning");
+  maxPlanesLPPruningInterval = config->getInt("maxPlanesLPPruningInterval");
+  numPrunes = 0;
 
   if (useMaxPlanesSupportList) {
-    supportList.resize(pomdp->getBeliefSize());
+    supportList.init(pomdp->getBeliefSize());
+  }
+  if (useMaxPlanesPackedStore) {
+    packedPlanes.init(pomdp->getBeliefSize(), useMaxPlanesMasking);
   }
 }
 
 MaxPlanesLowerBound::~MaxPlanesLowerBound(void) {
+  if (pruneRunning) pruneThread.join();
   FOR_EACH(planeP, planes) { delete *planeP; }
 }
 
@@ -154,6 +199,10 @@ void MaxPlanesLowerBound::initialize(double targetPrecision) {
     // planes from initialization should have their 'age' set appropriately
     FOR_EACH(planeP, planes) { (*planeP)->numBackupsAtCreation = 0; }
   }
+  if (useMaxPlanesPackedStore) {
+    // pick up the new ages (and drop any planes the initializer cleared)
+    packedPlanes.rebuild(planes);
+  }
   initialized = true;
 }
 
@@ -165,11 +214,14 @@ double MaxPlanesLowerBound::getValue(const belief_vector &b,
 
 // lower bound on long-term reward for taking action a (alpha vector)
 void MaxPlanesLowerBound::getNewLBPlaneQ(LBPlane &result, MDPNode &cn, int a) {
-  alpha_vector betaA(pomdp->getBeliefSize());
+  // betaA accumulates T_a * (O_a(:,o) .* betaAO) over all o.  this is
+  // the same as sum_o (O_a(:,o) .* betaAO)' * Ttr_a, but the scatter
+  // only touches states reachable from the nonzeros of each product.
+  sparse_accum &betaA = thread_sparse_accum(SLA_ACCUM_OUTER);
   const alpha_vector *betaAO;
-  alpha_vector tmp, tmp2, tmp3;
+  alpha_vector tmp;
 
-  set_to_zero(betaA);
+  betaA.resize(pomdp->getBeliefSize());
 
   bool defaultIsSet = false;
   const alpha_vector *defaultBetaAO = NULL;
@@ -202,26 +254,23 @@ void MaxPlanesLowerBound::getNewLBPlaneQ(LBPlane &result, MDPNode &cn, int a) {
     }
 
     emult_column(tmp, pomdp->O[a], o, *betaAO);
-    if (useMaxPlanesMasking) {
-      mult(tmp3, pomdp->T[a], tmp);
-      mask_copy(tmp2, tmp3, cn.s);
-    } else {
-      mult(tmp2, tmp, pomdp->Ttr[a]);
-    }
-    betaA += tmp2;
+    mult_add(betaA, pomdp->T[a], tmp);
   }
+  betaA.canonicalize();
 
   alpha_vector Rxa;
   if (useMaxPlanesMasking) {
+    // masking the sum is the same as summing the masked terms
+    mask_copy(result.alpha, betaA, cn.s);
     copy_from_column(tmp, pomdp->R, a);
     mask_copy(Rxa, tmp, cn.s);
   } else {
+    copy(result.alpha, betaA);
     copy_from_column(Rxa, pomdp->R, a);
   }
-  betaA *= pomdp->getDiscount();
-  betaA += Rxa;
+  result.alpha *= pomdp->getDiscount();
+  result.alpha += Rxa;
 
-  result.alpha = betaA;
   result.action = a;
   if (useMaxPlanesMasking) {
     result.mask = cn.s;
@@ -235,18 +284,29 @@ void MaxPlanesLowerBound::getNewLBPlane(LBPlane &result, MDPNode &cn) {
     startTime = getTime();
   }
 
-  double val, maxVal = -99e+20;
-  LBPlane betaA;
-
-  FOR(a, cn.getNumActions()) {
-    getNewLBPlaneQ(betaA, cn, a);
-    val = inner_prod(betaA.alpha, cn.s);
-    cn.Q[a].lbVal = val;
-    if (val > maxVal) {
-      maxVal = val;
-      result = betaA;
+  // the actions are independent, so compute them in parallel and pick
+  // the best one afterward (in action order, so ties break the same way
+  // regardless of the number of threads).  with lazy expansion, only
+  // the expanded actions are backed up.
+  int numActions = cn.getNumActions();
+  std::vector<LBPlane> betaAs(numActions);
+  threadPoolG.parallelFor(numActions, [&](int a) {
+    if (!cn.Q[a].isExpanded()) return;
+    getNewLBPlaneQ(betaAs[a], cn, a);
+    cn.Q[a].lbVal = inner_prod(betaAs[a].alpha, cn.s);
+  });
+
+  double maxVal = -99e+20;
+  int maxAction = -1;
+  FOR(a, numActions) {
+    if (cn.Q[a].lbVal > maxVal) {
+      maxVal = cn.Q[a].lbVal;
+      maxAction = a;
     }
   }
+  if (-1 != maxAction) {
+    result = std::move(betaAs[maxAction]);
+  }
   if (zmdpDebugLevelG >= 1) {
     cout << "** newLowerBound: elapsed time = "
          << timevalToSeconds(getTime() - startTime) << endl;
@@ -267,13 +327,44 @@ void MaxPlanesLowerBound::initNodeBound(MDPNode &cn) {
   setPlaneForNode(cn, &getBestLBPlane(cn.s));
 }
 
+// same result as calling initNodeBound() on each node in turn
+void MaxPlanesLowerBound::initNodeBounds(const std::vector<MDPNode *> &nodes) {
+  std::vector<const belief_vector *> beliefs(nodes.size());
+  FOR(i, nodes.size()) { beliefs[i] = &nodes[i]->s; }
+  std::vector<LBPlane *> best;
+  getBestLBPlanes(best, beliefs);
+
+  FOR(i, nodes.size()) {
+    MDPNode &cn = *nodes[i];
+    if (useMaxPlanesCache) {
+      MaxPlanesData *bdata = new MaxPlanesData();
+      bdata->bestPlane = NULL;
+      cn.boundsData = bdata;
+    }
+    cn.lbVal = -99e+20;
+    setPlaneForNode(cn, best[i]);
+  }
+}
+
 void MaxPlanesLowerBound::update(MDPNode &cn) {
+  commitUpdate(cn, prepareUpdate(cn));
+}
+
+void *MaxPlanesLowerBound::prepareUpdate(MDPNode &cn) {
   LBPlane *newPlane = new LBPlane();
   getNewLBPlane(*newPlane, cn);
+  return newPlane;
+}
+
+void MaxPlanesLowerBound::commitUpdate(MDPNode &cn, void *prepared) {
+  LBPlane *newPlane = reinterpret_cast<LBPlane *>(prepared);
 
   setPlaneForNode(cn, newPlane);
 
   addLBPlane(newPlane);
+  if (NULL != newPlaneHandler) {
+    (*newPlaneHandler)(*newPlane, newPlaneHandlerData);
+  }
   maybePrune(core->numBackups);
 }
 
@@ -342,27 +433,45 @@ const LBPlane &MaxPlanesLowerBound::getPlaneForNode(MDPNode &cn) {
   }
 }
 
+// if al applies to b and has a higher value than maxval there, makes it
+// the best plane so far.  planes created before minNumBackupsAtCreation
+// are skipped.
+static inline void checkPlane(LBPlane *al, const belief_vector &b,
+                              uint64_t bsig, int minNumBackupsAtCreation,
+                              bool useMaxPlanesMasking, double &maxval,
+                              LBPlane *&ret) {
+  if (al->numBackupsAtCreation < minNumBackupsAtCreation) return;
+  if (useMaxPlanesMasking) {
+    if (0 != (bsig & ~al->maskSignature)) return;
+    if (!mask_subset(b, al->mask)) return;
+  }
+  double val = inner_prod(al->alpha, b);
+  if (val > maxval) {
+    maxval = val;
+    ret = al;
+  }
+}
+
 // return the alpha such that alpha * b has the highest value
 const LBPlane &MaxPlanesLowerBound::getBestLBPlaneConst(
     const belief_vector &b) const {
-  const PlaneSet *planesToCheck;
-  if (useMaxPlanesSupportList) {
-    planesToCheck = &supportList[b.data[0].index];
-  } else {
-    planesToCheck = &planes;
+  if (useMaxPlanesPackedStore) {
+    const LBPlane *ret = packedPlanes.getBestPlane(b, INT_MIN, NULL, -99e+20);
+    assert(NULL != ret);
+    return *ret;
   }
 
-  double val, maxval = -99e+20;
-  const LBPlane *ret = NULL;
-  FOR_EACH(pr, *planesToCheck) {
-    const LBPlane *al = *pr;
-    if (useMaxPlanesMasking) {
-      if (!mask_subset(b, al->mask)) continue;
+  uint64_t bsig = useMaxPlanesMasking ? mask_signature(b) : 0;
+  double maxval = -99e+20;
+  LBPlane *ret = NULL;
+  if (useMaxPlanesSupportList) {
+    FOR_EACH(eP, supportList.getList(supportList.getShortestKey(b))) {
+      checkPlane(eP->item, b, bsig, INT_MIN, useMaxPlanesMasking, maxval,
+                 ret);
     }
-    val = inner_prod(al->alpha, b);
-    if (val > maxval) {
-      maxval = val;
-      ret = al;
+  } else {
+    FOR_EACH(pr, planes) {
+      checkPlane(*pr, b, bsig, INT_MIN, useMaxPlanesMasking, maxval, ret);
     }
   }
 
@@ -370,6 +479,61 @@ const LBPlane &MaxPlanesLowerBound::getBestLBPlaneConst(
   return *ret;
 }
 
+// result[i] = &getBestLBPlane(*beliefs[i]).  the beliefs that check the
+// same list of planes are grouped, and each plane in the list is read
+// once and compared against every belief in the group.
+void MaxPlanesLowerBound::getBestLBPlanes(
+    std::vector<LBPlane *> &result,
+    const std::vector<const belief_vector *> &beliefs) {
+  if (useMaxPlanesPackedStore) {
+    packedPlanes.getBestPlanes(result, beliefs);
+    FOR_EACH(retP, result) { assert(NULL != *retP); }
+    return;
+  }
+
+  int n = beliefs.size();
+  result.assign(n, NULL);
+  std::vector<double> maxVals(n, -99e+20);
+  std::vector<uint64_t> bsigs(n, 0);
+  if (useMaxPlanesMasking) {
+    FOR(i, n) { bsigs[i] = mask_signature(*beliefs[i]); }
+  }
+
+  // order the beliefs by the support list they check
+  std::vector<std::pair<int, int> > order(n);
+  FOR(i, n) {
+    order[i].first =
+        useMaxPlanesSupportList ? supportList.getShortestKey(*beliefs[i]) : 0;
+    order[i].second = i;
+  }
+  std::sort(order.begin(), order.end());
+
+  for (int start = 0; start < n;) {
+    int end = start + 1;
+    while (end < n && order[end].first == order[start].first) end++;
+
+    if (useMaxPlanesSupportList) {
+      FOR_EACH(eP, supportList.getList(order[start].first)) {
+        for (int k = start; k < end; k++) {
+          int i = order[k].second;
+          checkPlane(eP->item, *beliefs[i], bsigs[i], INT_MIN,
+                     useMaxPlanesMasking, maxVals[i], result[i]);
+        }
+      }
+    } else {
+      FOR_EACH(pr, planes) {
+        for (int k = start; k < end; k++) {
+          int i = order[k].second;
+          checkPlane(*pr, *beliefs[i], bsigs[i], INT_MIN,
+                     useMaxPlanesMasking, maxVals[i], result[i]);
+        }
+      }
+    }
+    start = end;
+  }
+  FOR_EACH(retP, result) { assert(NULL != *retP); }
+}
+
 LBPlane &MaxPlanesLowerBound::getBestLBPlane(const belief_vector &b) {
   // cast from 'const LBPlane&' to LBPlane&
   return (LBPlane &)getBestLBPlaneConst(b);
@@ -378,42 +542,57 @@ LBPlane &MaxPlanesLowerBound::getBestLBPlane(const belief_vector &b) {
 // return the alpha such that alpha * b has the highest value
 LBPlane &MaxPlanesLowerBound::getBestLBPlaneWithCache(
     const belief_vector &b, LBPlane *currPlane, int lastSetPlaneNumBackups) {
-  const PlaneSet *planesToCheck;
-  if (useMaxPlanesSupportList) {
-    planesToCheck = &supportList[b.data[0].index];
-  } else {
-    planesToCheck = &planes;
+  if (useMaxPlanesPackedStore) {
+    return *packedPlanes.getBestPlane(b, lastSetPlaneNumBackups, currPlane,
+                                      inner_prod(currPlane->alpha, b));
   }
 
-  double val;
   LBPlane *ret = currPlane;
   double maxval = inner_prod(currPlane->alpha, b);
+  uint64_t bsig = useMaxPlanesMasking ? mask_signature(b) : 0;
 
-  FOR_EACH(pr, *planesToCheck) {
-    LBPlane *al = *pr;
-    if (al->numBackupsAtCreation < lastSetPlaneNumBackups) continue;
-    if (useMaxPlanesMasking) {
-      if (!mask_subset(b, al->mask)) continue;
+  if (useMaxPlanesSupportList) {
+    FOR_EACH(eP, supportList.getList(supportList.getShortestKey(b))) {
+      checkPlane(eP->item, b, bsig, lastSetPlaneNumBackups,
+                 useMaxPlanesMasking, maxval, ret);
     }
-    val = inner_prod(al->alpha, b);
-    if (val > maxval) {
-      maxval = val;
-      ret = al;
+  } else {
+    FOR_EACH(pr, planes) {
+      checkPlane(*pr, b, bsig, lastSetPlaneNumBackups, useMaxPlanesMasking,
+                 maxval, ret);
     }
   }
   return *ret;
 }
 
 void MaxPlanesLowerBound::addLBPlane(LBPlane *av) {
+  av->maskSignature = mask_signature(av->mask);
   planes.push_back(av);
+  if (useMaxPlanesPackedStore) {
+    packedPlanes.addPlane(av);
+  }
 
   if (useMaxPlanesSupportList) {
     // add new plane to supportList
-    FOR_EACH(ai, av->mask.data) { supportList[ai->index].push_back(av); }
+    av->supportPositions.resize(av->mask.filled());
+    FOR(k, av->mask.filled()) {
+      supportList.add(av, av->mask.data[k].index, &av->supportPositions[k]);
+    }
   }
 }
 
+void MaxPlanesLowerBound::mergeLBPlane(LBPlane *av) {
+  // count the plane as new, so that cached best planes get checked
+  // against it
+  av->numBackupsAtCreation = core->numBackups;
+  av->backPointers.clear();
+  addLBPlane(av);
+}
+
 void MaxPlanesLowerBound::prunePlanes(int numBackups) {
+  // the pass in flight holds iterators into planes
+  finishBackgroundPrune(true);
+
   int oldNum = -1;
   int numRefCountDeletions = 0;
   if (zmdpDebugLevelG >= 1) {
@@ -469,33 +648,314 @@ void MaxPlanesLowerBound::prunePlanes(int numBackups) {
              numRefCountDeletions, static_cast<int>(oldNum - planes.size()));
     }
   }
+  if (useMaxPlanesPackedStore) {
+    // the packed store still refers to deleted planes
+    packedPlanes.rebuild(planes);
+  }
   lastPruneNumPlanes = planes.size();
   lastPruneNumBackups = numBackups;
+  countPrune();
+}
+
+// runs the LP pass after every maxPlanesLPPruningInterval prunes
+void MaxPlanesLowerBound::countPrune(void) {
+  numPrunes++;
+  if (maxPlanesLPPruningInterval > 0 &&
+      0 == numPrunes % maxPlanesLPPruningInterval) {
+    prunePlanesLP();
+  }
 }
 
 // prune points and planes if the number has grown significantly
 // since the last check
 void MaxPlanesLowerBound::maybePrune(int numBackups) {
+  if (useMaxPlanesBackgroundPruning && finishBackgroundPrune(false)) {
+    return;
+  }
   unsigned int nextPruneNumPlanes =
       max(lastPruneNumPlanes + PRUNE_PLANES_INCREMENT,
           static_cast<int>(lastPruneNumPlanes * PRUNE_PLANES_FACTOR));
   if (planes.size() > nextPruneNumPlanes) {
-    prunePlanes(numBackups);
+    if (useMaxPlanesBackgroundPruning) {
+      startBackgroundPrune(numBackups);
+    } else {
+      prunePlanes(numBackups);
+    }
+  }
+}
+
+void MaxPlanesLowerBound::startBackgroundPrune(int numBackups) {
+  pruneSnapshot.clear();
+  pruneSnapshotPlanes.clear();
+  for (PlaneSet::iterator pi = planes.begin(); pi != planes.end(); pi++) {
+    pruneSnapshot.push_back(pi);
+    pruneSnapshotPlanes.push_back(*pi);
+  }
+  pruneSnapshotNumBackups = numBackups;
+  pruneDone.store(false);
+  pruneRunning = true;
+  pruneThread = std::thread(&MaxPlanesLowerBound::runBackgroundPrune, this);
+}
+
+// runs in the pruning thread.  only reads the snapshot planes, which
+// the solver thread does not modify or free until the pass is applied.
+void MaxPlanesLowerBound::runBackgroundPrune(void) {
+  const std::vector<const LBPlane *> &snap = pruneSnapshotPlanes;
+  int n = snap.size();
+  pruneDominators.assign(n, std::vector<int>());
+  threadPoolG.parallelFor(n, [&](int i) {
+    const LBPlane *candidate = snap[i];
+    std::vector<int> &dominators = pruneDominators[i];
+    FOR(j, n) {
+      const LBPlane *member = snap[j];
+      if (static_cast<int>(j) == i) {
+        // can't dominate yourself
+      } else if (candidate->numBackupsAtCreation <= lastPruneNumBackups &&
+                 member->numBackupsAtCreation <= lastPruneNumBackups) {
+        // candidate and member were compared the last time we pruned
+        // and neither dominates the other
+      } else if (dominates(member, candidate, useMaxPlanesMasking)) {
+        dominators.push_back(j);
+        if (PRUNE_MAX_DOMINATORS == dominators.size()) break;
+      }
+    }
+  });
+  pruneDone.store(true, std::memory_order_release);
+}
+
+bool MaxPlanesLowerBound::finishBackgroundPrune(bool wait) {
+  if (!pruneRunning) return false;
+  if (!wait && !pruneDone.load(std::memory_order_acquire)) return true;
+  pruneThread.join();
+  pruneRunning = false;
+
+  int oldNum = planes.size();
+  int n = pruneSnapshot.size();
+  // forwardedTo[i] is the snapshot index of the plane that pruned plane
+  // i was forwarded to, -1 if plane i is live or went without one
+  std::vector<bool> pruned(n, false);
+  std::vector<int> forwardedTo(n, -1);
+  FOR(i, n) {
+    LBPlane *candidate = *pruneSnapshot[i];
+    int d = -1;
+    if (useMaxPlanesExtraPruning && candidate->backPointers.empty()) {
+      // no node uses candidate, so it can go without a dominator
+    } else {
+      FOR_EACH(jP, pruneDominators[i]) {
+        // a pruned dominator was forwarded to a plane that dominates
+        // it, which then also dominates candidate.  each plane in the
+        // chain was pruned after the one before it, so the chain ends.
+        int j = *jP;
+        while (pruned[j] && -1 != forwardedTo[j]) {
+          j = forwardedTo[j];
+        }
+        // mutually dominating planes list each other; the one that
+        // comes first is pruned and its chain leads back to the other,
+        // which survives
+        if (!pruned[j] && j != static_cast<int>(i)) {
+          d = j;
+          break;
+        }
+      }
+      if (-1 == d) continue;
+    }
+    deleteAndForward(candidate, (-1 == d) ? NULL : *pruneSnapshot[d]);
+    planes.erase(pruneSnapshot[i]);
+    pruned[i] = true;
+    forwardedTo[i] = d;
+  }
+
+  if (zmdpDebugLevelG >= 1) {
+    cout << "... background pass pruned # planes from " << oldNum
+         << " down to " << planes.size() << endl;
+  }
+  if (useMaxPlanesPackedStore) {
+    packedPlanes.rebuild(planes);
+  }
+  lastPruneNumPlanes = planes.size();
+  // planes stamped with the snapshot's backup count may have been added
+  // after the snapshot was taken, so they are not counted as compared
+  lastPruneNumBackups = pruneSnapshotNumBackups - 1;
+  pruneSnapshot.clear();
+  pruneSnapshotPlanes.clear();
+  pruneDominators.clear();
+  countPrune();
+  return false;
+}
+
+void MaxPlanesLowerBound::prunePlanesLP(void) {
+  finishBackgroundPrune(true);
+
+  timeval startTime;
+  int oldNum = -1;
+  if (zmdpDebugLevelG >= 1) {
+    startTime = getTime();
+    oldNum = planes.size();
+  }
+
+  typeof(planes.begin()) candidateP = planes.begin();
+  std::vector<const LBPlane *> competitors;
+  while (candidateP != planes.end()) {
+    LBPlane *candidate = *candidateP;
+
+    // the competitors are the planes that apply wherever candidate
+    // does.  other planes may apply to some of those beliefs too, so
+    // ignoring them only makes the test more conservative.
+    competitors.clear();
+    FOR_EACH(planeP, planes) {
+      if (*planeP == candidate) continue;
+      if (useMaxPlanesMasking &&
+          (0 != (candidate->maskSignature & ~(*planeP)->maskSignature) ||
+           !mask_subset(candidate->mask, (*planeP)->mask))) {
+        continue;
+      }
+      competitors.push_back(*planeP);
+    }
+
+    const LBPlane *dominator;
+    if (isPlaneUseful(candidate, competitors, &dominator)) {
+      candidateP++;
+      continue;
+    }
+
+    if (useMaxPlanesCache) {
+      // the dominator may be worse than candidate at the beliefs of the
+      // nodes that point to it, so make those nodes check every plane
+      // the next time they are queried
+      FOR_EACH(bpP, candidate->backPointers) {
+        // bestPlane is the first field of MaxPlanesData
+        reinterpret_cast<MaxPlanesData *>(*bpP)->lastSetPlaneNumBackups = -1;
+      }
+    }
+    deleteAndForward(candidate, const_cast<LBPlane *>(dominator));
+    candidateP = eraseElement(planes, candidateP);
   }
+
+  if (zmdpDebugLevelG >= 1) {
+    cout << "... LP pruning reduced # planes from " << oldNum << " to "
+         << planes.size() << " in "
+         << timevalToSeconds(getTime() - startTime) << " seconds" << endl;
+  }
+  if (useMaxPlanesPackedStore) {
+    packedPlanes.rebuild(planes);
+  }
+  lastPruneNumPlanes = planes.size();
+}
+
+// returns true if there is a belief b over the mask of candidate where
+// candidate is better than all the competitors by more than
+// ZMDP_BOUNDS_PRUNE_EPS.  that is, if delta > eps at the optimum of
+//
+//   max delta  s.t.  b'(alpha - alpha_k) >= delta for each competitor k,
+//                    sum(b) = 1,  b >= 0.
+//
+// if not, sets *dominatorP to the competitor that is best at the
+// optimal b.
+bool MaxPlanesLowerBound::isPlaneUseful(
+    const LBPlane *candidate, const std::vector<const LBPlane *> &competitors,
+    const LBPlane **dominatorP) {
+  int numComp = competitors.size();
+  if (0 == numComp) return true;
+
+  // columns of the LP are the states of the mask, plus delta
+  static thread_local std::vector<int> pos;
+  std::vector<int> states;
+  int numStates = pomdp->getBeliefSize();
+  pos.resize(numStates, -1);
+  if (useMaxPlanesMasking) {
+    FOR_CV(candidate->mask) { states.push_back(CV_INDEX(candidate->mask)); }
+  } else {
+    FOR(i, numStates) { states.push_back(i); }
+  }
+  int n = states.size();
+  if (static_cast<double>(numComp + 1) * (n + 2) > PRUNE_LP_MAX_TABLEAU_SIZE) {
+    return true;
+  }
+  FOR(c, n) { pos[states[c]] = c; }
+  std::vector<double> alpha(n, 0.0);
+  FOR_CV(candidate->alpha) {
+    int c = pos[CV_INDEX(candidate->alpha)];
+    if (c >= 0) alpha[c] = CV_VAL(candidate->alpha);
+  }
+
+  // delta is free, so the LP uses delta' = delta + D with D large enough
+  // that delta' >= 0.  substituting D = D * sum(b) gives the rows
+  //   b'(alpha_k - alpha - D) + delta' <= 0,  sum(b) <= 1
+  // which all have a feasible origin.
+  SimplexLP lp;
+  lp.init(numComp + 1, n + 1);
+  double D = 0.0;
+  FOR(k, numComp) {
+    FOR(c, n) { lp.A(k, c) = -alpha[c]; }
+    const alpha_vector &ak = competitors[k]->alpha;
+    FOR_CV(ak) {
+      int c = pos[CV_INDEX(ak)];
+      if (c >= 0) lp.A(k, c) += CV_VAL(ak);
+    }
+    FOR(c, n) { D = std::max(D, lp.A(k, c)); }
+    lp.A(k, n) = 1.0;
+  }
+
+  // cheap check first: if candidate beats every competitor at one of
+  // the corners of its mask, no LP is needed
+  std::vector<double> maxDiff(n, -99e+20);
+  FOR(k, numComp) {
+    FOR(c, n) { maxDiff[c] = std::max(maxDiff[c], lp.A(k, c)); }
+  }
+  FOR(c, n) {
+    if (maxDiff[c] < -ZMDP_BOUNDS_PRUNE_EPS) {
+      FOR(c2, n) { pos[states[c2]] = -1; }
+      return true;
+    }
+  }
+
+  // the rows are relaxed by distinct tiny amounts.  otherwise every row
+  // but the last is tight at the origin and the simplex method makes a
+  // very long run of degenerate pivots.  relaxing can only raise the
+  // optimum, and by at most PRUNE_LP_PERTURBATION, so planes are pruned
+  // if their advantage is at most ZMDP_BOUNDS_PRUNE_EPS plus that.
+  D += 1.0;
+  FOR(k, numComp) {
+    FOR(c, n) { lp.A(k, c) -= D; }
+    lp.b(k) = PRUNE_LP_PERTURBATION * (k + 1) / numComp;
+  }
+  FOR(c, n) { lp.A(numComp, c) = 1.0; }
+  lp.b(numComp) = 1.0;
+  lp.setObjective(n, 1.0);
+
+  double threshold = D + ZMDP_BOUNDS_PRUNE_EPS + PRUNE_LP_PERTURBATION;
+  SimplexResult result = lp.solve(threshold);
+  bool useful = (SIMPLEX_OPTIMAL != result || lp.getObjective() > threshold);
+
+  if (!useful) {
+    std::vector<double> x;
+    lp.getSolution(x);
+    double maxVal = -99e+20;
+    FOR(k, numComp) {
+      const alpha_vector &ak = competitors[k]->alpha;
+      double val = 0.0;
+      FOR_CV(ak) {
+        int c = pos[CV_INDEX(ak)];
+        if (c >= 0) val += CV_VAL(ak) * x[c];
+      }
+      if (val > maxVal) {
+        maxVal = val;
+        *dominatorP = competitors[k];
+      }
+    }
+  }
+
+  FOR(c, n) { pos[states[c]] = -1; }
+  return useful;
 }
 
 void MaxPlanesLowerBound::deleteAndForward(LBPlane *victim,
                                            LBPlane *dominator) {
   if (useMaxPlanesSupportList) {
     // remove victim from supportList
-    FOR_EACH(ai, victim->mask.data) {
-      PlaneSet &pi = supportList[ai->index];
-      FOR_EACH(eltP, pi) {
-        if (victim == *eltP) {
-          eraseElement(pi, eltP);
-          break;
-        }
-      }
+    FOR(k, victim->mask.filled()) {
+      supportList.remove(victim->mask.data[k].index,
+                         &victim->supportPositions[k]);
     }
   }
   if (useMaxPlanesCache) {
@@ -551,24 +1011,24 @@ void MaxPlanesLowerBound::writeToFile(const std::string &outFileName) const {
          "label\n"
          "# for that plane is the action that achieves the bound.\n"
          "\n";
-  out << "{" << endl;
-  out << "  policyType => \"MaxPlanesLowerBound\"," << endl;
-  out << "  numPlanes => " << planes.size() << "," << endl;
-  out << "  planes => [" << endl;
+  out << "{\n";
+  out << "  policyType => \"MaxPlanesLowerBound\",\n";
+  out << "  numPlanes => " << planes.size() << ",\n";
+  out << "  planes => [\n";
 
   PlaneSet::const_iterator pi = planes.begin();
   FOR(i, planes.size() - 1) {
-    (*pi)->write(out, useMaxPlanesMasking);
-    out << "," << endl;
+    (*pi)->write(out, useMaxPlanesMasking, *pomdp);
+    out << ",\n";
     pi++;
   }
   if (planes.size() > 0) {
-    (*pi)->write(out, useMaxPlanesMasking);
+    (*pi)->write(out, useMaxPlanesMasking, *pomdp);
   }
-  out << endl;
+  out << "\n";
 
-  out << "  ]" << endl;
-  out << "}" << endl;
+  out << "  ]\n";
+  out << "}\n";
 
   out.close();
 }
@@ -627,6 +1087,13 @@ void MaxPlanesLowerBound::readFromFile(const std::string &inFileName) {
         /* at the start of a plane, read the action */
         if (string::npos != s.find("action") &&
             (1 == sscanf(s.c_str(), "action => %d", &plane.action))) {
+          int a = pomdp->getCompactActionId(plane.action);
+          if (-1 == a) {
+            fprintf(stderr, "ERROR: %s: line %d: invalid action %d\n",
+                    inFileName.c_str(), lnum, plane.action);
+            exit(EXIT_FAILURE);
+          }
+          plane.action = a;
           plane.alpha.resize(pomdp->numStates);
           parseState = 2;
         } else {
@@ -645,8 +1112,12 @@ void MaxPlanesLowerBound::readFromFile(const std::string &inFileName) {
           parseState = 1;
           goto parseLineAgain;
         } else if (2 == sscanf(s.c_str(), "%d, %lf", &entryIndex, &entryVal)) {
-          /* push another entry into the plane */
-          plane.alpha.push_back(entryIndex, entryVal);
+          /* push another entry into the plane, dropping entries for
+             states removed by compactReachableStates */
+          int i = pomdp->getCompactStateId(entryIndex);
+          if (-1 != i) {
+            plane.alpha.push_back(i, entryVal);
+          }
         } else {
           printf("s=[%s]\n", s.c_str());
           fprintf(stderr,
@@ -675,6 +1146,261 @@ void MaxPlanesLowerBound::readFromFile(const std::string &inFileName) {
   initialized = true;
 }
 
+void MaxPlanesLowerBound::writeToBinaryFile(
+    const std::string &outFileName) const {
+  FILE *out = fopen(outFileName.c_str(), "wb");
+  if (NULL == out) {
+    fprintf(stderr,
+            "ERROR: MaxPlanesLowerBound::writeToBinaryFile: couldn't open %s "
+            "for writing: %s\n",
+            outFileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+  // planes have the same entries as in the text format: the entries of
+  // the mask with masking, otherwise every state.  indices are state
+  // ids in the model file.
+  int numStates = pomdp->numStates;
+  std::vector<MaxPlanesBinaryPlane> table;
+  table.reserve(planes.size());
+  uint64_t numEntries = 0;
+  FOR_EACH(planeP, planes) {
+    const LBPlane &p = **planeP;
+    MaxPlanesBinaryPlane bp;
+    bp.action = pomdp->getOriginalActionId(p.action);
+    bp.numEntries = useMaxPlanesMasking ? p.mask.filled() : numStates;
+    bp.entryStart = numEntries;
+    table.push_back(bp);
+    numEntries += bp.numEntries;
+  }
+
+  MaxPlanesBinaryHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAXPLANES_BINARY_MAGIC, sizeof(header.magic));
+  header.version = MAXPLANES_BINARY_VERSION;
+  header.numStates = pomdp->getNumOriginalStates();
+  header.numPlanes = planes.size();
+  header.numEntries = numEntries;
+  fwrite(&header, sizeof(header), 1, out);
+  if (!table.empty()) {
+    fwrite(&table[0], sizeof(MaxPlanesBinaryPlane), table.size(), out);
+  }
+
+  // indices
+  std::vector<uint32_t> indices;
+  FOR_EACH(planeP, planes) {
+    const LBPlane &p = **planeP;
+    indices.clear();
+    if (useMaxPlanesMasking) {
+      FOR_EACH(mi, p.mask.data.indices) {
+        indices.push_back(pomdp->getOriginalStateId(*mi));
+      }
+    } else {
+      FOR(i, numStates) { indices.push_back(pomdp->getOriginalStateId(i)); }
+    }
+    if (!indices.empty()) {
+      fwrite(&indices[0], sizeof(uint32_t), indices.size(), out);
+    }
+  }
+  if (numEntries % 2 != 0) {
+    uint32_t pad = 0;
+    fwrite(&pad, sizeof(pad), 1, out);
+  }
+
+  // values; the alpha vector's entries are walked alongside the mask,
+  // since alpha(i) would search for each one
+  std::vector<double> values;
+  FOR_EACH(planeP, planes) {
+    const LBPlane &p = **planeP;
+    const std::vector<unsigned int> &ai = p.alpha.data.indices;
+    const std::vector<alpha_vector::value_type> &av = p.alpha.data.values;
+    size_t k = 0;
+    values.clear();
+    if (useMaxPlanesMasking) {
+      FOR_EACH(mi, p.mask.data.indices) {
+        while (k < ai.size() && ai[k] < *mi) k++;
+        values.push_back((k < ai.size() && ai[k] == *mi)
+                             ? static_cast<double>(av[k])
+                             : 0.0);
+      }
+    } else {
+      FOR(i, numStates) {
+        if (k < ai.size() && ai[k] == (unsigned int)i) {
+          values.push_back(static_cast<double>(av[k++]));
+        } else {
+          values.push_back(0.0);
+        }
+      }
+    }
+    if (!values.empty()) {
+      fwrite(&values[0], sizeof(double), values.size(), out);
+    }
+  }
+
+  if (ferror(out) || 0 != fclose(out)) {
+    fprintf(stderr,
+            "ERROR: MaxPlanesLowerBound::writeToBinaryFile: error writing %s: "
+            "%s\n",
+            outFileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+}
+
+bool MaxPlanesLowerBound::isBinaryFile(const std::string &fileName) {
+  char magic[8];
+  FILE *in = fopen(fileName.c_str(), "rb");
+  if (NULL == in) return false;
+  bool result = (1 == fread(magic, sizeof(magic), 1, in) &&
+                 0 == memcmp(magic, MAXPLANES_BINARY_MAGIC, sizeof(magic)));
+  fclose(in);
+  return result;
+}
+
+void MaxPlanesLowerBound::writePolicyFile(const std::string &outFileName,
+                                          bool binary) const {
+  std::string tmpFileName = outFileName + ".tmp";
+  if (binary) {
+    writeToBinaryFile(tmpFileName);
+  } else {
+    writeToFile(tmpFileName);
+  }
+  if (0 != rename(tmpFileName.c_str(), outFileName.c_str())) {
+    fprintf(stderr, "ERROR: couldn't rename %s to %s: %s\n",
+            tmpFileName.c_str(), outFileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+}
+
+void MaxPlanesLowerBound::readFromBinaryFile(const std::string &inFileName) {
+  const char *fname = inFileName.c_str();
+  int fd = open(fname, O_RDONLY);
+  if (-1 == fd) {
+    fprintf(stderr, "ERROR: couldn't open %s for reading: %s\n", fname,
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  struct stat st;
+  if (0 != fstat(fd, &st)) {
+    fprintf(stderr, "ERROR: couldn't stat %s: %s\n", fname, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  size_t fileSize = st.st_size;
+  if (fileSize < sizeof(MaxPlanesBinaryHeader)) {
+    fprintf(stderr, "ERROR: %s: file is too short to be a binary policy\n",
+            fname);
+    exit(EXIT_FAILURE);
+  }
+  // the planes below are built straight from the mapped arrays, without
+  // an intermediate read buffer or any parsing
+  void *mapped = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == mapped) {
+    fprintf(stderr, "ERROR: couldn't mmap %s: %s\n", fname, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+  madvise(mapped, fileSize, MADV_SEQUENTIAL);
+  const char *base = reinterpret_cast<const char *>(mapped);
+
+  const MaxPlanesBinaryHeader &header =
+      *reinterpret_cast<const MaxPlanesBinaryHeader *>(base);
+  if (0 != memcmp(header.magic, MAXPLANES_BINARY_MAGIC,
+                  sizeof(header.magic))) {
+    fprintf(stderr, "ERROR: %s: not a binary MaxPlanesLowerBound policy\n",
+            fname);
+    exit(EXIT_FAILURE);
+  }
+  if (MAXPLANES_BINARY_VERSION != header.version) {
+    fprintf(stderr,
+            "ERROR: %s: unsupported binary policy version %u (expected %d; "
+            "was the file written on a machine with a different byte "
+            "order?)\n",
+            fname, header.version, MAXPLANES_BINARY_VERSION);
+    exit(EXIT_FAILURE);
+  }
+  if ((int)header.numStates != pomdp->getNumOriginalStates()) {
+    fprintf(stderr,
+            "ERROR: %s: policy has %u states but the model has %d states\n",
+            fname, header.numStates, pomdp->getNumOriginalStates());
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t numPlanes = header.numPlanes;
+  uint64_t numEntries = header.numEntries;
+  size_t tableOffset = sizeof(MaxPlanesBinaryHeader);
+  size_t indicesOffset = tableOffset + numPlanes * sizeof(MaxPlanesBinaryPlane);
+  size_t valuesOffset =
+      indicesOffset + ((numEntries + 1) / 2) * 2 * sizeof(uint32_t);
+  if (numPlanes > fileSize || numEntries > fileSize ||
+      valuesOffset + numEntries * sizeof(double) != fileSize) {
+    fprintf(stderr, "ERROR: %s: file size does not match its header\n",
+            fname);
+    exit(EXIT_FAILURE);
+  }
+  const MaxPlanesBinaryPlane *table =
+      reinterpret_cast<const MaxPlanesBinaryPlane *>(base + tableOffset);
+  const uint32_t *indices =
+      reinterpret_cast<const uint32_t *>(base + indicesOffset);
+  const double *values = reinterpret_cast<const double *>(base + valuesOffset);
+
+  FOR(p, numPlanes) {
+    const MaxPlanesBinaryPlane &bp = table[p];
+    if (bp.entryStart > numEntries ||
+        bp.numEntries > numEntries - bp.entryStart) {
+      fprintf(stderr, "ERROR: %s: plane %d: entries out of range\n", fname,
+              (int)p);
+      exit(EXIT_FAILURE);
+    }
+    int a = pomdp->getCompactActionId(bp.action);
+    if (-1 == a) {
+      fprintf(stderr, "ERROR: %s: plane %d: invalid action %d\n", fname,
+              (int)p, bp.action);
+      exit(EXIT_FAILURE);
+    }
+    const uint32_t *pi = indices + bp.entryStart;
+    const double *pv = values + bp.entryStart;
+    FOR(k, bp.numEntries) {
+      if (pi[k] >= header.numStates || (k > 0 && pi[k] <= pi[k - 1])) {
+        fprintf(stderr,
+                "ERROR: %s: plane %d: entry indices must be increasing and "
+                "less than the number of states\n",
+                fname, (int)p);
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    LBPlane *plane = new LBPlane();
+    plane->action = a;
+    plane->numBackupsAtCreation = -1;
+    plane->alpha.resize(pomdp->numStates);
+    plane->mask.resize(pomdp->numStates);
+    if (pomdp->compactStateIds.empty()) {
+      plane->alpha.data.indices.assign(pi, pi + bp.numEntries);
+      plane->alpha.data.values.assign(pv, pv + bp.numEntries);
+    } else {
+      // map to the compacted model's states, dropping the others
+      FOR(k, bp.numEntries) {
+        int i = pomdp->compactStateIds[pi[k]];
+        if (-1 != i) {
+          plane->alpha.data.indices.push_back(i);
+          plane->alpha.data.values.push_back(pv[k]);
+        }
+      }
+    }
+    plane->mask.data.indices = plane->alpha.data.indices;
+    plane->mask.data.values.assign(plane->alpha.data.indices.size(), 1.0);
+    addLBPlane(plane);
+  }
+
+  munmap(mapped, fileSize);
+
+  // the set of planes should have been pruned before it was written out
+  lastPruneNumPlanes = planes.size();
+  lastPruneNumBackups = -1;
+
+  initialized = true;
+}
+
 void MaxPlanesLowerBound::readFromCassandraAlphaFile(
     const std::string &inFileName) {
   ifstream inFile(inFileName.c_str());
@@ -692,12 +1418,21 @@ void MaxPlanesLowerBound::readFromCassandraAlphaFile(
   plane.numBackupsAtCreation = -1;
 
   while (!inFile.eof()) {
-    inFile >> plane.action;
+    int a;
+    inFile >> a;
+    plane.action = pomdp->getCompactActionId(a);
+    if (inFile && -1 == plane.action) {
+      cerr << "ERROR: " << inFileName << ": invalid action " << a << endl;
+      exit(EXIT_FAILURE);
+    }
     plane.alpha.clear();
     plane.alpha.resize(pomdp->numStates);
-    for (int i = 0; i < pomdp->numStates; i++) {
+    for (int i = 0; i < pomdp->getNumOriginalStates(); i++) {
       inFile >> val;
-      plane.alpha.push_back(i, val);
+      int s = pomdp->getCompactStateId(i);
+      if (-1 != s) {
+        plane.alpha.push_back(s, val);
+      }
     }
     addLBPlane(new LBPlane(plane));
   }
@@ -730,6 +1465,10 @@ int MaxPlanesLowerBound::getStorage(int whichMetric) const {
       return entryCount;
     }
 
+    case ZMDP_S_NUM_INDEX_ENTRIES:
+      // return total length of the support list posting lists
+      return supportList.numEntries;
+
     default:
       /* N/A */
       return 0;
@@ -24,14 +24,20 @@
 
 // this causes problems if it is included after the Lapack headers, so
 //  pre-emptively include it here.  not sure exactly what the problem is.
+#include <stdint.h>
+
+#include <atomic>
 #include <iostream>
 #include <list>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "BoundPairCore.h"
 #include "IncrementalLowerBound.h"
+#include "PackedPlaneStore.h"
 #include "Pomdp.h"
+#include "SupportIndex.h"
 #include "sla_mask.h"
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
@@ -47,16 +53,53 @@ struct LBPlane {
   alpha_vector alpha;
   int action;
   sla::mvector mask;
+  // mask_signature(mask); set when the plane is added to the bound
+  uint64_t maskSignature;
   int numBackupsAtCreation;
   std::list<LBPlane **> backPointers;
+  // positions of the plane in the supportList posting lists, one per
+  // mask entry
+  std::vector<int> supportPositions;
 
   LBPlane(void);
   LBPlane(const alpha_vector &_alpha, int _action, const sla::mvector &_mask);
-  void write(std::ostream &out, bool useMaxPlanesMasking) const;
+  // writes entries with the state ids of the model file
+  void write(std::ostream &out, bool useMaxPlanesMasking,
+             const MDP &model) const;
 };
 
 typedef std::list<LBPlane *> PlaneSet;
 
+// Binary policy format (policyType maxPlanesBinary).  The file is laid
+// out as:
+//   MaxPlanesBinaryHeader
+//   numPlanes x MaxPlanesBinaryPlane  (the plane table)
+//   numEntries x uint32_t             (entry indices, padded to 8 bytes)
+//   numEntries x double               (entry values)
+// Plane p's mask is indices[entryStart .. entryStart + numEntries - 1],
+// and its alpha vector has the corresponding values.  All fields are in
+// native byte order; a file written on a machine with the other byte
+// order fails the version check.
+#define MAXPLANES_BINARY_MAGIC "ZMDPMPLB"
+#define MAXPLANES_BINARY_VERSION (1)
+
+struct MaxPlanesBinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t numStates;
+  uint64_t numPlanes;
+  uint64_t numEntries;
+};
+
+struct MaxPlanesBinaryPlane {
+  int32_t action;
+  uint32_t numEntries;
+  uint64_t entryStart;
+};
+
+// called with each plane that update() adds
+typedef void (*NewLBPlaneHandler)(const LBPlane &plane, void *handlerData);
+
 struct MaxPlanesLowerBound : public IncrementalLowerBound {
   const Pomdp *pomdp;
   const ZMDPConfig *config;
@@ -64,12 +107,35 @@ struct MaxPlanesLowerBound : public IncrementalLowerBound {
   PlaneSet planes;
   int lastPruneNumPlanes;
   int lastPruneNumBackups;
-  std::vector<PlaneSet> supportList;
+  // supportList.getList(i) holds the planes whose mask includes i
+  SupportIndex<LBPlane *> supportList;
   bool useMaxPlanesMasking;
   bool useMaxPlanesSupportList;
   bool useMaxPlanesCache;
   bool useMaxPlanesExtraPruning;
+  bool useMaxPlanesPackedStore;
+  PackedPlaneStore packedPlanes;
+  bool useMaxPlanesBackgroundPruning;
+  bool useMaxPlanesLPPruning;
+  int maxPlanesLPPruningInterval;
+  int numPrunes;
   bool initialized;
+  NewLBPlaneHandler newPlaneHandler;
+  void *newPlaneHandlerData;
+
+  // background pruning pass.  the pass compares the planes of a
+  // snapshot and records, for each one, a few of the snapshot planes
+  // that dominate it.  the solver thread applies the result the next
+  // time it calls maybePrune() after the pass finishes; planes are only
+  // freed there (or in prunePlanes()), so the pass never sees a freed
+  // plane.
+  std::thread pruneThread;
+  bool pruneRunning;
+  std::atomic<bool> pruneDone;
+  int pruneSnapshotNumBackups;
+  std::vector<PlaneSet::iterator> pruneSnapshot;
+  std::vector<const LBPlane *> pruneSnapshotPlanes;
+  std::vector<std::vector<int> > pruneDominators;
 
   MaxPlanesLowerBound(const MDP *_pomdp, const ZMDPConfig *_config);
   ~MaxPlanesLowerBound(void);
@@ -77,7 +143,10 @@ struct MaxPlanesLowerBound : public IncrementalLowerBound {
   void initialize(double targetPrecision);
   double getValue(const belief_vector &b, const MDPNode *cn) const;
   void initNodeBound(MDPNode &cn);
+  void initNodeBounds(const std::vector<MDPNode *> &nodes);
   void update(MDPNode &cn);
+  void *prepareUpdate(MDPNode &cn);
+  void commitUpdate(MDPNode &cn, void *prepared);
   int chooseAction(const state_vector &b);
 
   void getNewLBPlaneQ(LBPlane &result, MDPNode &cn, int a);
@@ -88,15 +157,39 @@ struct MaxPlanesLowerBound : public IncrementalLowerBound {
 
   LBPlane &getBestLBPlane(const belief_vector &b);
   const LBPlane &getBestLBPlaneConst(const belief_vector &b) const;
+  void getBestLBPlanes(std::vector<LBPlane *> &result,
+                       const std::vector<const belief_vector *> &beliefs);
   LBPlane &getBestLBPlaneWithCache(const belief_vector &b, LBPlane *currPlane,
                                    int lastSetPlaneNumBackups);
   void addLBPlane(LBPlane *av);
+  // adds a plane that was generated elsewhere (e.g. by another bound
+  // working on the same problem) and takes ownership of it
+  void mergeLBPlane(LBPlane *av);
   void prunePlanes(int numBackups);
   void maybePrune(int numBackups);
   void deleteAndForward(LBPlane *victim, LBPlane *dominator);
+  void startBackgroundPrune(int numBackups);
+  void runBackgroundPrune(void);
+  // applies the result of the background pass if it has finished (or
+  // after waiting for it if wait is true).  returns true if a pass is
+  // still running.
+  bool finishBackgroundPrune(bool wait);
+  // removes planes that are not the unique maximum at any belief where
+  // they apply (solving one LP per plane)
+  void prunePlanesLP(void);
+  bool isPlaneUseful(const LBPlane *candidate,
+                     const std::vector<const LBPlane *> &competitors,
+                     const LBPlane **dominatorP);
+  void countPrune(void);
 
   void writeToFile(const std::string &outFileName) const;
   void readFromFile(const std::string &inFileName);
+  void writeToBinaryFile(const std::string &outFileName) const;
+  void readFromBinaryFile(const std::string &inFileName);
+  static bool isBinaryFile(const std::string &fileName);
+  // writes in binary or text format to a temporary file and renames it
+  // into place, so that an interrupted write never clobbers the file
+  void writePolicyFile(const std::string &outFileName, bool binary) const;
   void readFromCassandraAlphaFile(const std::string &inFileName);
   int getStorage(int whichMetric) const;
 };
@@ -0,0 +1,264 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include "PackedPlaneStore.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "MaxPlanesLowerBound.h"
+
+using namespace std;
+using namespace sla;
+
+namespace zmdp {
+
+/**********************************************************************
+ * PACKED PLANE BLOCK
+ **********************************************************************/
+
+PackedPlaneBlock::PackedPlaneBlock(bool _isDense, int numStates)
+    : isDense(_isDense),
+      numPlanes(0),
+      maxNumBackupsAtCreation(INT_MIN),
+      denseVals(NULL) {
+  rowStarts[0] = 0;
+  if (isDense) {
+    size_t numBytes = static_cast<size_t>(numStates) *
+                      PACKED_PLANES_PER_BLOCK * sizeof(double);
+    if (0 != posix_memalign(reinterpret_cast<void **>(&denseVals), 64,
+                            numBytes)) {
+      fprintf(stderr, "ERROR: PackedPlaneBlock: out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    memset(denseVals, 0, numBytes);
+  }
+}
+
+PackedPlaneBlock::~PackedPlaneBlock(void) { free(denseVals); }
+
+void PackedPlaneBlock::getScores(double *scores, const belief_vector &b,
+                                 const double *bvals,
+                                 const unsigned char *bmark,
+                                 uint64_t bsig, bool useMasking) const {
+  if (isDense) {
+    // dense planes apply to every belief; accumulate one belief entry at
+    // a time across all planes
+    FOR(p, numPlanes) { scores[p] = 0.0; }
+    FOR_CV(b) {
+      const double *col = denseVals + CV_INDEX(b) * PACKED_PLANES_PER_BLOCK;
+      double v = CV_VAL(b);
+      FOR(p, numPlanes) { scores[p] += v * col[p]; }
+    }
+    return;
+  }
+
+  unsigned int bmin = b.data.front().index;
+  unsigned int bmax = b.data.back().index;
+  unsigned int bfilled = b.filled();
+  FOR(p, numPlanes) {
+    if (useMasking && (minIndex[p] > bmin || maxIndex[p] < bmax ||
+                       0 != (bsig & ~maskSignatures[p]))) {
+      scores[p] = -99e+20;
+      continue;
+    }
+    const unsigned int *ip = indices.data() + rowStarts[p];
+    const unsigned int *iend = indices.data() + rowStarts[p + 1];
+    const double *vp = values.data() + rowStarts[p];
+    double dot = 0.0;
+    unsigned int hits = 0;
+    for (; ip != iend; ip++, vp++) {
+      dot += (*vp) * bvals[*ip];
+      hits += bmark[*ip];
+    }
+    // the plane is applicable if its mask covers every entry of b
+    scores[p] = (useMasking && hits != bfilled) ? -99e+20 : dot;
+  }
+}
+
+/**********************************************************************
+ * PACKED PLANE STORE
+ **********************************************************************/
+
+PackedPlaneStore::PackedPlaneStore(void)
+    : numStates(0), useMasking(false), denseTail(NULL), sparseTail(NULL) {}
+
+PackedPlaneStore::~PackedPlaneStore(void) { clear(); }
+
+void PackedPlaneStore::init(int _numStates, bool _useMasking) {
+  clear();
+  numStates = _numStates;
+  useMasking = _useMasking;
+}
+
+void PackedPlaneStore::clear(void) {
+  FOR_EACH(blockP, blocks) { delete *blockP; }
+  blocks.clear();
+  denseTail = NULL;
+  sparseTail = NULL;
+}
+
+void PackedPlaneStore::addPlane(LBPlane *plane) {
+  bool isDense;
+  if (useMasking) {
+    isDense = (static_cast<int>(plane->mask.filled()) == numStates);
+  } else {
+    isDense = (static_cast<int>(plane->alpha.filled()) == numStates);
+  }
+
+  PackedPlaneBlock *&tail = isDense ? denseTail : sparseTail;
+  if (NULL == tail || PACKED_PLANES_PER_BLOCK == tail->numPlanes) {
+    tail = new PackedPlaneBlock(isDense, numStates);
+    blocks.push_back(tail);
+  }
+  PackedPlaneBlock &blk = *tail;
+  int p = blk.numPlanes;
+
+  if (isDense) {
+    FOR_CV(plane->alpha) {
+      blk.denseVals[CV_INDEX(plane->alpha) * PACKED_PLANES_PER_BLOCK + p] =
+          CV_VAL(plane->alpha);
+    }
+  } else if (useMasking) {
+    // one entry per mask entry; masked alpha vectors have no entries
+    // outside their mask, so walking both in order fills in the values
+    const alpha_vector &al = plane->alpha;
+    typeof(al.data.begin()) ai = al.data.begin(), aend = al.data.end();
+    FOR_CV(plane->mask) {
+      unsigned int i = CV_INDEX(plane->mask);
+      while (ai != aend && ai->index < i) ai++;
+      blk.indices.push_back(i);
+      blk.values.push_back((ai != aend && ai->index == i) ? ai->value : 0.0);
+    }
+    blk.minIndex[p] = plane->mask.data.front().index;
+    blk.maxIndex[p] = plane->mask.data.back().index;
+    blk.maskSignatures[p] = mask_signature(plane->mask);
+  } else {
+    FOR_CV(plane->alpha) {
+      blk.indices.push_back(CV_INDEX(plane->alpha));
+      blk.values.push_back(CV_VAL(plane->alpha));
+    }
+  }
+
+  blk.rowStarts[p + 1] = blk.indices.size();
+  blk.planes[p] = plane;
+  blk.numBackupsAtCreation[p] = plane->numBackupsAtCreation;
+  blk.maxNumBackupsAtCreation =
+      std::max(blk.maxNumBackupsAtCreation, plane->numBackupsAtCreation);
+  blk.numPlanes++;
+}
+
+void PackedPlaneStore::rebuild(const std::list<LBPlane *> &planes) {
+  clear();
+  FOR_EACH(planeP, planes) { addPlane(*planeP); }
+}
+
+LBPlane *PackedPlaneStore::getBestPlane(const belief_vector &b,
+                                        int minNumBackupsAtCreation,
+                                        LBPlane *currPlane,
+                                        double maxVal) const {
+  // scatter b into dense scratch arrays.  they are per-thread so that
+  // queries can run concurrently; entries are always left at zero.
+  static thread_local std::vector<double> bvals;
+  static thread_local std::vector<unsigned char> bmark;
+  if (bvals.size() < static_cast<size_t>(numStates)) {
+    bvals.resize(numStates, 0.0);
+    bmark.resize(numStates, 0);
+  }
+  FOR_CV(b) {
+    bvals[CV_INDEX(b)] = CV_VAL(b);
+    bmark[CV_INDEX(b)] = 1;
+  }
+  uint64_t bsig = useMasking ? mask_signature(b) : 0;
+
+  LBPlane *ret = currPlane;
+  double scores[PACKED_PLANES_PER_BLOCK];
+  FOR_EACH(blockP, blocks) {
+    const PackedPlaneBlock &blk = **blockP;
+    if (blk.maxNumBackupsAtCreation < minNumBackupsAtCreation) continue;
+
+    blk.getScores(scores, b, &bvals[0], &bmark[0], bsig, useMasking);
+    FOR(p, blk.numPlanes) {
+      if (blk.numBackupsAtCreation[p] < minNumBackupsAtCreation) continue;
+      if (scores[p] > maxVal) {
+        maxVal = scores[p];
+        ret = blk.planes[p];
+      }
+    }
+  }
+
+  // restore the scratch arrays
+  FOR_CV(b) {
+    bvals[CV_INDEX(b)] = 0.0;
+    bmark[CV_INDEX(b)] = 0;
+  }
+
+  return ret;
+}
+
+void PackedPlaneStore::getBestPlanes(
+    std::vector<LBPlane *> &result,
+    const std::vector<const belief_vector *> &beliefs) const {
+  static thread_local std::vector<double> bvals;
+  static thread_local std::vector<unsigned char> bmark;
+  if (bvals.size() < static_cast<size_t>(numStates)) {
+    bvals.resize(numStates, 0.0);
+    bmark.resize(numStates, 0);
+  }
+
+  int n = beliefs.size();
+  result.assign(n, NULL);
+  std::vector<double> maxVals(n, -99e+20);
+  std::vector<uint64_t> bsigs(n, 0);
+  if (useMasking) {
+    FOR(i, n) { bsigs[i] = mask_signature(*beliefs[i]); }
+  }
+  double scores[PACKED_PLANES_PER_BLOCK];
+  FOR_EACH(blockP, blocks) {
+    const PackedPlaneBlock &blk = **blockP;
+    FOR(i, n) {
+      const belief_vector &b = *beliefs[i];
+      FOR_CV(b) {
+        bvals[CV_INDEX(b)] = CV_VAL(b);
+        bmark[CV_INDEX(b)] = 1;
+      }
+      blk.getScores(scores, b, &bvals[0], &bmark[0], bsigs[i], useMasking);
+      FOR(p, blk.numPlanes) {
+        if (scores[p] > maxVals[i]) {
+          maxVals[i] = scores[p];
+          result[i] = blk.planes[p];
+        }
+      }
+      FOR_CV(b) {
+        bvals[CV_INDEX(b)] = 0.0;
+        bmark[CV_INDEX(b)] = 0;
+      }
+    }
+  }
+}
+
+};  // namespace zmdp
@@ -0,0 +1,108 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_POMDPBOUNDS_PACKEDPLANESTORE_H_
+#define ZMDP_SRC_POMDPBOUNDS_PACKEDPLANESTORE_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <vector>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+
+// number of planes in each block of the packed store
+#define PACKED_PLANES_PER_BLOCK (64)
+
+namespace zmdp {
+
+struct LBPlane;
+
+// A block of up to PACKED_PLANES_PER_BLOCK planes stored in contiguous
+// arrays.  Dense blocks hold planes whose mask covers every state; they
+// are stored column-major so that each belief entry updates the scores
+// of all planes in the block with one unit-stride pass.  Sparse blocks
+// hold the other planes in compressed-row form.
+struct PackedPlaneBlock {
+  bool isDense;
+  int numPlanes;
+  LBPlane *planes[PACKED_PLANES_PER_BLOCK];
+  int numBackupsAtCreation[PACKED_PLANES_PER_BLOCK];
+  int maxNumBackupsAtCreation;
+
+  // dense blocks: the value for state i in plane p is
+  //   denseVals[i * PACKED_PLANES_PER_BLOCK + p] (64-byte aligned)
+  double *denseVals;
+
+  // sparse blocks: plane p has entries rowStarts[p] .. rowStarts[p+1]-1 of
+  //   indices/values.  with masking these are the entries of the plane's
+  //   mask, and [minIndex, maxIndex] is the range of the mask.
+  unsigned int rowStarts[PACKED_PLANES_PER_BLOCK + 1];
+  std::vector<unsigned int> indices;
+  std::vector<double> values;
+  unsigned int minIndex[PACKED_PLANES_PER_BLOCK];
+  unsigned int maxIndex[PACKED_PLANES_PER_BLOCK];
+  // mask_signature() of each plane's mask (sparse blocks with masking)
+  uint64_t maskSignatures[PACKED_PLANES_PER_BLOCK];
+
+  PackedPlaneBlock(bool _isDense, int numStates);
+  ~PackedPlaneBlock(void);
+
+  // sets scores[p] to the inner product of plane p with the belief, or
+  // to -99e+20 if the plane is not applicable.  bvals and bmark are the
+  // belief scattered into dense arrays and bsig is mask_signature(b).
+  void getScores(double *scores, const belief_vector &b, const double *bvals,
+                 const unsigned char *bmark, uint64_t bsig,
+                 bool useMasking) const;
+};
+
+// Alternative to iterating over a PlaneSet when answering best-plane
+// queries for MaxPlanesLowerBound.  The LBPlane objects remain the
+// primary representation (pruning, back-pointers and file output use
+// them); this store holds a packed copy of their values and must be
+// rebuilt whenever planes are deleted.
+struct PackedPlaneStore {
+  int numStates;
+  bool useMasking;
+  std::vector<PackedPlaneBlock *> blocks;
+  PackedPlaneBlock *denseTail;
+  PackedPlaneBlock *sparseTail;
+
+  PackedPlaneStore(void);
+  ~PackedPlaneStore(void);
+
+  void init(int _numStates, bool _useMasking);
+  void clear(void);
+  void addPlane(LBPlane *plane);
+  void rebuild(const std::list<LBPlane *> &planes);
+
+  // returns the applicable plane with numBackupsAtCreation >=
+  // minNumBackupsAtCreation that has the highest inner product with b,
+  // if that value is greater than maxVal; otherwise returns currPlane.
+  LBPlane *getBestPlane(const belief_vector &b, int minNumBackupsAtCreation,
+                        LBPlane *currPlane, double maxVal) const;
+
+  // result[i] = getBestPlane(*beliefs[i], INT_MIN, NULL, -99e+20), with
+  // the blocks in the outer loop so each is read once for all beliefs
+  void getBestPlanes(std::vector<LBPlane *> &result,
+                     const std::vector<const belief_vector *> &beliefs) const;
+};
+
+};  // namespace zmdp
+
+#endif  // ZMDP_SRC_POMDPBOUNDS_PACKEDPLANESTORE_H_
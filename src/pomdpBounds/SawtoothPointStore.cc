@@ -0,0 +1,292 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include "SawtoothPointStore.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "SawtoothUpperBound.h"
+#include "sla_mask.h"
+
+#define MIN_RATIO_EPS (1e-10)
+
+// number of points scanned per pass in getValues()
+#define SAWTOOTH_POINTS_PER_BLOCK (64)
+
+using namespace std;
+using namespace MatrixUtils;
+
+namespace zmdp {
+
+// dense scratch copy of the belief being queried.  it is per-thread so
+// that queries can run concurrently; entries are always left at zero.
+static double *getScratch(int numStates) {
+  static thread_local std::vector<double> bvals;
+  if (bvals.size() < static_cast<size_t>(numStates)) {
+    bvals.resize(numStates, 0.0);
+  }
+  return &bvals[0];
+}
+
+static void scatter(double *bvals, const belief_vector &b) {
+  FOR_CV(b) { bvals[CV_INDEX(b)] = CV_VAL(b); }
+}
+
+static void unscatter(double *bvals, const belief_vector &b) {
+  FOR_CV(b) { bvals[CV_INDEX(b)] = 0.0; }
+}
+
+SawtoothPointStore::SawtoothPointStore(void)
+    : numStates(0), useSupportList(false) {
+  rowStarts.push_back(0);
+}
+
+void SawtoothPointStore::init(int _numStates, bool _useSupportList) {
+  numStates = _numStates;
+  useSupportList = _useSupportList;
+  clear();
+}
+
+void SawtoothPointStore::clear(void) {
+  rowStarts.assign(1, 0);
+  indices.clear();
+  values.clear();
+  points.clear();
+  pointVals.clear();
+  innerCorner.clear();
+  signatures.clear();
+  supportList.init(useSupportList ? numStates : 0);
+}
+
+uint64_t SawtoothPointStore::getSignature(const belief_vector &b) {
+  uint64_t sig = 0;
+  FOR_CV(b) {
+    if (0.0 != CV_VAL(b)) sig |= sla::mask_signature_bit(CV_INDEX(b));
+  }
+  return sig;
+}
+
+void SawtoothPointStore::addPoint(BVPair *bv, const dvector &cornerPts) {
+  int r = points.size();
+  // zero entries of a point place no constraint on the beliefs it
+  // bounds, so only the nonzeros are stored
+  FOR_CV(bv->b) {
+    if (0.0 == CV_VAL(bv->b)) continue;
+    indices.push_back(CV_INDEX(bv->b));
+    values.push_back(CV_VAL(bv->b));
+    if (useSupportList) supportList.add(r, CV_INDEX(bv->b), NULL);
+  }
+  rowStarts.push_back(indices.size());
+  points.push_back(bv);
+  pointVals.push_back(bv->v);
+  innerCorner.push_back(inner_prod(cornerPts, bv->b));
+  signatures.push_back(getSignature(bv->b));
+}
+
+void SawtoothPointStore::rebuild(const std::list<BVPair *> &pts,
+                                 const dvector &cornerPts) {
+  clear();
+  FOR_EACH(ptP, pts) { addPoint(*ptP, cornerPts); }
+}
+
+void SawtoothPointStore::setCorner(int i, const dvector &cornerPts) {
+  if (i >= 0 && useSupportList) {
+    FOR_EACH(eP, supportList.getList(i)) {
+      innerCorner[eP->item] = inner_prod(cornerPts, points[eP->item]->b);
+    }
+  } else {
+    FOR(r, points.size()) {
+      innerCorner[r] = inner_prod(cornerPts, points[r]->b);
+    }
+  }
+}
+
+void SawtoothPointStore::minRatioError(int r, double minRatio) const {
+  const belief_vector &c = points[r]->b;
+  cout << "ERROR: minRatio > 1 in upperBoundInternal!" << endl;
+  cout << "  (minRatio-1)=" << (minRatio - 1) << endl;
+  cout << "  normc=" << norm_1(c) << endl;
+  cout << "  c=" << sparseRep(c) << endl;
+  exit(EXIT_FAILURE);
+}
+
+inline double SawtoothPointStore::getPointValue(int r, const double *bvals,
+                                                uint64_t sigB,
+                                                double innerCornerB) const {
+  // c can only bound b if the support of c is contained in the support
+  // of b; most points that fail are rejected here
+  if (0 != (signatures[r] & ~sigB)) return 99e+20;
+
+  double cVal = pointVals[r];
+  double innerCornerC = innerCorner[r];
+  if (innerCornerC <= cVal) {
+    // c does not provide a useful bound because it actually lies above
+    // the plane defined by cornerPts.  ideally, we would prune c here.
+    return 99e+20;
+  }
+
+  // minRatio = min_i b(i)/c(i) over the support of c.  a zero ratio
+  // means c does not provide a useful bound.
+  unsigned int start = rowStarts[r];
+  double minRatio =
+      min_ratio_dc_internal(bvals, &indices[0] + start, &values[0] + start,
+                            rowStarts[r + 1] - start, 99e+20);
+  if (0.0 == minRatio) return 99e+20;
+
+  if (minRatio > 1) {
+    if (minRatio < 1 + MIN_RATIO_EPS) {
+      // round-off error, correct it down to 1
+      minRatio = 1;
+    } else {
+      minRatioError(r, minRatio);
+    }
+  }
+
+  return innerCornerB + minRatio * (cVal - innerCornerC);
+}
+
+// the points to check when bounding b, or NULL for all of them.  points
+// without entry b.data[0].index are skipped even if they could bound b;
+// unlike with planes, keying on another entry of b would change which
+// points are used and so the value of the bound.
+const SupportIndex<int>::PostingList *SawtoothPointStore::getPointsToCheck(
+    const belief_vector &b) const {
+  return useSupportList ? &supportList.getList(b.data[0].index) : NULL;
+}
+
+double SawtoothPointStore::getValue(const belief_vector &b,
+                                    double innerCornerB) const {
+  double *bvals = getScratch(numStates);
+  scatter(bvals, b);
+  uint64_t sigB = getSignature(b);
+
+  const SupportIndex<int>::PostingList *ptsToCheck = getPointsToCheck(b);
+  int n = (NULL == ptsToCheck) ? size() : ptsToCheck->size();
+  double minValue = innerCornerB;
+  FOR(k, n) {
+    int r = (NULL == ptsToCheck) ? k : (*ptsToCheck)[k].item;
+    minValue =
+        std::min(minValue, getPointValue(r, bvals, sigB, innerCornerB));
+  }
+
+  unscatter(bvals, b);
+  return minValue;
+}
+
+void SawtoothPointStore::getValues(
+    std::vector<double> &result,
+    const std::vector<const belief_vector *> &beliefs,
+    const std::vector<double> &innerCornerB) const {
+  int n = beliefs.size();
+  result = innerCornerB;
+  std::vector<uint64_t> sigB(n);
+  FOR(i, n) { sigB[i] = getSignature(*beliefs[i]); }
+
+  // order the beliefs by the list of points they check
+  std::vector<std::pair<int, int> > order(n);
+  FOR(i, n) {
+    order[i].first = useSupportList ? beliefs[i]->data[0].index : 0;
+    order[i].second = i;
+  }
+  std::sort(order.begin(), order.end());
+
+  double *bvals = getScratch(numStates);
+  for (int start = 0; start < n;) {
+    int end = start + 1;
+    while (end < n && order[end].first == order[start].first) end++;
+
+    const SupportIndex<int>::PostingList *ptsToCheck =
+        getPointsToCheck(*beliefs[order[start].second]);
+    int numPts = (NULL == ptsToCheck) ? size() : ptsToCheck->size();
+    for (int blockStart = 0; blockStart < numPts;
+         blockStart += SAWTOOTH_POINTS_PER_BLOCK) {
+      int blockEnd =
+          std::min(numPts, blockStart + SAWTOOTH_POINTS_PER_BLOCK);
+      for (int k = start; k < end; k++) {
+        int i = order[k].second;
+        const belief_vector &b = *beliefs[i];
+        scatter(bvals, b);
+        double minValue = result[i];
+        for (int j = blockStart; j < blockEnd; j++) {
+          int r = (NULL == ptsToCheck) ? j : (*ptsToCheck)[j].item;
+          minValue = std::min(
+              minValue, getPointValue(r, bvals, sigB[i], innerCornerB[i]));
+        }
+        result[i] = minValue;
+        unscatter(bvals, b);
+      }
+    }
+    start = end;
+  }
+}
+
+void SawtoothPointStore::prune(std::list<BVPair *> &pts,
+                               const dvector &cornerPts,
+                               int lastPruneNumBackups) {
+  int n = size();
+  std::vector<bool> pruned(n, false);
+  double *bvals = getScratch(numStates);
+
+  for (int r = 0; r < n; r++) {
+    BVPair *candidate = points[r];
+    bool candidateIsOld =
+        (candidate->numBackupsAtCreation <= lastPruneNumBackups);
+    scatter(bvals, candidate->b);
+
+    const SupportIndex<int>::PostingList *ptsToCheck =
+        getPointsToCheck(candidate->b);
+    int numPts = (NULL == ptsToCheck) ? n : ptsToCheck->size();
+    FOR(k, numPts) {
+      int opp = (NULL == ptsToCheck) ? k : (*ptsToCheck)[k].item;
+      if (opp == r || pruned[opp]) {
+        // can't dominate yourself, and pruned points no longer count
+      } else if (candidateIsOld &&
+                 points[opp]->numBackupsAtCreation <= lastPruneNumBackups) {
+        // candidate and opponent were compared the last time we pruned
+        // and neither dominates the other; leave them both in
+      } else if (getPointValue(opp, bvals, signatures[r], innerCorner[r]) <
+                 pointVals[r] + ZMDP_BOUNDS_PRUNE_EPS) {
+        // candidate is pruned
+        pruned[r] = true;
+        break;
+      }
+    }
+
+    unscatter(bvals, candidate->b);
+  }
+
+  pts.clear();
+  FOR(r, n) {
+    if (pruned[r]) {
+      delete points[r];
+    } else {
+      pts.push_back(points[r]);
+    }
+  }
+  rebuild(pts, cornerPts);
+}
+
+};  // namespace zmdp
@@ -0,0 +1,107 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_POMDPBOUNDS_SAWTOOTHPOINTSTORE_H_
+#define ZMDP_SRC_POMDPBOUNDS_SAWTOOTHPOINTSTORE_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <vector>
+
+#include "SupportIndex.h"
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+
+namespace zmdp {
+
+struct BVPair;
+
+// Packed copy of the points of a SawtoothUpperBound, used to answer all
+// of its value queries.  The BVPair objects remain the primary
+// representation; this store holds their nonzero entries in one
+// compressed-row block, along with each point's value, its inner
+// product with the current corner points, and a 64-bit signature of its
+// support (see mask_signature_bit()).  A point whose
+// signature has a bit that the query belief lacks cannot bound it, so
+// it is rejected without reading its entries.
+//
+// Points are appended in order and only removed by prune(), which
+// rebuilds the store.  setCorner() must be called whenever a corner
+// point value changes so that the cached inner products stay exact.
+struct SawtoothPointStore {
+  int numStates;
+  bool useSupportList;
+
+  // point r has entries rowStarts[r] .. rowStarts[r+1]-1 of
+  // indices/values
+  std::vector<unsigned int> rowStarts;
+  std::vector<unsigned int> indices;
+  std::vector<double> values;
+  std::vector<BVPair *> points;
+  std::vector<double> pointVals;
+  std::vector<double> innerCorner;
+  std::vector<uint64_t> signatures;
+
+  // supportList.getList(i) lists (in order) the points with a nonzero in
+  // entry i.  points are only removed by rebuilding, so the order is
+  // kept.
+  SupportIndex<int> supportList;
+
+  SawtoothPointStore(void);
+
+  void init(int _numStates, bool _useSupportList);
+  void clear(void);
+  int size(void) const { return points.size(); }
+  void addPoint(BVPair *bv, const sla::dvector &cornerPts);
+  void rebuild(const std::list<BVPair *> &pts, const sla::dvector &cornerPts);
+
+  // recomputes the cached inner products after cornerPts(i) changes; a
+  // negative i means any entry may have changed
+  void setCorner(int i, const sla::dvector &cornerPts);
+
+  // returns the sawtooth upper bound at b, given innerCornerB =
+  // inner_prod(cornerPts, b)
+  double getValue(const belief_vector &b, double innerCornerB) const;
+
+  // result[i] = getValue(*beliefs[i], innerCornerB[i]), with the points
+  // scanned in blocks so each is read once per block of beliefs
+  void getValues(std::vector<double> &result,
+                 const std::vector<const belief_vector *> &beliefs,
+                 const std::vector<double> &innerCornerB) const;
+
+  // removes every point dominated by another point (at the dominated
+  // point's belief).  pairs of points that were both created at or
+  // before lastPruneNumBackups are assumed to have been compared
+  // already.  dominated points are deleted from pts and freed.
+  void prune(std::list<BVPair *> &pts, const sla::dvector &cornerPts,
+             int lastPruneNumBackups);
+
+  static uint64_t getSignature(const belief_vector &b);
+
+  // the bound that point r induces at the belief scattered into bvals,
+  // or 99e+20 if it does not improve on the corner points
+  inline double getPointValue(int r, const double *bvals, uint64_t sigB,
+                              double innerCornerB) const;
+  const SupportIndex<int>::PostingList *getPointsToCheck(
+      const belief_vector &b) const;
+  void minRatioError(int r, double minRatio) const;
+};
+
+};  // namespace zmdp
+
+#endif  // ZMDP_SRC_POMDPBOUNDS_SAWTOOTHPOINTSTORE_H_
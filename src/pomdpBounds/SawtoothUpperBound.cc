@@ -26,14 +26,15 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
 #include <list>
 
 #include "FastInfUBInitializer.h"
+#include "ThreadPool.h"
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTime.h"
 
-#define MIN_RATIO_EPS (1e-10)
 #define PRUNE_PTS_INCREMENT (10)
 #define PRUNE_PTS_FACTOR (2.0)
 #define CORNER_EPS (1e-6)
@@ -45,15 +46,17 @@ namespace zmdp {
 
 SawtoothUpperBound::SawtoothUpperBound(const MDP *_pomdp,
                                        const ZMDPConfig *_config)
-    : pomdp((const Pomdp *)_pomdp), config(_config), core(NULL) {
+    : pomdp((const Pomdp *)_pomdp),
+      config(_config),
+      core(NULL),
+      initialized(false),
+      newPointHandler(NULL),
+      newPointHandlerData(NULL) {
   numStates = pomdp->getBeliefSize();
   lastPruneNumPts = 0;
   lastPruneNumBackups = -1;
   useSawtoothSupportList = config->getBool("useSawtoothSupportList");
-
-  if (useSawtoothSupportList) {
-    supportList.resize(pomdp->getBeliefSize());
-  }
+  store.init(numStates, useSawtoothSupportList);
 }
 
 SawtoothUpperBound::~SawtoothUpperBound(void) {
@@ -61,8 +64,40 @@ SawtoothUpperBound::~SawtoothUpperBound(void) {
 }
 
 void SawtoothUpperBound::initialize(double targetPrecision) {
+  if (initialized) return;
+
   FastInfUBInitializer fib(pomdp, this);
   fib.initialize(targetPrecision);
+
+  if (config->getBool("useLazyExpansion")) {
+    int numActions = pomdp->getNumActions();
+    dvector Rcol, Tcorner;
+    initQ.resize(numActions, numStates);
+    FOR(a, numActions) {
+      copy_from_column(Rcol, pomdp->R, a);
+      mult(Tcorner, cornerPts, pomdp->Ttr[a]);
+      FOR(s, numStates) {
+        initQ(a, s) = Rcol(s) + pomdp->getDiscount() * Tcorner(s);
+      }
+    }
+  }
+  initialized = true;
+}
+
+// the corner values are an upper bound on the value of every belief, so
+// initQ gives an upper bound on each Q value (one that ignores what the
+// observation would reveal)
+bool SawtoothUpperBound::setInitialQBounds(MDPNode &cn) {
+  if (0 == initQ.size2()) return false;
+
+  int numActions = pomdp->getNumActions();
+  FOR(a, numActions) { cn.Q[a].ubVal = 0.0; }
+  FOR_CV(cn.s) {
+    double p = CV_VAL(cn.s);
+    const double *q = &initQ.data[CV_INDEX(cn.s) * numActions];
+    FOR(a, numActions) { cn.Q[a].ubVal += p * q[a]; }
+  }
+  return true;
 }
 
 void SawtoothUpperBound::initNodeBound(MDPNode &cn) {
@@ -73,123 +108,70 @@ void SawtoothUpperBound::initNodeBound(MDPNode &cn) {
   }
 }
 
-void SawtoothUpperBound::update(MDPNode &cn, int *maxUBActionP) {
-  double newUBVal = getNewUBValue(cn, maxUBActionP);
-  setUBForNode(cn, newUBVal, true);
-}
-
-// returns the upper bound that the (belief,value) pair c induces on b.
-double SawtoothUpperBound::getBVValue(const belief_vector &b,
-                                      const BVPair *cPair,
-                                      double innerCornerPtsB,
-                                      double innerCornerPtsC) {
-  const belief_vector &c = cPair->b;
-  double cVal = cPair->v;
-
-  if (innerCornerPtsC <= cVal) {
-    // c does not provide a useful bound because it actually lies above
-    // the plane defined by cornerPts.  ideally, we would prune c here.
-    return 99e+20;
-  }
-
-  double minRatio = 99e+20;
-  typeof(b.data.begin()) bi = b.data.begin();
-  typeof(b.data.begin()) bend = b.data.end();
-  typeof(b.data.begin()) ci = c.data.begin();
-  typeof(b.data.begin()) cend = c.data.end();
-  bool bdone = false;
-
-  for (; ci != cend; ci++) {
-    if (0.0 == ci->value) continue;
-
-    // advance until bi->index >= ci->index
-    while (1) {
-      if (bi == bend) {
-        bdone = true;
-        goto breakCiLoop;
-      }
-      if (bi->index >= ci->index) break;
-      bi++;
+// same result as calling initNodeBound() on each node in turn.  terminal
+// nodes add points, so the nodes between them are scored in batches.
+void SawtoothUpperBound::initNodeBounds(const std::vector<MDPNode *> &nodes) {
+  std::vector<const belief_vector *> beliefs;
+  std::vector<double> values;
+  size_t batchStart = 0;
+  FOR(i, nodes.size() + 1) {
+    if (i < nodes.size() && !nodes[i]->isTerminal) {
+      beliefs.push_back(&nodes[i]->s);
+      continue;
     }
-
-    if (bi->index > ci->index) {
-      // we found a j such that b(j) = 0 and c(j) != 0, which implies
-      // minRatio = 0, so c does not provide a useful bound
-      return 99e+20;
+    if (!beliefs.empty()) {
+      getValues(values, beliefs);
+      for (size_t j = batchStart; j < i; j++) {
+        setUBForNode(*nodes[j], values[j - batchStart], false);
+      }
+      beliefs.clear();
     }
-
-    minRatio = std::min(minRatio, bi->value / ci->value);
-  }
-breakCiLoop:
-  if (bdone) {
-    for (; ci != cend; ci++) {
-      if (0.0 != ci->value) return 99e+20;
+    if (i < nodes.size()) {
+      initNodeBound(*nodes[i]);
     }
+    batchStart = i + 1;
   }
+}
 
-#if 1
-  if (minRatio > 1) {
-    if (minRatio < 1 + MIN_RATIO_EPS) {
-      // round-off error, correct it down to 1
-      minRatio = 1;
-    } else {
-      cout << "ERROR: minRatio > 1 in upperBoundInternal!" << endl;
-      cout << "  (minRatio-1)=" << (minRatio - 1) << endl;
-      cout << "  normb=" << norm_1(b) << endl;
-      cout << "  b=" << sparseRep(b) << endl;
-      cout << "  normc=" << norm_1(c) << endl;
-      cout << "  c=" << sparseRep(c) << endl;
-      exit(EXIT_FAILURE);
-    }
-  }
-#endif
+void SawtoothUpperBound::update(MDPNode &cn, int *maxUBActionP) {
+  commitUpdate(cn, prepareUpdate(cn, maxUBActionP), maxUBActionP);
+}
 
-  return innerCornerPtsB + minRatio * (cVal - innerCornerPtsC);
+void *SawtoothUpperBound::prepareUpdate(MDPNode &cn, int *maxUBActionP) {
+  BVPair *newBV = new BVPair();
+  newBV->b = cn.s;
+  newBV->v = getNewUBValue(cn, maxUBActionP);
+  return newBV;
 }
 
-// return true iff xPair dominates yPair.  NOTE: innerCornerCache fields
-// must be set properly before dominates() is called!
-bool SawtoothUpperBound::dominates(const BVPair *xPair, const BVPair *yPair) {
-  double xValueAtY = getBVValue(yPair->b, xPair, yPair->innerCornerCache,
-                                xPair->innerCornerCache);
-  double yValueAtY = yPair->v;
-  return (xValueAtY < yValueAtY + ZMDP_BOUNDS_PRUNE_EPS);
+void SawtoothUpperBound::commitUpdate(MDPNode &cn, void *prepared,
+                                      int *maxUBActionP) {
+  BVPair *newBV = reinterpret_cast<BVPair *>(prepared);
+  newBV->numBackupsAtCreation = core->numBackups;
+
+  cn.ubVal = newBV->v;
+
+  if (NULL != newPointHandler) {
+    (*newPointHandler)(*newBV, newPointHandlerData);
+  }
+  addPoint(newBV);
+  maybePrune(core->numBackups);
 }
 
 double SawtoothUpperBound::getValue(const belief_vector &b,
                                     const MDPNode *cn) const {
-  const BVList *ptsToCheck;
-  if (useSawtoothSupportList) {
-    ptsToCheck = &supportList[b.data[0].index];
-  } else {
-    ptsToCheck = &pts;
-  }
-
-  double innerCornerPtsB = inner_prod(cornerPts, b);
-  double minValue = innerCornerPtsB;
-  FOR_EACH(cPairP, *ptsToCheck) {
-    double innerCornerPtsC = inner_prod(cornerPts, (*cPairP)->b);
-    minValue = std::min(
-        minValue, getBVValue(b, *cPairP, innerCornerPtsB, innerCornerPtsC));
-  }
-  return minValue;
+  return store.getValue(b, inner_prod(cornerPts, b));
 }
 
-void SawtoothUpperBound::deleteAndForward(BVPair *victim, BVPair *dominator) {
-  if (useSawtoothSupportList) {
-    // remove victim from supportList
-    FOR_EACH(bi, victim->b.data) {
-      BVList &bvl = supportList[bi->index];
-      FOR_EACH(eltP, bvl) {
-        if (victim == *eltP) {
-          eraseElement(bvl, eltP);
-          break;
-        }
-      }
-    }
+// result[i] = getValue(*beliefs[i], NULL)
+void SawtoothUpperBound::getValues(
+    std::vector<double> &result,
+    const std::vector<const belief_vector *> &beliefs) const {
+  std::vector<double> innerCornerPtsB(beliefs.size());
+  FOR(i, beliefs.size()) {
+    innerCornerPtsB[i] = inner_prod(cornerPts, *beliefs[i]);
   }
-
-  delete victim;
+  store.getValues(result, beliefs, innerCornerPtsB);
 }
 
 void SawtoothUpperBound::prune(int numBackups) {
@@ -198,40 +180,7 @@ void SawtoothUpperBound::prune(int numBackups) {
     oldNum = pts.size();
   }
 
-  FOR_EACH(ptP, pts) {
-    BVPair *pt = *ptP;
-    pt->innerCornerCache = inner_prod(cornerPts, pt->b);
-  }
-
-  typeof(pts.begin()) candidateP = pts.begin();
-  while (candidateP != pts.end()) {
-    BVPair *candidate = *candidateP;
-    const BVList *ptsToCheck;
-    if (useSawtoothSupportList) {
-      ptsToCheck = &supportList[candidate->b.data[0].index];
-    } else {
-      ptsToCheck = &pts;
-    }
-    typeof(ptsToCheck->begin()) opponentP = ptsToCheck->begin();
-    while (opponentP != ptsToCheck->end()) {
-      BVPair *opponent = *opponentP;
-      if (candidate == opponent) {
-        // duh, can't dominate yourself
-      } else if (candidate->numBackupsAtCreation <= lastPruneNumBackups &&
-                 opponent->numBackupsAtCreation <= lastPruneNumBackups) {
-        // candidate and opponent were compared the last time we pruned
-        // and neither dominates the other; leave them both in
-      } else if (dominates(opponent, candidate)) {
-        // candidate is pruned
-        deleteAndForward(candidate, opponent);
-        candidateP = eraseElement(pts, candidateP);
-        goto nextCandidate;
-      }
-      opponentP++;
-    }
-    candidateP++;
-  nextCandidate : {}
-  }
+  store.prune(pts, cornerPts, lastPruneNumBackups);
 
   if (zmdpDebugLevelG >= 1) {
     cout << "... pruned # pts from " << oldNum << " down to " << pts.size()
@@ -271,33 +220,42 @@ int SawtoothUpperBound::whichCornerPoint(const belief_vector &b) const {
   }
 }
 
+void SawtoothUpperBound::setCornerPts(const dvector &_cornerPts) {
+  cornerPts = _cornerPts;
+  store.setCorner(-1, cornerPts);
+}
+
+void SawtoothUpperBound::setCornerPt(int i, double val) {
+  cornerPts(i) = val;
+  store.setCorner(i, cornerPts);
+}
+
 void SawtoothUpperBound::addPoint(BVPair *bv) {
   int wc = whichCornerPoint(bv->b);
   if (-1 == wc) {
-    if (useSawtoothSupportList) {
-      // add new point to supportList
-      FOR_EACH(bi, bv->b.data) { supportList[bi->index].push_back(bv); }
-    }
     pts.push_back(bv);
+    store.addPoint(bv, cornerPts);
   } else {
-    cornerPts(wc) = bv->v;
+    setCornerPt(wc, bv->v);
     delete bv;
   }
 }
 
 void SawtoothUpperBound::addPoint(const belief_vector &b, double val) {
-  int wc = whichCornerPoint(b);
-  if (-1 == wc) {
-    BVPair *bv = new BVPair(b, val);
-
-    if (useSawtoothSupportList) {
-      // add new point to supportList
-      FOR_EACH(bi, b.data) { supportList[bi->index].push_back(bv); }
-    }
+  BVPair *bv = new BVPair(b, val);
+  bv->numBackupsAtCreation = (NULL == core) ? -1 : core->numBackups;
+  addPoint(bv);
+}
 
-    pts.push_back(bv);
+void SawtoothUpperBound::mergePoint(BVPair *bv) {
+  int wc = whichCornerPoint(bv->b);
+  if (-1 == wc) {
+    bv->numBackupsAtCreation = core->numBackups;
+    addPoint(bv);
   } else {
-    cornerPts(wc) = val;
+    // both values are valid upper bounds; keep the tighter one
+    setCornerPt(wc, std::min(cornerPts(wc), bv->v));
+    delete bv;
   }
 }
 
@@ -318,6 +276,9 @@ double SawtoothUpperBound::getNewUBValueQ(MDPNode &cn, int a) {
   double val = 0;
 
   MDPQEntry &Qa = cn.Q[a];
+  if (!Qa.isExpanded()) {
+    core->expandAction(cn, a);
+  }
   FOR(o, Qa.getNumOutcomes()) {
     MDPEdge *e = Qa.outcomes[o];
     if (NULL != e) {
@@ -336,12 +297,17 @@ double SawtoothUpperBound::getNewUBValueSimple(MDPNode &cn, int *maxUBActionP) {
     startTime = getTime();
   }
 
-  double val, maxVal = -99e+20;
+  // getNewUBValueQ() only writes cn.Q[a].ubVal, so the actions can be
+  // evaluated in parallel; pick the best one afterward in action order
+  int numActions = pomdp->getNumActions();
+  threadPoolG.parallelFor(numActions,
+                          [&](int a) { getNewUBValueQ(cn, a); });
+
+  double maxVal = -99e+20;
   int maxUBAction = -1;
-  FOR(a, pomdp->getNumActions()) {
-    val = getNewUBValueQ(cn, a);
-    if (val > maxVal) {
-      maxVal = val;
+  FOR(a, numActions) {
+    if (cn.Q[a].ubVal > maxVal) {
+      maxVal = cn.Q[a].ubVal;
       maxUBAction = a;
     }
   }
@@ -438,6 +404,10 @@ int SawtoothUpperBound::getStorage(int whichMetric) const {
       return entryCount + cornerPts.size();
     }
 
+    case ZMDP_S_NUM_INDEX_ENTRIES:
+      // return total length of the support list posting lists
+      return store.supportList.numEntries;
+
     default:
       /* N/A */
       return 0;
@@ -24,6 +24,7 @@
 #include "IncrementalUpperBound.h"
 #include "MatrixUtils.h"
 #include "Pomdp.h"
+#include "SawtoothPointStore.h"
 #include "zmdpConfig.h"
 
 #define PRUNE_EPS (1e-10)
@@ -33,7 +34,6 @@ namespace zmdp {
 struct BVPair {
   belief_vector b;
   double v;
-  double innerCornerCache;
   int numBackupsAtCreation;
 
   BVPair(void) {}
@@ -42,6 +42,9 @@ struct BVPair {
 
 typedef std::list<BVPair *> BVList;
 
+// called with each point that update() adds
+typedef void (*NewBVPairHandler)(const BVPair &bv, void *handlerData);
+
 struct SawtoothUpperBound : public IncrementalUpperBound {
   const Pomdp *pomdp;
   const ZMDPConfig *config;
@@ -50,9 +53,16 @@ struct SawtoothUpperBound : public IncrementalUpperBound {
   int lastPruneNumPts;
   int lastPruneNumBackups;
   BVList pts;
+  // packed copy of pts that answers all value queries
+  SawtoothPointStore store;
   sla::dvector cornerPts;
-  std::vector<BVList> supportList;
+  // initQ(a,s) = R(s,a) + discount * T[a](s,:) * cornerPts, using the
+  // corner values from initialization; only set up if useLazyExpansion=1
+  sla::dmatrix initQ;
   bool useSawtoothSupportList;
+  bool initialized;
+  NewBVPairHandler newPointHandler;
+  void *newPointHandlerData;
 
   SawtoothUpperBound(const MDP *_pomdp, const ZMDPConfig *_config);
   ~SawtoothUpperBound(void);
@@ -60,19 +70,27 @@ struct SawtoothUpperBound : public IncrementalUpperBound {
   void initialize(double targetPrecision);
   double getValue(const belief_vector &b, const MDPNode *cn) const;
   void initNodeBound(MDPNode &cn);
+  void initNodeBounds(const std::vector<MDPNode *> &nodes);
+  void getValues(std::vector<double> &result,
+                 const std::vector<const belief_vector *> &beliefs) const;
   void update(MDPNode &cn, int *maxUBActionP);
+  bool setInitialQBounds(MDPNode &cn);
+  void *prepareUpdate(MDPNode &cn, int *maxUBActionP);
+  void commitUpdate(MDPNode &cn, void *prepared, int *maxUBActionP);
 
-  static double getBVValue(const belief_vector &b, const BVPair *cPair,
-                           double innerCornerPtsB, double innerCornerPtsC);
-  static bool dominates(const BVPair *xPair, const BVPair *yPair);
-
-  void deleteAndForward(BVPair *victim, BVPair *dominator);
   void prune(int numBackups);
   void maybePrune(int numBackups);
 
   int whichCornerPoint(const belief_vector &b) const;
+  // all changes to cornerPts go through these so that the store's
+  // cached inner products stay current
+  void setCornerPts(const sla::dvector &_cornerPts);
+  void setCornerPt(int i, double val);
   void addPoint(const belief_vector &b, double val);
   void addPoint(BVPair *bv);
+  // adds a point that was generated elsewhere (e.g. by another bound
+  // working on the same problem) and takes ownership of it
+  void mergePoint(BVPair *bv);
   void printToStream(std::ostream &out) const;
 
   double getNewUBValueQ(MDPNode &cn, int a);
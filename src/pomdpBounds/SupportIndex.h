@@ -0,0 +1,105 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_POMDPBOUNDS_SUPPORTINDEX_H_
+#define ZMDP_SRC_POMDPBOUNDS_SUPPORTINDEX_H_
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+
+namespace zmdp {
+
+// Inverted index from state indices to the items (planes or points)
+// whose support includes that state.  Each posting list is a contiguous
+// array.  An entry can point to an int owned by its item that always
+// holds the entry's position in the list; remove() uses it to move the
+// last entry of the list into the hole, so removal takes constant time
+// (and does not preserve the order of the list).
+template <class T>
+struct SupportIndex {
+  struct Entry {
+    T item;
+    // the item's copy of this entry's position, or NULL if the entry is
+    // never removed individually
+    int *pos;
+  };
+  typedef std::vector<Entry> PostingList;
+
+  std::vector<PostingList> lists;
+  int numEntries;
+
+  SupportIndex(void) : numEntries(0) {}
+
+  void init(int numKeys) {
+    lists.assign(numKeys, PostingList());
+    numEntries = 0;
+  }
+
+  void clear(void) {
+    FOR_EACH(listP, lists) { listP->clear(); }
+    numEntries = 0;
+  }
+
+  // adds item to the list for key.  pos must stay valid until the entry
+  // is removed.
+  void add(T item, int key, int *pos) {
+    PostingList &pl = lists[key];
+    if (NULL != pos) *pos = pl.size();
+    Entry e = {item, pos};
+    pl.push_back(e);
+    numEntries++;
+  }
+
+  // removes the entry whose position is *pos from the list for key
+  void remove(int key, const int *pos) {
+    PostingList &pl = lists[key];
+    int p = *pos;
+    assert(pos == pl[p].pos);
+    pl[p] = pl.back();
+    if (NULL != pl[p].pos) *pl[p].pos = p;
+    pl.pop_back();
+    numEntries--;
+  }
+
+  const PostingList &getList(int key) const { return lists[key]; }
+
+  // returns the entry of x with the shortest posting list.  an item that
+  // must contain the whole support of x is on every list of x, so this
+  // is the cheapest list to scan.
+  template <class V>
+  int getShortestKey(const sla::basic_cvector<V> &x) const {
+    int bestKey = x.data[0].index;
+    size_t bestSize = lists[bestKey].size();
+    FOR_EACH(xi, x.data) {
+      size_t size = lists[xi->index].size();
+      if (size < bestSize) {
+        bestKey = xi->index;
+        bestSize = size;
+      }
+    }
+    return bestKey;
+  }
+};
+
+};  // namespace zmdp
+
+#endif  // ZMDP_SRC_POMDPBOUNDS_SUPPORTINDEX_H_
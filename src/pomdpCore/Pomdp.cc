@@ -35,6 +35,7 @@
 #include "MatrixUtils.h"
 #include "MaxPlanesLowerBound.h"
 #include "SawtoothUpperBound.h"
+#include "ThreadPool.h"
 #include "slaMatrixUtils.h"
 #include "zmdpCommonDefs.h"
 
@@ -45,16 +46,30 @@ namespace zmdp {
 
 Pomdp::Pomdp(const std::string &fileName, const ZMDPConfig *config) {
   bool useFastModelParser = config->getBool("useFastModelParser");
-  if (useFastModelParser) {
+  bool useCanonicalModelParser = config->getBool("useCanonicalModelParser");
+  if (isCompiledFile(fileName)) {
+    readCompiledFile(fileName, /* expectPomdp = */ true);
+  } else if (useFastModelParser && !useCanonicalModelParser) {
     FastParser parser;
     parser.readPomdpFromFile(*this, fileName);
   } else {
     CassandraParser parser;
+    parser.useCanonicalParser = useCanonicalModelParser;
     parser.readPomdpFromFile(*this, fileName);
   }
 
   maxHorizon = config->getInt("maxHorizon");
 
+  if (config->getBool("compactReachableStates")) {
+    compactReachableStates();
+  }
+  if (config->getBool("aggregateObservationsAndActions")) {
+    aggregateObservationsAndActions();
+  }
+  if (config->getBool("useStackedTransitions")) {
+    buildStackedTransitions();
+  }
+
   // belief vectors are the 'state vectors' of the belief-MDP; the
   // dimensionality of these vectors is the number of states in
   // the POMDP
@@ -80,7 +95,7 @@ obs_prob_vector &Pomdp::getObsProbVector(obs_prob_vector &result,
 belief_vector &Pomdp::getNextBelief(belief_vector &result,
                                     const belief_vector &b, int a,
                                     int o) const {
-  belief_vector tmp;
+  sparse_accum &tmp = thread_sparse_accum(SLA_ACCUM_OUTER);
 
   // result = O_a(:,o) .* (T_a * b)
   mult(tmp, Ttr[a], b);
@@ -92,6 +107,61 @@ belief_vector &Pomdp::getNextBelief(belief_vector &result,
   return result;
 }
 
+void Pomdp::getObsProbsAndNextBeliefs(obs_prob_vector &result,
+                                      std::vector<belief_vector> &nextBeliefs,
+                                      const belief_vector &b, int a) const {
+  sparse_accum &tmp = thread_sparse_accum(SLA_ACCUM_OUTER);
+
+  // tmp = T_a * b, shared by all observations
+  mult(tmp, Ttr[a], b);
+  getObsProbsAndNextBeliefsFromTmp(result, nextBeliefs, tmp, a);
+}
+
+void Pomdp::getObsProbsAndNextBeliefsAllActions(
+    std::vector<obs_prob_vector> &result,
+    std::vector<std::vector<belief_vector> > &nextBeliefs,
+    const belief_vector &b) const {
+  result.resize(numActions);
+  nextBeliefs.resize(numActions);
+  if (Tstack.empty()) {
+    threadPoolG.parallelFor(numActions, [&](int a) {
+      getObsProbsAndNextBeliefs(result[a], nextBeliefs[a], b, a);
+    });
+    return;
+  }
+
+  // tmps[a] = T_a * b for all actions in one pass over b.  the lambda
+  // must see this thread's tmps, not those of the thread running it.
+  static thread_local std::vector<sparse_accum> tmps;
+  const std::vector<sparse_accum> &myTmps = tmps;
+  Tstack.multAllActions(tmps, b);
+  threadPoolG.parallelFor(numActions, [&](int a) {
+    getObsProbsAndNextBeliefsFromTmp(result[a], nextBeliefs[a], myTmps[a], a);
+  });
+}
+
+void Pomdp::getObsProbsAndNextBeliefsFromTmp(
+    obs_prob_vector &result, std::vector<belief_vector> &nextBeliefs,
+    const sparse_accum &tmp, int a) const {
+  result.resize(numObservations);
+  nextBeliefs.resize(numObservations);
+  FOR(o, numObservations) {
+    belief_vector &bp = nextBeliefs[o];
+
+    // bp = O_a(:,o) .* tmp; its sum is Pr(o | b, a)
+    emult_column(bp, O[a], o, tmp);
+    double oprob = sum(bp);
+    result(o) = oprob;
+
+    if (oprob > OBS_IS_ZERO_EPS) {
+      // renormalize
+      bp *= (1.0 / oprob);
+    } else {
+      bp.clear();
+    }
+  }
+}
+
 double Pomdp::getReward(const belief_vector &b, int a) {
   return inner_prod_column(R, a, b);
 }
@@ -44,6 +44,23 @@ struct Pomdp : public CassandraModel {
   belief_vector &getNextBelief(belief_vector &result, const belief_vector &b,
                                int a, int o) const;
 
+  // sets result to be the vector of observation probabilities and
+  // nextBeliefs[o] to be the next belief for each observation o with
+  // non-negligible probability when from belief b action a is selected.
+  // equivalent to getObsProbVector() plus getNextBelief() for each o,
+  // but T_a * b is only calculated once.
+  void getObsProbsAndNextBeliefs(obs_prob_vector &result,
+                                 std::vector<belief_vector> &nextBeliefs,
+                                 const belief_vector &b, int a) const;
+
+  // getObsProbsAndNextBeliefs() for every action a.  with
+  // useStackedTransitions=1, T_a * b is calculated for all actions in
+  // one pass over b.
+  void getObsProbsAndNextBeliefsAllActions(
+      std::vector<obs_prob_vector> &result,
+      std::vector<std::vector<belief_vector> > &nextBeliefs,
+      const belief_vector &b) const;
+
   // returns the expected immediate reward when from belief b action a is
   // selected
   double getReward(const belief_vector &b, int a);
@@ -70,11 +87,27 @@ struct Pomdp : public CassandraModel {
                              int o) {
     return getNextBelief(result, s, a, o);
   }
+  void getOutcomes(outcome_prob_vector &opv,
+                   std::vector<state_vector> &nextStates,
+                   const state_vector &s, int a) {
+    getObsProbsAndNextBeliefs(opv, nextStates, s, a);
+  }
+  void getAllOutcomes(std::vector<outcome_prob_vector> &opvs,
+                      std::vector<std::vector<state_vector> > &nextStates,
+                      const state_vector &s) {
+    getObsProbsAndNextBeliefsAllActions(opvs, nextStates, s);
+  }
 
  protected:
   void readFromFileCassandra(const std::string &fileName);
   void readFromFileFast(const std::string &fileName);
 
+  // the observation half of getObsProbsAndNextBeliefs(), given
+  // tmp = T_a * b
+  void getObsProbsAndNextBeliefsFromTmp(obs_prob_vector &result,
+                                        std::vector<belief_vector> &nextBeliefs,
+                                        const sparse_accum &tmp, int a) const;
+
   void debugDensity(void);
 };
 
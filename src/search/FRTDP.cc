@@ -41,7 +41,8 @@ using namespace MatrixUtils;
 
 namespace zmdp {
 
-FRTDP::FRTDP(void) {
+FRTDP::FRTDP(void)
+    : numSearchThreads(1), isConcurrent(false), searchSeconds(0) {
   oldMaxDepth = 0;
   maxDepth = FRTDP_INIT_MAX_DEPTH;
 }
@@ -60,7 +61,7 @@ void FRTDP::staticGetNodeHandler(MDPNode &s, void *handlerData) {
   x->getNodeHandler(s);
 }
 
-double &FRTDP::getPrio(const MDPNode &cn) {
+std::atomic<double> &FRTDP::getPrio(const MDPNode &cn) {
   return (reinterpret_cast<FRTDPExtraNodeData *>(cn.searchData))->prio;
 }
 
@@ -92,9 +93,20 @@ void FRTDP::getMaxPrioOutcome(MDPNode &cn, int a, FRTDPUpdateResult &r) const {
 }
 
 void FRTDP::update(MDPNode &cn, FRTDPUpdateResult &r) {
+  std::unique_lock<std::mutex> nodeLock;
+  if (isConcurrent) {
+    nodeLock = std::unique_lock<std::mutex>(bounds->getNodeLock(cn));
+  }
+
   double oldUBVal = cn.ubVal;
-  bounds->update(cn, &r.maxUBAction);
-  trackBackup(cn);
+  if (isConcurrent) {
+    bounds->updateConcurrent(cn, &r.maxUBAction);
+    std::lock_guard<std::mutex> lk(trialLock);
+    trackBackup(cn);
+  } else {
+    bounds->update(cn, &r.maxUBAction);
+    trackBackup(cn);
+  }
 
   r.ubResidual = oldUBVal - cn.ubVal;
 
@@ -106,14 +118,18 @@ void FRTDP::update(MDPNode &cn, FRTDPUpdateResult &r) {
                                                        : log(excessWidth));
 
   // getPrio(cn) = r.maxPrio;
+
+  r.lbVal = cn.lbVal;
+  r.ubVal = cn.ubVal;
 }
 
-void FRTDP::trialRecurse(MDPNode &cn, double logOcc, int depth) {
+void FRTDP::trialRecurse(MDPNode &cn, double logOcc, int depth,
+                         FRTDPTrialState &t) {
   FRTDPUpdateResult r;
   update(cn, r);
 
   double excessWidth =
-      cn.ubVal - cn.lbVal - RT_PRIO_IMPROVEMENT_CONSTANT * targetPrecision;
+      r.ubVal - r.lbVal - RT_PRIO_IMPROVEMENT_CONSTANT * targetPrecision;
   double occ = (logOcc < -50) ? 0 : exp(logOcc);
   double updateQuality = r.ubResidual * occ;
 
@@ -124,8 +140,8 @@ void FRTDP::trialRecurse(MDPNode &cn, double logOcc, int depth) {
 #endif
 
   if (zmdpDebugLevelG >= 1) {
-    printf("  trialRecurse: depth=%d [%g .. %g] a=%d o=%d\n", depth, cn.lbVal,
-           cn.ubVal, r.maxUBAction, r.maxPrioOutcome);
+    printf("  trialRecurse: depth=%d [%g .. %g] a=%d o=%d\n", depth, r.lbVal,
+           r.ubVal, r.maxUBAction, r.maxPrioOutcome);
     printf("  trialRecurse: s=%s\n", sparseRep(cn.s).c_str());
   }
 
@@ -136,15 +152,15 @@ void FRTDP::trialRecurse(MDPNode &cn, double logOcc, int depth) {
          r.maxPrioOutcome, r.maxPrio);
 #endif
 
-  if (depth > oldMaxDepth) {
-    newQualitySum += updateQuality;
-    newNumUpdates++;
+  if (depth > t.oldMaxDepth) {
+    t.newQualitySum += updateQuality;
+    t.newNumUpdates++;
   } else {
-    oldQualitySum += updateQuality;
-    oldNumUpdates++;
+    t.oldQualitySum += updateQuality;
+    t.oldNumUpdates++;
   }
 
-  if (excessWidth <= 0 || depth > maxDepth) {
+  if (excessWidth <= 0 || depth > t.maxDepth) {
     if (zmdpDebugLevelG >= 1) {
       printf("  trialRecurse: depth=%d excessWidth=%g (terminating)\n", depth,
              excessWidth);
@@ -153,6 +169,11 @@ void FRTDP::trialRecurse(MDPNode &cn, double logOcc, int depth) {
 
     return;
   }
+  if (t.isHelper && helpers.getStopRequested()) {
+    // doTrial() is waiting for the helpers; the bounds are valid at any
+    // point, so cut the trial short, skipping the updates on the way back
+    return;
+  }
 
   // recurse to successor
   assert(-1 != r.maxPrioOutcome);
@@ -160,36 +181,46 @@ void FRTDP::trialRecurse(MDPNode &cn, double logOcc, int depth) {
   double weight = problem->getDiscount() * obsProb;
   double nextLogOcc = logOcc + log(weight);
   trialRecurse(cn.getNextState(r.maxUBAction, r.maxPrioOutcome), nextLogOcc,
-               depth + 1);
+               depth + 1, t);
 
+  if (t.isHelper && helpers.getStopRequested()) return;
   update(cn, r);
 }
 
-bool FRTDP::doTrial(MDPNode &cn) {
+void FRTDP::runTrial(MDPNode &cn, bool isHelper) {
+  std::unique_lock<std::mutex> lk(trialLock, std::defer_lock);
+
+  FRTDPTrialState t;
+  if (isConcurrent) lk.lock();
   if (zmdpDebugLevelG >= 1) {
     printf("-*- doTrial: trial %d\n", (numTrials + 1));
   }
+  t.oldMaxDepth = oldMaxDepth;
+  t.maxDepth = maxDepth;
+  if (isConcurrent) lk.unlock();
 
-  oldQualitySum = 0;
-  oldNumUpdates = 0;
-  newQualitySum = 0;
-  newNumUpdates = 0;
+  t.oldQualitySum = 0;
+  t.oldNumUpdates = 0;
+  t.newQualitySum = 0;
+  t.newNumUpdates = 0;
+  t.isHelper = isHelper;
 
   trialRecurse(cn,
                /* logOcc = */ log(1.0),
-               /* depth = */ 0);
+               /* depth = */ 0, t);
 
   double updateQualityDiff;
-  if (0 == oldQualitySum) {
+  if (0 == t.oldQualitySum) {
     updateQualityDiff = 1000;
-  } else if (0 == newNumUpdates) {
+  } else if (0 == t.newNumUpdates) {
     updateQualityDiff = -1000;
   } else {
-    double oldMean = oldQualitySum / oldNumUpdates;
-    double newMean = newQualitySum / newNumUpdates;
+    double oldMean = t.oldQualitySum / t.oldNumUpdates;
+    double newMean = t.newQualitySum / t.newNumUpdates;
     updateQualityDiff = newMean - oldMean;
   }
 
+  if (isConcurrent) lk.lock();
   if (updateQualityDiff > -FRTDP_QUALITY_MARGIN) {
     oldMaxDepth = maxDepth;
     maxDepth *= FRTDP_MAX_DEPTH_ADJUST_RATIO;
@@ -207,16 +238,70 @@ bool FRTDP::doTrial(MDPNode &cn) {
 #if 0
   printf("endTrial: oldQualitySum=%g oldNumUpdates=%d newQualitySum=%g "
          "newNumUpdates=%d\n",
-         oldQualitySum, oldNumUpdates, newQualitySum, newNumUpdates);
+         t.oldQualitySum, t.oldNumUpdates, t.newQualitySum, t.newNumUpdates);
 #endif
 
   numTrials++;
+}
+
+bool FRTDP::doTrial(MDPNode &cn) {
+  StopWatch run;
+  if (!isConcurrent) {
+    runTrial(cn, false);
+    searchSeconds += run.elapsedTime();
+    return (cn.ubVal - cn.lbVal < targetPrecision);
+  }
+
+  helpers.start();
+  bool done;
+  do {
+    runTrial(cn, false);
+    std::lock_guard<std::mutex> lk(bounds->getNodeLock(cn));
+    done = (cn.ubVal - cn.lbVal < targetPrecision);
+  } while (!done && run.elapsedTime() < SEARCH_HELPERS_SLICE_SECONDS);
+
+  // stop the helpers again, so that the caller sees a quiescent graph
+  helpers.stop();
+  searchSeconds += run.elapsedTime();
 
   return (cn.ubVal - cn.lbVal < targetPrecision);
 }
 
 void FRTDP::derivedClassInit(void) {
   bounds->addGetNodeHandler(&FRTDP::staticGetNodeHandler, this);
+
+  numSearchThreads = config->getInt("numSearchThreads");
+  if (numSearchThreads < 1) {
+    fprintf(stderr, "ERROR: numSearchThreads must be at least 1 (got %d)\n",
+            numSearchThreads);
+    exit(EXIT_FAILURE);
+  }
+  if (numSearchThreads > 1 && NULL == dynamic_cast<Pomdp *>(problem)) {
+    // other model types make no promises about concurrent getOutcomes()
+    fprintf(stderr,
+            "WARNING: numSearchThreads > 1 is only supported for POMDP "
+            "models; running 1 search thread\n");
+    numSearchThreads = 1;
+  }
+  isConcurrent = (numSearchThreads > 1);
+  if (isConcurrent) {
+    helpers.init(numSearchThreads - 1, [this](int i) {
+      runTrial(*bounds->getRootNode(), true);
+    });
+  }
+}
+
+void FRTDP::finishLogging(void) {
+  RTDPCore::finishLogging();
+
+  if (searchSeconds > 0) {
+    // compare backups/s across runs with different numbers of threads
+    // to see the speedup
+    printf("FRTDP: %d search threads ran %d trials, %d backups in %.2lf "
+           "seconds (%.1lf backups/s)\n",
+           numSearchThreads, numTrials, bounds->numBackups, searchSeconds,
+           bounds->numBackups / searchSeconds);
+  }
 }
 
 };  // namespace zmdp
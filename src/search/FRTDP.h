@@ -18,7 +18,11 @@
 #ifndef ZMDP_SRC_SEARCH_FRTDP_H_
 #define ZMDP_SRC_SEARCH_FRTDP_H_
 
+#include <atomic>
+#include <mutex>
+
 #include "RTDPCore.h"
+#include "SearchHelpers.h"
 
 namespace zmdp {
 
@@ -27,30 +31,58 @@ struct FRTDPUpdateResult {
   double ubResidual;
   int maxPrioOutcome;
   double maxPrio;
+  // bounds of the node right after the update
+  double lbVal, ubVal;
 };
 
 struct FRTDPExtraNodeData {
-  double prio;
+  // atomic because concurrent trials read the priorities of nodes that
+  // other threads are updating
+  std::atomic<double> prio;
 };
 
-struct FRTDP : public RTDPCore {
+// bookkeeping for the adaptive depth limit, kept separately by each trial
+struct FRTDPTrialState {
   double oldMaxDepth;
   double maxDepth;
   double oldQualitySum;
   int oldNumUpdates;
   double newQualitySum;
   int newNumUpdates;
+  // true for trials run by helper threads, which end early when asked
+  // to stop
+  bool isHelper;
+};
+
+struct FRTDP : public RTDPCore {
+  double oldMaxDepth;
+  double maxDepth;
+
+  // concurrent trials (numSearchThreads > 1).  while doTrial() runs
+  // trials in the calling thread, numSearchThreads-1 helper threads run
+  // trials from the root of the same search graph.
+  int numSearchThreads;
+  bool isConcurrent;
+  SearchHelpers helpers;
+  // protects the depth limit, numTrials and backup logging
+  std::mutex trialLock;
+  // time spent in doTrial(), for reporting throughput
+  double searchSeconds;
 
   FRTDP(void);
 
   void getNodeHandler(MDPNode &cn);
   static void staticGetNodeHandler(MDPNode &cn, void *handlerData);
-  static double &getPrio(const MDPNode &cn);
+  static std::atomic<double> &getPrio(const MDPNode &cn);
   void getMaxPrioOutcome(MDPNode &cn, int a, FRTDPUpdateResult &result) const;
   void update(MDPNode &cn, FRTDPUpdateResult &result);
-  void trialRecurse(MDPNode &cn, double logOcc, int depth);
+  void trialRecurse(MDPNode &cn, double logOcc, int depth,
+                    FRTDPTrialState &t);
+  void runTrial(MDPNode &cn, bool isHelper);
   bool doTrial(MDPNode &cn);
   void derivedClassInit(void);
+  void finishLogging(void);
+
 };
 
 };  // namespace zmdp
@@ -62,7 +62,7 @@ HDP::HDP(void) {}
 void HDP::getNodeHandler(MDPNode &cn) {
   HDPExtraNodeData *searchData = new HDPExtraNodeData;
   cn.searchData = searchData;
-  searchData->isSolved = cn.isTerminal;
+  initRTDPNodeData(cn, searchData->rt);
   searchData->idx = RT_IDX_PLUS_INFINITY;
   searchData->low = RT_IDX_PLUS_INFINITY;
 }
@@ -73,17 +73,23 @@ void HDP::staticGetNodeHandler(MDPNode &s, void *handlerData) {
 }
 
 bool &HDP::getIsSolved(const MDPNode &cn) {
-  return (reinterpret_cast<HDPExtraNodeData *>(cn.searchData))->isSolved;
+  return getRTDPNodeData(cn).isSolved;
 }
 
 int &HDP::getLow(const MDPNode &cn) {
   return (reinterpret_cast<HDPExtraNodeData *>(cn.searchData))->low;
 }
 
-int &HDP::getIdx(const MDPNode &cn) {
+int HDP::getIdx(const MDPNode &cn) const {
+  if (!traversal.isMarked(cn)) return RT_IDX_PLUS_INFINITY;
   return (reinterpret_cast<HDPExtraNodeData *>(cn.searchData))->idx;
 }
 
+void HDP::setIdx(MDPNode &cn, int idx) {
+  traversal.mark(cn);
+  (reinterpret_cast<HDPExtraNodeData *>(cn.searchData))->idx = idx;
+}
+
 void HDP::cacheQ(MDPNode &cn) {
   double oldUBVal = cn.ubVal;
   // bounds->update() changes both Q values and cn.ubVal
@@ -105,17 +111,21 @@ void HDP::updateInternal(MDPNode &cn) {
   cn.ubVal = cn.Q[maxUBAction].ubVal;
 }
 
-bool HDP::trialRecurse(MDPNode &cn, int depth) {
+// starts visiting cn.  returns false if cn is finished right away, with
+// the return value of the visit in result; otherwise pushes a frame for
+// cn onto frames.
+bool HDP::enterNode(MDPNode &cn, int depth, bool &result) {
   if (zmdpDebugLevelG >= 1) {
-    printf("  trialRecurse: depth=%d ubVal=%g\n", depth, cn.ubVal);
-    printf("  trialRecurse: s=%s\n", sparseRep(cn.s).c_str());
+    printf("  runTrial: depth=%d ubVal=%g\n", depth, cn.ubVal);
+    printf("  runTrial: s=%s\n", sparseRep(cn.s).c_str());
   }
 
   // base case
   if (getIsSolved(cn)) {
     if (zmdpDebugLevelG >= 1) {
-      printf("  trialRecurse: solved node (terminating)\n");
+      printf("  runTrial: solved node (terminating)\n");
     }
+    result = false;
     return false;
   }
 
@@ -127,40 +137,26 @@ bool HDP::trialRecurse(MDPNode &cn, int depth) {
     cn.ubVal = cn.Q[maxUBAction].ubVal;
 
     if (zmdpDebugLevelG >= 1) {
-      printf("  trialRecurse: big residual (terminating)\n");
+      printf("  runTrial: big residual (terminating)\n");
     }
-    return true;
+    result = true;
+    return false;
   }
 
   // mark state as active
-  visited.push(&cn);
   nodeStack.push(&cn);
-  getIdx(cn) = getLow(cn) = index;
+  setIdx(cn, index);
+  getLow(cn) = index;
   index++;
 
-  // recursive call
-  bool flag = false;
-  MDPQEntry &Qa = cn.Q[maxUBAction];
-  // printf("    pre low=%d idx=%d\n", getLow(cn), getIdx(cn));
-  FOR(o, Qa.getNumOutcomes()) {
-    MDPEdge *e = Qa.outcomes[o];
-    if (NULL != e) {
-      MDPNode &sn = *e->nextState;
-      // printf("      a=%d o=%d sn=[%s] sn.idx=%d\n", maxUBAction, o,
-      // denseRep(sn.s).c_str(), getIdx(sn));
-
-      if (RT_IDX_PLUS_INFINITY == getIdx(sn)) {
-        if (trialRecurse(sn, depth + 1)) {
-          flag = true;
-        }
-        getLow(cn) = std::min(getLow(cn), getLow(sn));
-      } else if (nodeStack.contains(&sn)) {
-        getLow(cn) = std::min(getLow(cn), getIdx(sn));
-      }
-    }
-  }
-  // printf("    post low=%d idx=%d\n", getLow(cn), getIdx(cn));
+  HDPFrame f = {&cn, maxUBAction, 0, false, depth};
+  frames.push_back(f);
+  return true;
+}
 
+// finishes visiting cn after all of its successors have been visited;
+// returns the return value of the visit
+bool HDP::finishNode(MDPNode &cn, bool flag) {
   // update if necessary
   if (flag) {
     bounds->update(cn, NULL);
@@ -169,17 +165,61 @@ bool HDP::trialRecurse(MDPNode &cn, int depth) {
   } else if (getIdx(cn) == getLow(cn)) {
     // try to label
     printf("  marking %d nodes solved\n", static_cast<int>(nodeStack.size()));
-    while (nodeStack.top() != &cn) {
-      MDPNode &sn = *nodeStack.pop();
-      getIsSolved(sn) = true;
-    }
-    nodeStack.pop();
-    getIsSolved(cn) = true;
+    labelSolved(nodeStack, &cn);
   }
 
   return flag;
 }
 
+// Tarjan's strongly connected components algorithm over the greedy
+// policy graph reachable from cn, as in the HDP paper, but with an
+// explicit stack of frames instead of recursion, since trials on large
+// problems can be very deep.
+bool HDP::runTrial(MDPNode &cn) {
+  bool result;
+  frames.clear();
+  if (!enterNode(cn, 0, result)) return result;
+
+  while (true) {
+    HDPFrame &f = frames.back();
+    MDPNode &n = *f.node;
+    MDPQEntry &Qa = n.Q[f.action];
+
+    // visit successors until one needs a frame of its own
+    bool descended = false;
+    for (; f.outcome < Qa.getNumOutcomes(); f.outcome++) {
+      MDPEdge *e = Qa.outcomes[f.outcome];
+      if (NULL == e) continue;
+      MDPNode &sn = *e->nextState;
+
+      if (RT_IDX_PLUS_INFINITY == getIdx(sn)) {
+        bool snResult;
+        if (enterNode(sn, f.depth + 1, snResult)) {
+          // f may have been invalidated; the successor is finished
+          // below, when its frame is popped
+          descended = true;
+          break;
+        }
+        if (snResult) f.flag = true;
+        getLow(n) = std::min(getLow(n), getLow(sn));
+      } else if (nodeStack.contains(&sn)) {
+        getLow(n) = std::min(getLow(n), getIdx(sn));
+      }
+    }
+    if (descended) continue;
+
+    bool nResult = finishNode(n, f.flag);
+    frames.pop_back();
+    if (frames.empty()) return nResult;
+
+    // pass the result back to the parent and move on to its next outcome
+    HDPFrame &parent = frames.back();
+    if (nResult) parent.flag = true;
+    getLow(*parent.node) = std::min(getLow(*parent.node), getLow(n));
+    parent.outcome++;
+  }
+}
+
 bool HDP::doTrial(MDPNode &cn) {
   if (getIsSolved(cn)) {
     printf("-*- doTrial: root node is solved, terminating\n");
@@ -190,15 +230,11 @@ bool HDP::doTrial(MDPNode &cn) {
     printf("-*- doTrial: trial %d\n", (numTrials + 1));
   }
 
+  // starting a new traversal resets idx to +infinity for all states
   index = 0;
-  trialRecurse(cn, 0);
-  // reset idx to +infinity for visited states
-  while (!visited.empty()) {
-    getIdx(*visited.top()) = RT_IDX_PLUS_INFINITY;
-    visited.pop();
-  }
+  traversal.begin();
+  runTrial(cn);
   nodeStack.clear();
-  RT_CLEAR_STD_STACK(visited);
 
   numTrials++;
 
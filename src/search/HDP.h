@@ -27,14 +27,29 @@
 namespace zmdp {
 
 struct HDPExtraNodeData {
-  bool isSolved;
+  RTDPNodeData rt;
+  // idx is only valid if the node is marked in the current trial
   int low, idx;
 };
 
+// a node whose successors HDP::runTrial() is visiting
+struct HDPFrame {
+  MDPNode *node;
+  int action;
+  // the next outcome to visit
+  size_t outcome;
+  // true if a node below this one had a large residual
+  bool flag;
+  int depth;
+};
+
 struct HDP : public RTDPCore {
   int index;
   NodeStack nodeStack;
-  std::stack<MDPNode *> visited;
+  // the nodes that have been assigned an idx in the current trial
+  RTDPTraversal traversal;
+  // the depth-first search stack of runTrial()
+  std::vector<HDPFrame> frames;
 
   HDP(void);
 
@@ -42,13 +57,16 @@ struct HDP : public RTDPCore {
   static void staticGetNodeHandler(MDPNode &cn, void *handlerData);
   static bool &getIsSolved(const MDPNode &cn);
   static int &getLow(const MDPNode &cn);
-  static int &getIdx(const MDPNode &cn);
+  int getIdx(const MDPNode &cn) const;
+  void setIdx(MDPNode &cn, int idx);
 
   void cacheQ(MDPNode &cn);
   double residual(MDPNode &cn);
 
   void updateInternal(MDPNode &cn);
-  bool trialRecurse(MDPNode &cn, int depth);
+  bool enterNode(MDPNode &cn, int depth, bool &result);
+  bool finishNode(MDPNode &cn, bool flag);
+  bool runTrial(MDPNode &cn);
   bool doTrial(MDPNode &cn);
   void derivedClassInit(void);
 };
@@ -22,10 +22,12 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <queue>
 
+#include "BoundPair.h"
 #include "MatrixUtils.h"
 #include "Pomdp.h"
 #include "zmdpCommonDefs.h"
@@ -41,17 +43,18 @@ using namespace MatrixUtils;
 
 namespace zmdp {
 
-HSVI::HSVI(void) {
+HSVI::HSVI(void) : numSearchThreads(1), primary(NULL), searchSeconds(0) {
 #if USE_HSVI_ADAPTIVE_DEPTH
   maxDepth = HSVI_INIT_MAX_DEPTH;
 #endif
 }
 
 void HSVI::getMaxExcessUncOutcome(MDPNode &cn, int depth,
-                                  HSVIUpdateResult &r) const {
+                                  HSVIUpdateResult &r) {
   r.maxExcessUnc = -99e+20;
   r.maxExcessUncOutcome = -1;
   double width;
+  double widthSum = 0;
   MDPQEntry &Qa = cn.Q[r.maxUBAction];
   FOR(o, Qa.getNumOutcomes()) {
     MDPEdge *e = Qa.outcomes[o];
@@ -64,6 +67,7 @@ void HSVI::getMaxExcessUncOutcome(MDPNode &cn, int depth,
         r.maxExcessUnc = width;
         r.maxExcessUncOutcome = o;
       }
+      if (width > 0) widthSum += width;
 #if 0
       printf("    a=%d o=%d obsProb=%g nslb=%g nsub=%g nsdiff=%g width=%g\n",
              r.maxUBAction, o, e->obsProb, sn.lbVal, sn.ubVal,
@@ -71,6 +75,27 @@ void HSVI::getMaxExcessUncOutcome(MDPNode &cn, int depth,
 #endif
     }
   }
+
+  if (NULL != primary && widthSum > 0) {
+    // replica: pick among the outcomes with excess uncertainty in
+    // proportion to their weighted width, rather than always the largest
+    double target = std::uniform_real_distribution<double>(0, widthSum)(rng);
+    FOR(o, Qa.getNumOutcomes()) {
+      MDPEdge *e = Qa.outcomes[o];
+      if (NULL == e) continue;
+      MDPNode &sn = *e->nextState;
+      width = e->obsProb * (sn.ubVal - sn.lbVal -
+                            trialTargetPrecision *
+                                pow(problem->getDiscount(), -(depth + 1)));
+      if (width <= 0) continue;
+      target -= width;
+      if (target <= 0) {
+        r.maxExcessUnc = width;
+        r.maxExcessUncOutcome = o;
+        break;
+      }
+    }
+  }
 }
 
 void HSVI::update(MDPNode &cn, int depth, HSVIUpdateResult &r) {
@@ -130,10 +155,19 @@ void HSVI::trialRecurse(MDPNode &cn, double logOcc, int depth) {
   trialRecurse(cn.getNextState(r.maxUBAction, r.maxExcessUncOutcome),
                nextLogOcc, depth + 1);
 
+  if (NULL != primary && primary->helpers.getStopRequested()) {
+    // the primary is waiting for the replicas; the bounds are valid at
+    // any point, so skip the remaining updates
+    return;
+  }
   update(cn, depth, r);
 }
 
-bool HSVI::doTrial(MDPNode &cn) {
+void HSVI::runTrial(MDPNode &cn) {
+  if (NULL != primary || !replicas.empty()) {
+    mergeInbox();
+  }
+
   if (zmdpDebugLevelG >= 1) {
     printf("-*- doTrial: trial %d\n", (numTrials + 1));
   }
@@ -179,8 +213,191 @@ bool HSVI::doTrial(MDPNode &cn) {
 #endif  // if USE_HSVI_ADAPTIVE_DEPTH
 
   numTrials++;
+}
+
+bool HSVI::doTrial(MDPNode &cn) {
+  StopWatch run;
+  if (replicas.empty()) {
+    runTrial(cn);
+    searchSeconds += run.elapsedTime();
+    return (cn.ubVal - cn.lbVal < targetPrecision);
+  }
+
+  helpers.start();
+  do {
+    runTrial(cn);
+  } while (cn.ubVal - cn.lbVal >= targetPrecision &&
+           run.elapsedTime() < SEARCH_HELPERS_SLICE_SECONDS);
+  helpers.stop();
+  searchSeconds += run.elapsedTime();
+
+  ValueInterval rootValue = getRootValue();
+  return (rootValue.u - rootValue.l < targetPrecision);
+}
+
+void HSVI::derivedClassInit(void) {
+  // replicas are set up by the primary
+  if (NULL != primary) return;
+
+  numSearchThreads = config->getInt("numSearchThreads");
+  if (numSearchThreads < 1) {
+    fprintf(stderr, "ERROR: numSearchThreads must be at least 1 (got %d)\n",
+            numSearchThreads);
+    exit(EXIT_FAILURE);
+  }
+  if (numSearchThreads > 1) {
+    BoundPair *bp = dynamic_cast<BoundPair *>(bounds);
+    if (NULL == dynamic_cast<Pomdp *>(problem) || NULL == bp ||
+        NULL == dynamic_cast<MaxPlanesLowerBound *>(bp->lowerBound) ||
+        NULL == dynamic_cast<SawtoothUpperBound *>(bp->upperBound)) {
+      // replicas exchange planes and points, so both bounds must have them
+      fprintf(stderr,
+              "WARNING: numSearchThreads > 1 with hsvi requires a POMDP model "
+              "with maxPlanes lower bound and sawtooth upper bound; running 1 "
+              "search thread\n");
+      numSearchThreads = 1;
+    }
+  }
+  if (numSearchThreads > 1) {
+    initReplicas();
+  }
+}
 
-  return (cn.ubVal - cn.lbVal < targetPrecision);
+void HSVI::initReplicas(void) {
+  BoundPair *bp = static_cast<BoundPair *>(bounds);
+  MaxPlanesLowerBound *mlb =
+      static_cast<MaxPlanesLowerBound *>(bp->lowerBound);
+  SawtoothUpperBound *sub = static_cast<SawtoothUpperBound *>(bp->upperBound);
+
+  peers.push_back(this);
+  for (int k = 1; k < numSearchThreads; k++) {
+    BoundPair *rbp =
+        new BoundPair(bp->maintainLowerBound, bp->maintainUpperBound,
+                      bp->useUpperBoundRunTimeActionSelection,
+                      /* dualPointBounds = */ false);
+    MaxPlanesLowerBound *rmlb = new MaxPlanesLowerBound(problem, config);
+    rmlb->core = rbp;
+    rbp->lowerBound = rmlb;
+    SawtoothUpperBound *rsub = new SawtoothUpperBound(problem, config);
+    rsub->core = rbp;
+    rbp->upperBound = rsub;
+    // the replica starts from copies of our initial bounds instead of
+    // computing its own
+    rmlb->initialized = true;
+    rsub->initialized = true;
+
+    HSVI *r = new HSVI();
+    r->primary = this;
+    r->rng.seed(k);
+    r->setBounds(rbp);
+    r->planInit(problem, config);
+    if (!r->initialized) r->init();
+    r->useLogBackups = false;
+
+    FOR_EACH(planeP, mlb->planes) {
+      const LBPlane &p = **planeP;
+      rmlb->mergeLBPlane(new LBPlane(p.alpha, p.action, p.mask));
+    }
+    rsub->setCornerPts(sub->cornerPts);
+    FOR_EACH(ptP, sub->pts) {
+      rsub->mergePoint(new BVPair((*ptP)->b, (*ptP)->v));
+    }
+
+    replicas.push_back(r);
+    peers.push_back(r);
+  }
+
+  FOR_EACH(peerP, peers) {
+    BoundPair *pbp = static_cast<BoundPair *>((*peerP)->bounds);
+    MaxPlanesLowerBound *pmlb =
+        static_cast<MaxPlanesLowerBound *>(pbp->lowerBound);
+    SawtoothUpperBound *psub =
+        static_cast<SawtoothUpperBound *>(pbp->upperBound);
+    pmlb->newPlaneHandler = &HSVI::staticNewPlaneHandler;
+    pmlb->newPlaneHandlerData = *peerP;
+    psub->newPointHandler = &HSVI::staticNewPointHandler;
+    psub->newPointHandlerData = *peerP;
+  }
+
+  helpers.init(replicas.size(), [this](int i) {
+    replicas[i]->runTrial(*replicas[i]->bounds->getRootNode());
+  });
+}
+
+void HSVI::mergeInbox(void) {
+  BoundPair *bp = static_cast<BoundPair *>(bounds);
+  MaxPlanesLowerBound *mlb =
+      static_cast<MaxPlanesLowerBound *>(bp->lowerBound);
+  SawtoothUpperBound *sub = static_cast<SawtoothUpperBound *>(bp->upperBound);
+
+  std::vector<LBPlane *> newPlanes;
+  planeInbox.popAll(newPlanes);
+  FOR_EACH(planeP, newPlanes) { mlb->mergeLBPlane(*planeP); }
+
+  std::vector<BVPair *> newPoints;
+  pointInbox.popAll(newPoints);
+  FOR_EACH(ptP, newPoints) { sub->mergePoint(*ptP); }
+
+  if (!newPlanes.empty()) mlb->maybePrune(bounds->numBackups);
+  if (!newPoints.empty()) sub->maybePrune(bounds->numBackups);
+}
+
+void HSVI::staticNewPlaneHandler(const LBPlane &plane, void *handlerData) {
+  HSVI *self = reinterpret_cast<HSVI *>(handlerData);
+  HSVI *p = (NULL == self->primary) ? self : self->primary;
+  FOR_EACH(peerP, p->peers) {
+    if (*peerP == self) continue;
+    (*peerP)->planeInbox.push(
+        new LBPlane(plane.alpha, plane.action, plane.mask));
+  }
+}
+
+void HSVI::staticNewPointHandler(const BVPair &bv, void *handlerData) {
+  HSVI *self = reinterpret_cast<HSVI *>(handlerData);
+  HSVI *p = (NULL == self->primary) ? self : self->primary;
+  FOR_EACH(peerP, p->peers) {
+    if (*peerP == self) continue;
+    (*peerP)->pointInbox.push(new BVPair(bv.b, bv.v));
+  }
+}
+
+// every peer's bounds are valid, so the merged bounds are the tightest
+// of them.  only called while the replicas are stopped.
+ValueInterval HSVI::getValueAt(const state_vector &s) const {
+  ValueInterval result = bounds->getValueAt(s);
+  FOR_EACH(replicaP, replicas) {
+    ValueInterval v = (*replicaP)->bounds->getValueAt(s);
+    result.l = std::max(result.l, v.l);
+    result.u = std::min(result.u, v.u);
+  }
+  return result;
+}
+
+ValueInterval HSVI::getRootValue(void) {
+  ValueInterval result = RTDPCore::getRootValue();
+  FOR_EACH(replicaP, replicas) {
+    ValueInterval v = (*replicaP)->RTDPCore::getRootValue();
+    result.l = std::max(result.l, v.l);
+    result.u = std::min(result.u, v.u);
+  }
+  return result;
+}
+
+void HSVI::finishLogging(void) {
+  RTDPCore::finishLogging();
+
+  if (!replicas.empty() && searchSeconds > 0) {
+    int totalTrials = numTrials;
+    int totalBackups = bounds->numBackups;
+    FOR_EACH(replicaP, replicas) {
+      totalTrials += (*replicaP)->numTrials;
+      totalBackups += (*replicaP)->bounds->numBackups;
+    }
+    printf("HSVI: %d search threads ran %d trials, %d backups in %.2lf "
+           "seconds (%.1lf backups/s)\n",
+           numSearchThreads, totalTrials, totalBackups, searchSeconds,
+           totalBackups / searchSeconds);
+  }
 }
 
 };  // namespace zmdp
@@ -18,7 +18,14 @@
 #ifndef ZMDP_SRC_SEARCH_HSVI_H_
 #define ZMDP_SRC_SEARCH_HSVI_H_
 
+#include <random>
+#include <vector>
+
+#include "LockFreeQueue.h"
+#include "MaxPlanesLowerBound.h"
 #include "RTDPCore.h"
+#include "SawtoothUpperBound.h"
+#include "SearchHelpers.h"
 
 namespace zmdp {
 
@@ -41,13 +48,43 @@ struct HSVI : public RTDPCore {
   int newNumUpdates;
 #endif
 
+  // root-parallel search (numSearchThreads > 1).  the solver the caller
+  // sees is the primary; it owns numSearchThreads-1 replicas, each with
+  // a private search graph and bounds, which run trials in helper
+  // threads.  every plane or point a peer creates is copied into the
+  // inboxes of the other peers, which merge them at the start of their
+  // next trial.
+  int numSearchThreads;
+  // NULL in the primary
+  HSVI *primary;
+  // in the primary: the primary itself, followed by the replicas
+  std::vector<HSVI *> peers;
+  std::vector<HSVI *> replicas;
+  SearchHelpers helpers;
+  // replicas break ties between outcomes at random, so that they do not
+  // all explore the same beliefs
+  std::mt19937 rng;
+  LockFreeQueue<LBPlane> planeInbox;
+  LockFreeQueue<BVPair> pointInbox;
+  // time spent in doTrial(), for reporting throughput
+  double searchSeconds;
+
   HSVI(void);
 
-  void getMaxExcessUncOutcome(MDPNode &cn, int depth,
-                              HSVIUpdateResult &r) const;
+  void getMaxExcessUncOutcome(MDPNode &cn, int depth, HSVIUpdateResult &r);
   void update(MDPNode &cn, int depth, HSVIUpdateResult &result);
   void trialRecurse(MDPNode &cn, double logOcc, int depth);
+  void runTrial(MDPNode &cn);
   bool doTrial(MDPNode &cn);
+  void derivedClassInit(void);
+  ValueInterval getValueAt(const state_vector &s) const;
+  ValueInterval getRootValue(void);
+  void finishLogging(void);
+
+  void initReplicas(void);
+  void mergeInbox(void);
+  static void staticNewPlaneHandler(const LBPlane &plane, void *handlerData);
+  static void staticNewPointHandler(const BVPair &bv, void *handlerData);
 };
 
 };  // namespace zmdp
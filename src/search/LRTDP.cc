@@ -60,7 +60,7 @@ LRTDP::LRTDP(void) {}
 void LRTDP::getNodeHandler(MDPNode &cn) {
   LRTDPExtraNodeData *searchData = new LRTDPExtraNodeData;
   cn.searchData = searchData;
-  searchData->isSolved = cn.isTerminal;
+  initRTDPNodeData(cn, searchData->rt);
 }
 
 void LRTDP::staticGetNodeHandler(MDPNode &s, void *handlerData) {
@@ -69,7 +69,7 @@ void LRTDP::staticGetNodeHandler(MDPNode &s, void *handlerData) {
 }
 
 bool &LRTDP::getIsSolved(const MDPNode &cn) {
-  return (reinterpret_cast<LRTDPExtraNodeData *>(cn.searchData))->isSolved;
+  return getRTDPNodeData(cn).isSolved;
 }
 
 void LRTDP::cacheQ(MDPNode &cn) {
@@ -89,10 +89,16 @@ double LRTDP::residual(MDPNode &cn) {
 
 bool LRTDP::checkSolved(MDPNode &cn) {
   bool rv = true;
-  NodeStack open, closed;
   int a;
 
-  if (!getIsSolved(cn)) open.push(&cn);
+  // the nodes marked in this traversal are the ones on open or closed
+  open.clear();
+  closed.clear();
+  traversal.begin();
+  if (!getIsSolved(cn)) {
+    traversal.mark(cn);
+    open.push(&cn);
+  }
   while (!open.empty()) {
     MDPNode &n = *open.pop();
     closed.push(&n);
@@ -108,7 +114,8 @@ bool LRTDP::checkSolved(MDPNode &cn) {
       MDPEdge *e = Qa.outcomes[o];
       if (NULL != e) {
         MDPNode &sn = *e->nextState;
-        if (!getIsSolved(sn) && !open.contains(&sn) && !closed.contains(&sn)) {
+        if (!getIsSolved(sn) && !traversal.isMarked(sn)) {
+          traversal.mark(sn);
           open.push(&sn);
         }
       }
@@ -121,10 +128,7 @@ bool LRTDP::checkSolved(MDPNode &cn) {
   }
   if (rv) {
     // label relevant states
-    while (!closed.empty()) {
-      MDPNode &n = *closed.pop();
-      getIsSolved(n) = true;
-    }
+    labelSolved(closed, NULL);
   } else {
     // update states with residuals and ancestors
     while (!closed.empty()) {
@@ -146,38 +150,44 @@ void LRTDP::updateInternal(MDPNode &cn) {
   cn.ubVal = cn.Q[maxUBAction].ubVal;
 }
 
-bool LRTDP::trialRecurse(MDPNode &cn, int depth) {
-  // check for termination
-  if (getIsSolved(cn)) {
+// follows the greedy policy from cn, with simulated outcomes, until
+// reaching a solved node, then runs checkSolved() on the nodes of the
+// trial in reverse order until one of them is not solved.  the trial is
+// kept in trialPath rather than on the call stack, since trials on large
+// problems can be very long.
+bool LRTDP::runTrial(MDPNode &cn) {
+  trialPath.clear();
+  MDPNode *n = &cn;
+  while (!getIsSolved(*n)) {
+    // cached Q values must be up to date for subsequent calls
+    int maxUBAction;
+    bounds->update(*n, &maxUBAction);
+    trackBackup(*n);
+
+    int simulatedOutcome = bounds->getSimulatedOutcome(*n, maxUBAction);
+
     if (zmdpDebugLevelG >= 1) {
-      printf("  trialRecurse: depth=%d ubVal=%g solved node (terminating)\n",
-             depth, cn.ubVal);
+      printf("  runTrial: depth=%d a=%d o=%d ubVal=%g\n",
+             static_cast<int>(trialPath.size()), maxUBAction,
+             simulatedOutcome, n->ubVal);
+      printf("  runTrial: s=%s\n", sparseRep(n->s).c_str());
     }
-    return true;
-  }
 
-  // cached Q values must be up to date for subsequent calls
-  int maxUBAction;
-  bounds->update(cn, &maxUBAction);
-  trackBackup(cn);
-
-  int simulatedOutcome = bounds->getSimulatedOutcome(cn, maxUBAction);
+    trialPath.push_back(n);
+    n = &n->getNextState(maxUBAction, simulatedOutcome);
+  }
 
   if (zmdpDebugLevelG >= 1) {
-    printf("  trialRecurse: depth=%d a=%d o=%d ubVal=%g\n", depth, maxUBAction,
-           simulatedOutcome, cn.ubVal);
-    printf("  trialRecurse: s=%s\n", sparseRep(cn.s).c_str());
+    printf("  runTrial: depth=%d ubVal=%g solved node (terminating)\n",
+           static_cast<int>(trialPath.size()), n->ubVal);
   }
 
-  // recurse to successor
-  bool solvedAtNextDepth =
-      trialRecurse(cn.getNextState(maxUBAction, simulatedOutcome), depth + 1);
-
-  if (solvedAtNextDepth) {
-    return checkSolved(cn);
-  } else {
-    return false;
+  while (!trialPath.empty()) {
+    MDPNode &tn = *trialPath.back();
+    trialPath.pop_back();
+    if (!checkSolved(tn)) return false;
   }
+  return true;
 }
 
 bool LRTDP::doTrial(MDPNode &cn) {
@@ -185,7 +195,7 @@ bool LRTDP::doTrial(MDPNode &cn) {
     printf("-*- doTrial: trial %d\n", (numTrials + 1));
   }
 
-  trialRecurse(cn, 0);
+  runTrial(cn);
   numTrials++;
 
   return getIsSolved(cn);
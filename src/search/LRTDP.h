@@ -26,10 +26,15 @@
 namespace zmdp {
 
 struct LRTDPExtraNodeData {
-  bool isSolved;
+  RTDPNodeData rt;
 };
 
 struct LRTDP : public RTDPCore {
+  // scratch space for checkSolved() and runTrial(), kept between calls
+  NodeStack open, closed;
+  RTDPTraversal traversal;
+  std::vector<MDPNode *> trialPath;
+
   LRTDP(void);
 
   void getNodeHandler(MDPNode &cn);
@@ -40,7 +45,7 @@ struct LRTDP : public RTDPCore {
   bool checkSolved(MDPNode &cn);
 
   void updateInternal(MDPNode &cn);
-  bool trialRecurse(MDPNode &cn, int depth);
+  bool runTrial(MDPNode &cn);
   bool doTrial(MDPNode &cn);
   void derivedClassInit(void);
 };
@@ -114,9 +114,9 @@ bool RTDPCore::planFixedTime(const state_vector &s, double maxTimeSeconds,
   if (NULL != boundsFile) {
     double elapsed = timevalToSeconds(getTime() - boundsStartTime);
     if (done || (0 == lastPrintTime) || elapsed / lastPrintTime >= (1 + 1e-4)) {
+      ValueInterval rootValue = getRootValue();
       (*boundsFile) << timevalToSeconds(getTime() - boundsStartTime) << " "
-                    << bounds->getRootNode()->lbVal << " "
-                    << bounds->getRootNode()->ubVal << " "
+                    << rootValue.l << " " << rootValue.u << " "
                     << bounds->numStatesTouched << " "
                     << bounds->numStatesExpanded << " " << numTrials << " "
                     << bounds->numBackups << endl;
@@ -143,6 +143,11 @@ ValueInterval RTDPCore::getValueAt(const state_vector &s) const {
   return bounds->getValueAt(s);
 }
 
+ValueInterval RTDPCore::getRootValue(void) {
+  MDPNode *root = bounds->getRootNode();
+  return ValueInterval(root->lbVal, root->ubVal);
+}
+
 void RTDPCore::trackBackup(const MDPNode &backedUpNode) {
   if (useLogBackups) {
     backedUpNodes.push_back(&backedUpNode);
@@ -152,14 +157,14 @@ void RTDPCore::trackBackup(const MDPNode &backedUpNode) {
 void RTDPCore::maybeLogBackups(void) {
   if (!useLogBackups && qValuesOutputFile == "none") return;
 
-  StateIndex index(problem->getNumStateDimensions());
+  StateIndex index(problem->getNumStateDimensions(), problem);
   StateLog log(&index);
   FOR_EACH(node, backedUpNodes) { log.addState((*node)->s); }
   if (qValuesOutputFile != "none") {
     // make sure the index contains all *queried* states, not just all
     // backed up states.  (but the log will still have only backed up
     // states.)
-    FOR_EACH(pr, *(bounds->lookup)) { index.getStateId(pr->second->s); }
+    FOR_EACH(pr, *(bounds->lookup)) { index.getStateId(pr->value->s); }
   }
 
   index.writeToFile(stateIndexOutputFile);
@@ -175,4 +180,22 @@ void RTDPCore::maybeLogBackups(void) {
 
 void RTDPCore::finishLogging(void) { maybeLogBackups(); }
 
+void RTDPCore::initRTDPNodeData(MDPNode &cn, RTDPNodeData &data) {
+  data.isSolved = cn.isTerminal;
+  data.onStack = false;
+  // no traversal has generation 0
+  data.generation = 0;
+}
+
+int RTDPCore::labelSolved(NodeStack &stack, const MDPNode *last) {
+  int numLabeled = 0;
+  while (!stack.empty()) {
+    MDPNode &n = *stack.pop();
+    getRTDPNodeData(n).isSolved = true;
+    numLabeled++;
+    if (&n == last) break;
+  }
+  return numLabeled;
+}
+
 };  // namespace zmdp
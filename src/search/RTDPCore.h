@@ -22,44 +22,75 @@
 #ifndef ZMDP_SRC_SEARCH_RTDPCORE_H_
 #define ZMDP_SRC_SEARCH_RTDPCORE_H_
 
-#include <stack>
+#include <stdint.h>
+
+#include <vector>
 
 #include "BoundPairCore.h"
 #include "MatrixUtils.h"
 #include "Solver.h"
 
-#define RT_CLEAR_STD_STACK(x) \
-  while (!(x).empty()) (x).pop();
 #define RT_IDX_PLUS_INFINITY (INT_MAX)
 #define RT_PRIO_MINUS_INFINITY (-99e+20)
 #define RT_PRIO_IMPROVEMENT_CONSTANT (0.5)
 
 namespace zmdp {
 
-// data structure used by LRTDP and HDP: stack with O(1) element existence check
+// search data shared by LRTDP and HDP.  it must be the first member of
+// the struct that each of them attaches to nodes as searchData.
+struct RTDPNodeData {
+  bool isSolved;
+  // true while the node is on a NodeStack
+  bool onStack;
+  // the RTDPTraversal generation in which the node was last marked
+  uint64_t generation;
+};
+
+inline RTDPNodeData &getRTDPNodeData(const MDPNode &cn) {
+  return *reinterpret_cast<RTDPNodeData *>(cn.searchData);
+}
+
+// data structure used by LRTDP and HDP: stack with O(1) element existence
+// check.  membership is recorded in the node's RTDPNodeData, so a node
+// can only be on one NodeStack at a time.  clear() keeps the storage, so
+// a stack owned by the solver doesn't allocate once it has grown.
 struct NodeStack {
-  std::stack<MDPNode *> data;
-  EXT_NAMESPACE::hash_map<MDPNode *, bool> lookup;
+  std::vector<MDPNode *> data;
 
   void push(MDPNode *n) {
-    data.push(n);
-    lookup[n] = true;
+    data.push_back(n);
+    getRTDPNodeData(*n).onStack = true;
   }
   MDPNode *pop(void) {
-    MDPNode *n = data.top();
-    data.pop();
-    lookup.erase(n);
+    MDPNode *n = data.back();
+    data.pop_back();
+    getRTDPNodeData(*n).onStack = false;
     return n;
   }
   void clear(void) {
-    RT_CLEAR_STD_STACK(data);
-    lookup.clear();
+    FOR_EACH(nP, data) { getRTDPNodeData(**nP).onStack = false; }
+    data.clear();
   }
 
-  MDPNode *top(void) const { return data.top(); }
+  MDPNode *top(void) const { return data.back(); }
   bool empty(void) const { return data.empty(); }
   size_t size(void) const { return data.size(); }
-  bool contains(MDPNode *n) const { return (lookup.end() != lookup.find(n)); }
+  bool contains(MDPNode *n) const { return getRTDPNodeData(*n).onStack; }
+};
+
+// marks the nodes reached by one traversal of the graph.  begin()
+// starts a new traversal by bumping the generation, which unmarks every
+// node at once, so nothing needs to be reset when a traversal ends.
+struct RTDPTraversal {
+  uint64_t generation;
+
+  RTDPTraversal(void) : generation(0) {}
+
+  void begin(void) { generation++; }
+  bool isMarked(const MDPNode &cn) const {
+    return getRTDPNodeData(cn).generation == generation;
+  }
+  void mark(MDPNode &cn) { getRTDPNodeData(cn).generation = generation; }
 };
 
 struct RTDPCore : public Solver {
@@ -99,9 +130,18 @@ struct RTDPCore : public Solver {
   int chooseAction(const state_vector &s);
   void setBoundsFile(std::ostream *boundsFile);
   ValueInterval getValueAt(const state_vector &s) const;
+  // bounds at the root, as written to the bounds file
+  virtual ValueInterval getRootValue(void);
   void trackBackup(const MDPNode &backedUpNode);
   void maybeLogBackups(void);
   void finishLogging(void);
+
+  // initializes the RTDPNodeData of a new node
+  static void initRTDPNodeData(MDPNode &cn, RTDPNodeData &data);
+  // pops nodes off stack and labels them solved, stopping after last (or
+  // when the stack is empty if last is NULL).  returns the number of
+  // nodes labeled.
+  static int labelSolved(NodeStack &stack, const MDPNode *last);
 };
 
 };  // namespace zmdp
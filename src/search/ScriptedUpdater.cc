@@ -53,7 +53,7 @@ void ScriptedUpdater::readFiles(void) {
   std::string backupsInputFile =
       backupScriptInputDir + "/" + config->getString("backupsOutputFile");
 
-  stateIndex = new StateIndex(problem->getNumStateDimensions());
+  stateIndex = new StateIndex(problem->getNumStateDimensions(), problem);
   stateIndex->readFromFile(stateIndexInputFile);
 
   backupsLog = new StateLog(stateIndex);
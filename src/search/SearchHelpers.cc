@@ -0,0 +1,89 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#include "SearchHelpers.h"
+
+#include "zmdpCommonDefs.h"
+
+namespace zmdp {
+
+SearchHelpers::SearchHelpers(void)
+    : running(false),
+      generation(0),
+      shuttingDown(false),
+      numBusy(0),
+      stopRequested(false) {}
+
+SearchHelpers::~SearchHelpers(void) {
+  {
+    std::lock_guard<std::mutex> lk(lock);
+    shuttingDown = true;
+  }
+  wakeup.notify_all();
+  FOR_EACH(threadP, threads) { threadP->join(); }
+}
+
+void SearchHelpers::init(int numHelpers,
+                         const std::function<void(int)> &_runTrial) {
+  runTrial = _runTrial;
+  FOR(i, numHelpers) {
+    threads.push_back(std::thread(&SearchHelpers::helperMain, this, i));
+  }
+}
+
+void SearchHelpers::start(void) {
+  stopRequested = false;
+  {
+    std::lock_guard<std::mutex> lk(lock);
+    running = true;
+    generation++;
+  }
+  wakeup.notify_all();
+}
+
+void SearchHelpers::stop(void) {
+  stopRequested = true;
+  std::unique_lock<std::mutex> lk(lock);
+  running = false;
+  while (numBusy > 0) {
+    idle.wait(lk);
+  }
+}
+
+void SearchHelpers::helperMain(int i) {
+  int lastGeneration = 0;
+  std::unique_lock<std::mutex> lk(lock);
+  while (1) {
+    // wait for a start() we have not responded to yet
+    while (!shuttingDown && !(running && generation != lastGeneration)) {
+      wakeup.wait(lk);
+    }
+    if (shuttingDown) return;
+    lastGeneration = generation;
+
+    numBusy++;
+    lk.unlock();
+    while (!getStopRequested()) {
+      runTrial(i);
+    }
+    lk.lock();
+    numBusy--;
+    if (0 == numBusy) idle.notify_all();
+  }
+}
+
+};  // namespace zmdp
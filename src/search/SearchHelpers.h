@@ -0,0 +1,72 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ Copyright (c) 2005-2006, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef ZMDP_SRC_SEARCH_SEARCHHELPERS_H_
+#define ZMDP_SRC_SEARCH_SEARCHHELPERS_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// with helper threads, doTrial() keeps everyone busy for about this
+// long before stopping the helpers and returning
+#define SEARCH_HELPERS_SLICE_SECONDS (0.1)
+
+namespace zmdp {
+
+// Helper threads for searches that run several trials at once.  Between
+// start() and stop(), helper i calls runTrial(i) over and over.  The
+// helpers sleep the rest of the time, so the search looks single
+// threaded to everything outside doTrial().
+class SearchHelpers {
+ public:
+  SearchHelpers(void);
+  ~SearchHelpers(void);
+
+  // creates numHelpers threads; call once
+  void init(int numHelpers, const std::function<void(int)> &_runTrial);
+  int size(void) const { return threads.size(); }
+
+  void start(void);
+  // asks the helpers to stop and waits until all are idle.  a trial in
+  // progress should check getStopRequested() and end early.
+  void stop(void);
+  bool getStopRequested(void) const {
+    return stopRequested.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  std::function<void(int)> runTrial;
+  std::vector<std::thread> threads;
+  std::mutex lock;
+  std::condition_variable wakeup;
+  std::condition_variable idle;
+  bool running;
+  int generation;
+  bool shuttingDown;
+  int numBusy;
+  std::atomic<bool> stopRequested;
+
+  void helperMain(int i);
+};
+
+};  // namespace zmdp
+
+#endif  // ZMDP_SRC_SEARCH_SEARCHHELPERS_H_
@@ -46,25 +46,25 @@ static std::string stripWhiteSpace(const std::string &s) {
   }
 }
 
-StateIndex::StateIndex(int _numStateDimensions)
-    : numStateDimensions(_numStateDimensions) {}
+StateIndex::StateIndex(int _numStateDimensions, const MDP *_model)
+    : numStateDimensions(_numStateDimensions), model(_model) {}
 
 StateIndex::~StateIndex(void) {
   FOR_EACH(e, entries) { delete *e; }
 }
 
 int StateIndex::getStateId(const state_vector &s) {
-  string hs = hashable(s);
-  typeof(lookup.begin()) pr = lookup.find(hs);
-  if (lookup.end() == pr) {
+  uint64_t hs = hashStateVector(s);
+  int *pr = lookup.findHashed(s, hs);
+  if (NULL == pr) {
     state_vector *sCopyP = new state_vector;
     copy(*sCopyP, s);
     entries.push_back(sCopyP);
     int id = entries.size() - 1;
-    lookup[hs] = id;
+    lookup.insertHashed(sCopyP, id, hs);
     return id;
   } else {
-    return pr->second;
+    return *pr;
   }
 }
 
@@ -94,7 +94,8 @@ void StateIndex::writeToFile(const std::string &outFile) const {
     out << "state " << i << endl;
     const state_vector &v = *entries[i];
     FOR_CV(v) {
-      out << CV_INDEX(v) << " " << setprecision(20) << CV_VAL(v) << endl;
+      out << model->getOriginalStateId(CV_INDEX(v)) << " " << setprecision(20)
+          << CV_VAL(v) << endl;
     }
   }
 
@@ -143,7 +144,15 @@ void StateIndex::readFromFile(const std::string &inFile) {
                 inFile.c_str(), lnum);
         exit(EXIT_FAILURE);
       }
-      accum.push_back(id, val);
+      int i = model->getCompactStateId(id);
+      if (-1 == i) {
+        fprintf(stderr,
+                "ERROR: %s:%d: state %d is not in the model (or was dropped "
+                "by compactReachableStates)\n",
+                inFile.c_str(), lnum, id);
+        exit(EXIT_FAILURE);
+      }
+      accum.push_back(i, val);
     }
   }
 
@@ -216,7 +225,8 @@ void StateIndex::writeQValuesToFile(const std::string &outFile,
     const state_vector &s = *entries[i];
     FOR(a, numActions) {
       ValueInterval intv = bounds.getQValue(s, a);
-      out << i << " " << a << " " << setprecision(20) << intv.l << " "
+      out << i << " " << model->getOriginalActionId(a) << " "
+          << setprecision(20) << intv.l << " "
           << setprecision(20) << intv.u << endl;
     }
   }
@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 
+#include "BeliefHash.h"
 #include "BoundPairCore.h"
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
@@ -32,10 +33,13 @@ namespace zmdp {
 
 struct StateIndex {
   int numStateDimensions;
+  // index files use the state ids of the model file (see
+  // MDP::originalStateIds)
+  const MDP *model;
   std::vector<state_vector *> entries;
-  EXT_NAMESPACE::hash_map<std::string, int> lookup;
+  BeliefHash<int> lookup;
 
-  explicit StateIndex(int _numStateDimensions);
+  StateIndex(int _numStateDimensions, const MDP *_model);
   ~StateIndex(void);
   int getStateId(const state_vector &s);
   void writeToFile(const std::string &outFile) const;